@@ -0,0 +1,80 @@
+// CFG construction benchmark: one function of N statements made of if-shaped
+// diamonds (a test, a conditional jump over an assignment, a join), so a quarter
+// of the statements start a block and every other block ends in a jump.
+// CFGBuilder::buildCFG makes one pass over the builder's statement vector to
+// find the leaders and one to fill the blocks, jump targets go through the
+// label index; the time per statement should stay flat as N grows. The last
+// column is the same function lowered with LlBuilder::setBuildBlocks, where
+// buildCFG takes the blocks recorded during lowering instead.
+//
+// usage: bench_cfg [max-statements]   (default 50000, halved down to max/8)
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <chrono>
+#include <functional>
+#include "CFG.h"
+
+// x = x + 1; ifZ t goto join; x = t; join: y = x; ... return
+static void lower_diamonds(LlBuilder& builder, size_t statements) {
+    LlLocationVar* x = new LlLocationVar(new std::string("x"));
+    LlLocationVar* y = new LlLocationVar(new std::string("y"));
+    for (size_t i = 0; i + 4 < statements; i += 4) {
+        LlLocationVar* t = builder.generateTemp();
+        LlLabel join = builder.generateLabel();
+        builder.appendStatement(new LlAssignStmtBinaryOp(t, x, "+", new LlLiteralInt(1)));
+        builder.appendStatement(new LlJumpConditional(join, t));
+        builder.appendStatement(new LlAssignStmtRegular(x, t));
+        builder.appendStatement(join, new LlAssignStmtRegular(y, x));
+    }
+    builder.appendStatement(new LlReturn(y));
+}
+
+// best of three runs, in milliseconds
+static double time_ms(const std::function<void()>& run) {
+    double best = 0;
+    for (int i = 0; i < 3; i++) {
+        auto start = std::chrono::steady_clock::now();
+        run();
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        best = i == 0 || ms < best ? ms : best;
+    }
+    return best;
+}
+
+int main(int argc, char* argv[]) {
+    size_t maxStatements = argc > 1 ? std::stoul(argv[1]) : 50000;
+
+    std::cout << std::setw(12) << "statements" << std::setw(10) << "blocks" << std::setw(14) << "lower ms"
+              << std::setw(14) << "cfg ms" << std::setw(16) << "cfg ns/stmt" << std::setw(14) << "direct ms" << std::endl;
+    for (size_t statements = maxStatements / 8; statements <= maxStatements; statements *= 2) {
+        LlPool pool;
+        LlPool::Scope poolScope(pool);
+        LlBuilder builder("bench");
+        double lowerMs = time_ms([&] {
+            LlBuilder scratch("bench");
+            lower_diamonds(scratch, statements);
+        });
+        lower_diamonds(builder, statements);
+        LlBuilder direct("bench");
+        direct.setBuildBlocks(true);
+        lower_diamonds(direct, statements);
+
+        size_t blocks = 0;
+        CFGBuilder cfgBuilder;
+        double cfgMs = time_ms([&] {
+            CFG* cfg = cfgBuilder.buildCFG(builder);
+            blocks = cfg->getBlocksList().size();
+            delete cfg;
+        });
+        double directMs = time_ms([&] {
+            delete cfgBuilder.buildCFG(direct);
+        });
+
+        std::cout << std::fixed << std::setprecision(2) << std::setw(12) << builder.size() << std::setw(10) << blocks
+                  << std::setw(14) << lowerMs << std::setw(14) << cfgMs << std::setw(16) << cfgMs * 1e6 / builder.size()
+                  << std::setw(14) << directMs << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,111 @@
+// CST traversal benchmark: a single initializer list of N elements is the widest
+// node tree-sitter-c produces. Indexed child access (ts_node_named_child) rescans the
+// siblings before each child and grows quadratically with N; the cursor walk used by
+// ASTBuilder::traverse_tree and the full AST build should both grow linearly.
+//
+// usage: bench_traversal [max-elements]   (default 100000, halved down to max/8)
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <functional>
+#include <tree_sitter/api.h>
+#include "ASTBuilder.h"
+#include "SourceBuffer.h"
+
+extern "C" const TSLanguage *tree_sitter_c();
+
+static std::string initializer_source(size_t elements) {
+    std::string source = "int a[] = {";
+    for (size_t i = 0; i < elements; i++) {
+        source += std::to_string(i % 1000);
+        source += ", ";
+    }
+    source += "0};\n";
+    return source;
+}
+
+// the traversal ASTBuilder used before: recursion over ts_node_named_child
+static size_t walk_indexed(TSNode node) {
+    size_t visited = 1;
+    uint32_t count = ts_node_named_child_count(node);
+    for (uint32_t i = 0; i < count; i++) {
+        visited += walk_indexed(ts_node_named_child(node, i));
+    }
+    return visited;
+}
+
+static size_t walk_cursor(TSNode node) {
+    TSTreeCursor cursor = ts_tree_cursor_new(node);
+    size_t visited = 0;
+    uint32_t depth = 0;
+    while (true) {
+        if (ts_node_is_named(ts_tree_cursor_current_node(&cursor))) {
+            visited++;
+        }
+        if (ts_tree_cursor_goto_first_child(&cursor)) {
+            depth++;
+            continue;
+        }
+        while (depth > 0 && !ts_tree_cursor_goto_next_sibling(&cursor)) {
+            ts_tree_cursor_goto_parent(&cursor);
+            depth--;
+        }
+        if (depth == 0) {
+            break;
+        }
+    }
+    ts_tree_cursor_delete(&cursor);
+    return visited;
+}
+
+// best of three runs, in milliseconds
+static double time_ms(const std::function<void()>& run) {
+    double best = 0;
+    for (int i = 0; i < 3; i++) {
+        auto start = std::chrono::steady_clock::now();
+        run();
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        best = i == 0 || ms < best ? ms : best;
+    }
+    return best;
+}
+
+int main(int argc, char* argv[]) {
+    size_t maxElements = argc > 1 ? std::stoul(argv[1]) : 100000;
+
+    TSParser* parser = ts_parser_new();
+    const TSLanguage* language = tree_sitter_c();
+    ts_parser_set_language(parser, language);
+
+    std::cout << std::setw(10) << "elements" << std::setw(14) << "indexed ms" << std::setw(14) << "cursor ms"
+              << std::setw(14) << "ast ms" << std::setw(16) << "ast ns/elem" << std::endl;
+    for (size_t elements = maxElements / 8; elements <= maxElements; elements *= 2) {
+        std::string source = initializer_source(elements);
+        TSTree* tree = ts_parser_parse_string(parser, nullptr, source.data(), source.size());
+        TSNode root = ts_tree_root_node(tree);
+
+        size_t indexedNodes = 0, cursorNodes = 0;
+        double indexedMs = time_ms([&] { indexedNodes = walk_indexed(root); });
+        double cursorMs = time_ms([&] { cursorNodes = walk_cursor(root); });
+        double astMs = time_ms([&] {
+            IrArena arena;
+            IrArena::Scope arenaScope(arena);
+            ASTBuilder builder(SourceBuffer::borrow(source), language);
+            builder.build(root);
+        });
+        if (indexedNodes != cursorNodes) {
+            std::cerr << "Error: walks disagree, " << indexedNodes << " vs " << cursorNodes << " nodes" << std::endl;
+            return 1;
+        }
+
+        std::cout << std::fixed << std::setprecision(2) << std::setw(10) << elements << std::setw(14) << indexedMs
+                  << std::setw(14) << cursorMs << std::setw(14) << astMs << std::setw(16) << astMs * 1e6 / elements << std::endl;
+        ts_tree_delete(tree);
+    }
+
+    ts_parser_delete(parser);
+    return 0;
+}
@@ -3,21 +3,80 @@
 #ifndef AST_BUILDER_H
 #define AST_BUILDER_H
 #include <stack>
+#include <string_view>
+#include <vector>
+#include <string>
+#include <unordered_set>
+#include <cstdint>
+#include <iostream>
+#include "SourceBuffer.h"
 #include "IrTransUnit.h"
 
-#include "main.h"
+class ASTBuilder;
 
+/// the name a function_definition node defines, empty if it has none (e.g. a macro-generated header)
+std::string_view function_definition_name(const TSNode& definition, const SourceBuffer& source);
+
+// What the ASTBuilder does for each grammar symbol, looked up by TSSymbol.
+// Built once per language from the symbol names, so regenerating tree-sitter-c
+// (which renumbers the symbols) needs no change here. A name the builder handles
+// but the grammar lacks is reported by throwing std::runtime_error.
+class CstDispatch {
+public:
+    typedef void (ASTBuilder::*Handler)(const TSNode&);
+
+    enum Flags : uint8_t {
+        OpensArray = 1,           // entering it raises the array nesting level
+        ClosesArray = 2,          // leaving it lowers the array nesting level
+        FunctionDefinition = 4,
+        TranslationUnit = 8
+    };
+
+    /// the table for a language, built on first use
+    static const CstDispatch& forLanguage(const TSLanguage* language);
+
+    /// @return nullptr for a symbol the builder does not handle
+    Handler handler(TSSymbol symbol) const {
+        return symbol < handlers.size() ? handlers[symbol] : nullptr;
+    }
+
+    uint8_t flags(TSSymbol symbol) const {
+        return symbol < symbolFlags.size() ? symbolFlags[symbol] : 0;
+    }
+
+private:
+    std::vector<Handler> handlers;
+    std::vector<uint8_t> symbolFlags;
+
+    explicit CstDispatch(const TSLanguage* language);
+};
 
 class ASTBuilder {
     private:
     std::stack<Ir*> ast_stack;
-    const std::string* source_code;
+    const SourceBuffer* source_code;
     const TSLanguage* language;
     Ir* root_node;
     int arraylevel = 0;
+    size_t visitedNodes = 0;
+    bool skipFunctions = false;
+    bool filterFunctions = false;
+    std::unordered_set<std::string> functionFilter;    // the function definitions to build when filtering
+    unsigned threads = 1;
+    // function definitions built ahead of the walk (buildFunctions), pushed in their place
+    std::vector<TSNode> prebuiltNodes;
+    std::vector<Ir*> prebuilt;
+    size_t nextPrebuilt = 0;
+    bool verbose;
+    std::ostream* traceOut = &std::cerr;   // where verbose traces the walk
+    const CstDispatch& dispatch;
+
+    void buildFunctions(const TSNode& unit);
+    bool wantsFunction(const TSNode& definition);
 public:
-    ASTBuilder(const string* source_code, const TSLanguage* language)
-        : source_code(source_code), language(language), ast_stack(),root_node(nullptr) {
+    ASTBuilder(const SourceBuffer* source_code, const TSLanguage* language, bool verbose = false)
+        : source_code(source_code), language(language), ast_stack(),root_node(nullptr),
+          verbose(verbose), dispatch(CstDispatch::forLanguage(language)) {
     }
 
     ~ASTBuilder() {
@@ -27,7 +86,8 @@ public:
     template <typename T>
     T* popFromStack(const TSNode& cst_node);
     
-    std::string getNodeText(const TSNode &cst_node);
+    /// text of a CST node as a view into the source buffer, copy it only when an Ir node keeps it
+    std::string_view getNodeText(const TSNode &cst_node);
 
     void exitIdentifier(const TSNode & cst_node);
     void exitPrimitiveType(const TSNode & cst_node);
@@ -73,22 +133,57 @@ public:
     void exitBreakStatement(const TSNode & cst_node);
     void exitCaseStatement(const TSNode & cst_node);
     void exitSwitchStatement(const TSNode & cst_node);
+    /// for named nodes that add nothing to the AST (comments, char_literal)
+    void ignoreNode(const TSNode &) {}
 
     void debugStackState() const;
 
+    /// leave function_definition subtrees out of the AST, so the unit holds only
+    /// globals, typedefs and macros; the functions can be built one at a time later
+    void setSkipFunctions(bool skip) { skipFunctions = skip; }
+
+    /// build only the function definitions with these names; the other bodies are
+    /// left out like with setSkipFunctions, prototypes and globals are kept
+    void setFunctionFilter(const std::vector<std::string>& names) {
+        functionFilter = std::unordered_set<std::string>(names.begin(), names.end());
+        filterFunctions = true;
+    }
+
+    /// build the function definitions of a translation unit on this many threads
+    /// (the calling one included) before the sequential walk over the globals;
+    /// 0 uses all hardware threads. Not used with verbose, which traces the walk.
+    void setThreads(unsigned threads) { this->threads = threads; }
+
+    /// where verbose writes its trace of the walk, stderr unless set
+    void setTraceStream(std::ostream& out) { traceOut = &out; }
+
+    /// number of CST nodes traversed so far
+    size_t getVisitedNodes() const { return visitedNodes; }
+
     void exitTransUnit(const TSNode & cst_node);
 
     void exit_cst_node(const TSNode & cst_node);
     void enter_cst_node(const TSNode & cst_node);
 
+    /// enter a named node the AST is built from
+    /// @return false if the node and its subtree are left out
+    bool visit_cst_node(const TSNode & cst_node);
+
     // travese the tree
     void traverse_tree(const TSNode & cursor);
 
-    /// build the AST, return the root node. The user should delete the returned pointer.
+    /// build the AST, return the root node. The nodes belong to the IrArena current while building.
     /// @param cst_root the root node of the CST
     /// @return the root node of the AST
     Ir* build(const TSNode &cst_root) {
+        if (threads != 1 && !skipFunctions && !verbose &&
+            (dispatch.flags(ts_node_symbol(cst_root)) & CstDispatch::TranslationUnit)) {
+            buildFunctions(cst_root);
+        }
         traverse_tree(cst_root);
+        prebuiltNodes.clear();
+        prebuilt.clear();
+        nextPrebuilt = 0;
         if (ast_stack.empty()) {
             std::cerr << "Error: AST stack is empty after traversal." << std::endl;
             return nullptr;
@@ -103,20 +198,19 @@ public:
 template <typename T>
 T* ASTBuilder::popFromStack(const TSNode& node) {
     if (this->ast_stack.empty()) {
-        throw std::runtime_error("Error: AST stack is empty while attempting to pop node:\n" + getNodeText(node));
+        throw std::runtime_error("Error: AST stack is empty while attempting to pop node:\n" + std::string(getNodeText(node)));
     }
 
     Ir* top = this->ast_stack.top();
     this->ast_stack.pop();
 
-    if (T* casted = dynamic_cast<T*>(top)) {
+    if (T* casted = dyn_cast<T>(top)) {
         return casted;
     } else {
         std::string errorMessage = "Error: Invalid type on AST stack.\n";
         errorMessage += "Expected type: " + std::string(typeid(T).name()) + "\n";
         errorMessage += "Actual type: " + std::string(typeid(*top).name()) + "\n";
-        errorMessage += "Node content: " + getNodeText(node) + "\n";
-        delete top; // Clean up the invalid node
+        errorMessage += "Node content: " + std::string(getNodeText(node)) + "\n";
         throw std::runtime_error(errorMessage);
     }
 }
@@ -0,0 +1,67 @@
+// Long-lived server mode answering analysis requests
+
+#ifndef ANALYSIS_SERVER_H
+#define ANALYSIS_SERVER_H
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <istream>
+#include <ostream>
+#include <ctime>
+#include <sys/stat.h>
+#include <memory>
+#include "IncrementalSession.h"
+#include "Json.h"
+
+// Lowered artifacts of one function, rendered to text
+struct FunctionArtifacts {
+    std::string name;
+    std::string ir;       // Ll IR and symbol table
+    std::string cfgDot;   // CFG before SSA conversion
+    std::string ssaDot;   // CFG after SSA conversion
+};
+
+// Keeps an IncrementalSession and the rendered results of every file it has
+// seen. When a file changes on disk it is diffed against the last version and
+// only the functions touching the change are re-analyzed and re-rendered.
+//
+// Protocol: one JSON object per line in, one JSON object per line out.
+//   {"id": 1, "file": "a.c", "function": "main", "artifacts": ["ir", "cfg", "ssa"]}
+//   {"id": 1, "ok": true, "file": "a.c", "cached": false, "functions": [{"name": "main", "ir": "...", ...}]}
+// "function" and "artifacts" are optional (default: every function, every artifact).
+// {"op": "shutdown"} stops the server, {"op": "drop", "file": ...} forgets a cached file.
+class AnalysisServer {
+private:
+    // results for one file, valid while the file's size and mtime stay the same
+    struct CachedFile {
+        off_t size = 0;
+        struct timespec mtime = {0, 0};
+        std::unique_ptr<IncrementalSession> session;
+        std::vector<FunctionArtifacts> functions;
+    };
+
+    std::unordered_map<std::string, CachedFile> cache;
+    bool running = true;
+
+    const CachedFile* lookup(const std::string& filename, bool& cached, std::string& error);
+    // (re)analyze a file whose cached results are stale; may throw, lookup catches
+    const CachedFile* analyze(const std::string& filename, const struct stat& st, std::string text, bool& cached, std::string& error);
+    // answer a parsed request; may throw, handleRequest catches
+    std::string handle(const JsonValue& request, const std::string& id);
+
+public:
+    AnalysisServer() {}
+
+    /// handle one request line, returns the response line (without newline)
+    std::string handleRequest(const std::string& line);
+
+    /// serve JSON lines until end of input or a shutdown request
+    void serve(std::istream& in, std::ostream& out);
+
+    /// listen on a Unix domain socket, serving one connection at a time
+    /// @return 0 on a clean shutdown, 1 if the socket could not be set up
+    int serveSocket(const std::string& socketPath);
+};
+
+#endif
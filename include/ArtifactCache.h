@@ -0,0 +1,43 @@
+// Content-addressed on-disk cache of analysis results
+
+#ifndef ARTIFACT_CACHE_H
+#define ARTIFACT_CACHE_H
+
+#include <string>
+#include <string_view>
+#include <map>
+#include <cstdint>
+
+// Named text sections of one cached result, e.g. "ir", "cfg", "ssa"
+typedef std::map<std::string, std::string> CacheEntry;
+
+// Stores CacheEntries as files named after a 64-bit key in one directory.
+// Keys are FNV-1a hashes of the inputs that produced the entry, so an entry
+// never needs invalidating: changed inputs simply hash to a different file.
+// Entries are written to a temporary file and renamed into place, so several
+// processes (or batch workers) can share a directory.
+class ArtifactCache {
+private:
+    std::string directory;
+
+    std::string pathFor(uint64_t key, const char* kind) const;
+
+public:
+    /// @param directory created if it does not exist
+    explicit ArtifactCache(const std::string& directory);
+
+    /// FNV-1a over text; pass a previous hash as seed to chain inputs
+    static uint64_t hash(std::string_view text, uint64_t seed = 0xcbf29ce484222325ULL);
+
+    static std::string toHex(uint64_t key);
+    static bool fromHex(const std::string& hex, uint64_t& key);
+
+    /// @param kind file extension separating entry types that share a key space
+    /// @return false on a miss or an unreadable entry
+    bool load(uint64_t key, const char* kind, CacheEntry& entry) const;
+
+    /// failures are reported and otherwise ignored, the cache is only an optimization
+    void store(uint64_t key, const char* kind, const CacheEntry& entry) const;
+};
+
+#endif
@@ -4,6 +4,7 @@
 #include <string>
 #include <vector>
 #include <unordered_set>
+#include "LlId.h"
 
 // Forward declarations
 class LlStatement;
@@ -11,13 +12,15 @@ class LlStatement;
 // Basic Block class representing a node in the CFG
 class BasicBlock {
 private:
-    std::string label;
+    mutable std::string label;      // "BB_" and the leader's label, rendered on first use
+    LlLabel leader;
     std::vector<LlStatement*> llStatements; 
     std::unordered_set<BasicBlock*> predecessors;
     std::unordered_set<BasicBlock*> successors;
 
 public:
     BasicBlock(const std::string& label) : label(label) {}
+    explicit BasicBlock(LlLabel leader) : leader(leader) {}
 
     void addSuccessor(BasicBlock* block) {
         successors.insert(block);
@@ -28,6 +31,9 @@ public:
     }
 
     const std::string& getLabel() const {
+        if (label.empty() && leader.isValid()) {
+            label = "BB_" + leader.toString();
+        }
         return label;
     }
 
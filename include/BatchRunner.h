@@ -0,0 +1,38 @@
+// Batch mode: many translation units in one process
+
+#ifndef BATCH_RUNNER_H
+#define BATCH_RUNNER_H
+
+#include <string>
+#include <vector>
+#include "Driver.h"
+
+/// Load the list of translation units for a batch run.
+/// A file whose name ends in ".json" is read as a compile_commands.json database,
+/// anything else as a plain list with one path per line ('#' starts a comment).
+/// @return the source files, or an empty vector if the list could not be read
+std::vector<std::string> load_batch_inputs(const std::string& listPath);
+
+// Spreads translation units over a fixed pool of worker threads.
+// Each worker owns a Driver (and with it a TSParser and all builders), and
+// pulls the next unanalyzed file from a shared counter, so long files do not
+// hold up the rest of the queue.
+class BatchRunner {
+private:
+    DriverOptions options;
+    unsigned jobs;
+    std::string outputDir;
+
+    std::string outputFileFor(size_t index, const std::string& filename) const;
+
+public:
+    /// @param jobs number of worker threads, 0 means one per hardware thread
+    /// @param outputDir directory receiving the per-TU outputs
+    BatchRunner(const DriverOptions& options, unsigned jobs, const std::string& outputDir);
+
+    /// analyze all files; returns the number of translation units that failed
+    /// @param stats if not null, receives the statistics of each file, in input order
+    int run(const std::vector<std::string>& files, std::vector<FileStats>* stats = nullptr);
+};
+
+#endif
@@ -0,0 +1,82 @@
+// Per-function analysis budgets (--function-timeout-ms, --function-memory-mb)
+
+#ifndef BUDGET_H
+#define BUDGET_H
+
+#include <chrono>
+#include <cstdint>
+#include "Stats.h"
+
+// Limits for the lowering, CFG and SSA work spent on one function; 0 means unlimited.
+// Memory is counted as bytes allocated by the analyzing thread, not as resident size.
+struct BudgetLimits {
+    double timeMs = 0;
+    uint64_t allocatedBytes = 0;
+
+    bool unlimited() const { return timeMs == 0 && allocatedBytes == 0; }
+};
+
+// How much of a function's analysis was given up because it ran over its budget
+enum class Degradation {
+    None,
+    CfgOnly,    // CFG emitted, no SSA
+    Skipped     // lowered, but no CFG or SSA
+};
+
+inline const char* degradation_name(Degradation degradation) {
+    switch (degradation) {
+        case Degradation::CfgOnly: return "cfg-only";
+        case Degradation::Skipped: return "skipped";
+        default: return "";
+    }
+}
+
+// What one function has used so far. The phases of a function may run far apart
+// (the whole unit is lowered before any CFG is built), so each one is charged
+// separately with a Charge scope and the budget is checked between phases.
+// A phase that is already running is only interrupted where it checks deadline().
+class FunctionBudget {
+private:
+    const BudgetLimits* limits;
+    double usedMs = 0;
+    uint64_t usedBytes = 0;
+
+public:
+    explicit FunctionBudget(const BudgetLimits& limits) : limits(&limits) {}
+
+    bool exceeded() const {
+        return (limits->timeMs > 0 && usedMs >= limits->timeMs) ||
+               (limits->allocatedBytes > 0 && usedBytes >= limits->allocatedBytes);
+    }
+
+    /// the point in time at which a phase starting now uses up the time left
+    std::chrono::steady_clock::time_point deadline() const {
+        if (limits->timeMs == 0) {
+            return std::chrono::steady_clock::time_point::max();
+        }
+        double leftMs = usedMs < limits->timeMs ? limits->timeMs - usedMs : 0;
+        return std::chrono::steady_clock::now() + std::chrono::microseconds(static_cast<int64_t>(leftMs * 1000));
+    }
+
+    // Charges the enclosing scope's wall time and allocations to a budget
+    class Charge {
+    private:
+        FunctionBudget* budget;
+        std::chrono::steady_clock::time_point start;
+        uint64_t bytesStart;
+
+    public:
+        explicit Charge(FunctionBudget& budget)
+            : budget(&budget), start(std::chrono::steady_clock::now()), bytesStart(thread_allocated_bytes()) {}
+
+        ~Charge() {
+            budget->usedMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            budget->usedBytes += thread_allocated_bytes() - bytesStart;
+        }
+
+        Charge(const Charge&) = delete;
+        Charge& operator=(const Charge&) = delete;
+    };
+};
+
+#endif
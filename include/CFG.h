@@ -3,6 +3,7 @@
 
 #include "LlBuilder.h"
 #include "BasicBlock.h"
+#include "Trace.h"
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
@@ -10,6 +11,7 @@
 #include <sstream>
 #include <fstream>
 #include <algorithm>
+#include <chrono>
 
 
 // Control Flow Graph class
@@ -17,15 +19,24 @@ class CFG {
 private:
     BasicBlock* entry;
     BasicBlock* exit;
-    std::unordered_map<std::string, BasicBlock*> blocks;
+    // blocks by label, filled in from blocksList when a lookup or a dump needs it,
+    // so that block labels are only rendered then
+    mutable std::unordered_map<std::string, BasicBlock*> blocks;
+    mutable size_t indexedBlocks = 0;
     std::vector<BasicBlock*> blocksList;
 
+    void indexBlocks() const {
+        for (; indexedBlocks < blocksList.size(); indexedBlocks++) {
+            blocks[blocksList[indexedBlocks]->getLabel()] = blocksList[indexedBlocks];
+        }
+    }
+
 public:
     CFG() : entry(nullptr), exit(nullptr) {}
     
     ~CFG() {
-        for (auto& pair : blocks) {
-            delete pair.second;
+        for (BasicBlock* block : blocksList) {
+            delete block;
         }
     }
 
@@ -62,7 +73,6 @@ public:
     }
 
     void addBlock(BasicBlock* block) {
-        blocks[block->getLabel()] = block;
         blocksList.push_back(block);
     }
 
@@ -71,6 +81,7 @@ public:
     }   
 
     BasicBlock* getBlock(const std::string& label) {
+        indexBlocks();
         auto it = blocks.find(label);
         if (it != blocks.end()) {
             return it->second;
@@ -87,11 +98,12 @@ public:
     }
 
     const std::unordered_map<std::string, BasicBlock*>& getBlocks() const {
+        indexBlocks();
         return blocks;
     }
 
-    std::string toString() {
-        std::stringstream ss;
+    void print(std::ostream& ss) const {
+        indexBlocks();
         ss << "Control Flow Graph:\n";
         
         for (const auto& pair : blocks) {
@@ -101,7 +113,7 @@ public:
             
             ss << "  Instructions:\n ";
             for (const auto& inst : block->getLlStatements()) {
-                ss << inst->toString() << std::endl;
+                ss << *inst << std::endl;
             }
             ss << "\n";
             
@@ -117,13 +129,17 @@ public:
             }
             ss << "\n-----------------------------------\n\n";
         }
-        
+    }
+
+    std::string toString() const {
+        std::stringstream ss;
+        print(ss);
         return ss.str();
     }
 
-    // generate a dot file for the CFG
-    std::string generateDotFile() const {
-        std::stringstream dot;
+    // write the DOT representation of the CFG to a stream
+    void writeDot(std::ostream& dot) const {
+        indexBlocks();
         dot << "digraph CFG {\n";
         dot << "    node [shape=box];\n\n";
         
@@ -154,6 +170,12 @@ public:
         }
         
         dot << "}\n";
+    }
+
+    // generate a dot file for the CFG
+    std::string generateDotFile() const {
+        std::stringstream dot;
+        writeDot(dot);
         return dot.str();
     }
 
@@ -161,7 +183,7 @@ public:
     void writeDotFile(const std::string& filename) const {
         std::ofstream outFile(filename);
         if (outFile.is_open()) {
-            outFile << generateDotFile();
+            writeDot(outFile);
             outFile.close();
         }
     }
@@ -170,34 +192,34 @@ public:
 // CFGBuilder class to construct a CFG from an LlBuilder
 class CFGBuilder {
 private:
-    // Helper function to identify leaders (first instruction of a basic block)
-    std::unordered_set<std::string> identifyLeaders(LlBuilder& builder) {
-        std::unordered_set<std::string> leaders;
-        const auto& statementTable = builder.getStatementTable();
-        const auto& insertionOrder = builder.getInsertionOrder(); 
+    // Helper function to identify leaders (first instruction of a basic block);
+    // leaders[i] is set if statement i starts a block
+    std::vector<bool> identifyLeaders(const LlBuilder& builder) {
+        const std::vector<LlStatement*>& statements = builder.getStatements();
+        std::vector<bool> leaders(statements.size(), false);
 
         // First instruction is always a leader
-        if (!insertionOrder.empty()) {
-            leaders.insert(insertionOrder[0]);
+        if (!statements.empty()) {
+            leaders[0] = true;
         }
         
         // Targets of jumps and instructions following jumps are leaders
-        for (size_t i = 0; i < insertionOrder.size(); i++) {
-            const std::string& label = insertionOrder[i];
-            LlStatement* stmt = statementTable.at(label);
+        for (size_t i = 0; i < statements.size(); i++) {
+            LlStatement* stmt = statements[i];
             
             // Check if this is a jump instruction
             if (stmt->isJump()) {
-                // If there's a target label, it's a leader
-                LlJump* jumpStmt = dynamic_cast<LlJump*>(stmt);
-                std::string* targetLabel = jumpStmt->getJumpToLabel();
-                if (targetLabel) {
-                    leaders.insert(*targetLabel);
-                }
+                // If there's a target label, it's a leader (a switch has several)
+                for_each_jump_target(cast<LlJump>(stmt), [&](LlLabel label) {
+                    size_t target = builder.indexOf(label);
+                    if (target != LlBuilder::npos) {
+                        leaders[target] = true;
+                    }
+                });
                 
                 // Instruction after a jump is a leader (if it exists)
-                if (i + 1 < insertionOrder.size()) {
-                    leaders.insert(insertionOrder[i + 1]);
+                if (i + 1 < statements.size()) {
+                    leaders[i + 1] = true;
                 }
             }
         }
@@ -205,65 +227,110 @@ private:
         return leaders;
     }
 
+    static void connect(BasicBlock* from, BasicBlock* to) {
+        from->addSuccessor(to);
+        to->addPredecessor(from);
+    }
+
+    // Set entry and exit blocks: blocks with no successors are connected to an exit block
+    static void addEntryAndExit(CFG* cfg) {
+        const std::vector<BasicBlock*>& blocksList = cfg->getBlocksList();
+        if (blocksList.empty()) {
+            return;
+        }
+        cfg->setEntry(blocksList[0]);
+
+        BasicBlock* exitBlock = new BasicBlock("EXIT");
+        cfg->addBlock(exitBlock);
+        cfg->setExit(exitBlock);
+
+        for (BasicBlock* const block: cfg->getBlocksList()) {
+            if (block != exitBlock && block->getSuccessors().empty()) {
+                connect(block, exitBlock);
+            }
+        }
+    }
+
+    // the blocks the builder recorded while lowering, with no pass to find the leaders
+    CFG* buildFromBlocks(const LlBuilder& builder) {
+        CFG* cfg = new CFG();
+        const std::vector<LlStatement*>& statements = builder.getStatements();
+        const std::vector<LlLabel>& labels = builder.getInsertionOrder();
+        const std::vector<uint32_t>& starts = builder.getBlockStarts();
+
+        for (size_t i = 0; i < starts.size(); i++) {
+            BasicBlock* block = new BasicBlock(labels[starts[i]]);
+            size_t end = i + 1 < starts.size() ? starts[i + 1] : statements.size();
+            block->getLlStatements().assign(statements.begin() + starts[i], statements.begin() + end);
+            cfg->addBlock(block);
+        }
+
+        const std::vector<BasicBlock*>& blocksList = cfg->getBlocksList();
+        for (const auto& jump : builder.getBlockJumps()) {
+            connect(blocksList[jump.first], blocksList[jump.second]);
+        }
+        for (size_t i = 0; i < starts.size(); i++) {
+            if (builder.fallsThrough(i) && i + 1 < starts.size()) {
+                connect(blocksList[i], blocksList[i + 1]);
+            }
+        }
+
+        addEntryAndExit(cfg);
+        return cfg;
+    }
+
 public:
-    CFG* buildCFG(LlBuilder& builder) {
+    // take the blocks the builder recorded if it did (LlBuilder::setBuildBlocks), otherwise
+    // one pass to find the leaders, one to fill the blocks and one to connect them
+    CFG* buildCFG(const LlBuilder& builder) {
+        if (builder.hasBlocks()) {
+            return buildFromBlocks(builder);
+        }
+
         CFG* cfg = new CFG();
+        const std::vector<LlStatement*>& statements = builder.getStatements();
+        const std::vector<LlLabel>& labels = builder.getInsertionOrder();
         
         // Identify leaders (first instruction of each basic block)
-        std::unordered_set<std::string> leaders = identifyLeaders(builder);
+        std::vector<bool> leaders = identifyLeaders(builder);
         
-        // Create basic blocks for each leader and add instructions to them
+        // Create basic blocks for each leader and add instructions to them;
+        // blockOf[i] is the block that statement i ended up in
+        std::vector<BasicBlock*> blockOf(statements.size(), nullptr);
         BasicBlock* currentBlock = nullptr;
-        for (const std::string& label : builder.getInsertionOrder()) {
-            LlStatement* stmt = builder.getStatementTable().at(label);
-            if (leaders.find(label) != leaders.end()) {
-                currentBlock = new BasicBlock("BB_" + label);
+        for (size_t i = 0; i < statements.size(); i++) {
+            if (leaders[i]) {
+                currentBlock = new BasicBlock(labels[i]);
                 cfg->addBlock(currentBlock);
             }
-            currentBlock->addLlStatement(stmt);
+            currentBlock->addLlStatement(statements[i]);
+            blockOf[i] = currentBlock;
         }
 
         // connect the blocks 
-        std::vector<BasicBlock*> blocksList = cfg->getBlocksList();
-        for (int i = 0; i < blocksList.size(); i++) {
+        const std::vector<BasicBlock*>& blocksList = cfg->getBlocksList();
+        for (size_t i = 0; i < blocksList.size(); i++) {
             BasicBlock* block = blocksList[i];
             LlStatement* lastStmt = block->getLlStatements().back();
             if (lastStmt->isJump()) {
-                LlJump* jumpStmt = dynamic_cast<LlJump*>(lastStmt);
-                std::string* targetLabel = jumpStmt->getJumpToLabel();
-                if (targetLabel) {
-                    block->addSuccessor(cfg->getBlock("BB_" + *targetLabel));
-                    cfg->getBlock("BB_" + *targetLabel)->addPredecessor(block);
-                }
+                LlJump* jumpStmt = cast<LlJump>(lastStmt);
+                for_each_jump_target(jumpStmt, [&](LlLabel label) {
+                    size_t target = builder.indexOf(label);
+                    if (target != LlBuilder::npos) {
+                        connect(block, blockOf[target]);
+                    }
+                });
                 if (jumpStmt->isConditionalJump() && i + 1 < blocksList.size()){
                     // add the next block as a successor
-                    block->addSuccessor(blocksList[i+1]);
-                    blocksList[i+1]->addPredecessor(block);
+                    connect(block, blocksList[i+1]);
                 }
             }
             else if (i + 1 < blocksList.size()) {
-                block->addSuccessor(blocksList[i+1]);
-                blocksList[i+1]->addPredecessor(block);
-            }
-        }
-
-        // Set entry and exit blocks
-        if (!blocksList.empty()) {
-            cfg->setEntry(blocksList[0]);
-
-            // Find blocks with no successors and connect them to an exit block
-            BasicBlock* exitBlock = new BasicBlock("EXIT");
-            cfg->addBlock(exitBlock);
-            cfg->setExit(exitBlock);
-
-            for (BasicBlock* const block: cfg->getBlocksList()) {
-                if (block != exitBlock && block->getSuccessors().empty()) {
-                    block->addSuccessor(exitBlock);
-                    exitBlock->addPredecessor(block);
-                }
+                connect(block, blocksList[i+1]);
             }
         }
 
+        addEntryAndExit(cfg);
         return cfg;
     }
 };
@@ -276,10 +343,24 @@ private:
     std::unordered_map<BasicBlock*, std::vector<BasicBlock*>> domTree; // dominator tree
     std::vector<BasicBlock*> postOrder;
     std::unordered_map<BasicBlock*, int>  postOrderNumbers;
-    std::unordered_map<std::string, int> variableVersions;
-    std::unordered_map<std::string, std::stack<int>> variableStack;
+    // keyed by the interned name of each variable, see LlLocation::getSymbol
+    std::unordered_map<SymbolId, int> variableVersions;
+    std::unordered_map<SymbolId, std::stack<int>> variableStack;
+    std::ostream* out;
+    std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();
+
+    bool pastDeadline() const {
+        return deadline != std::chrono::steady_clock::time_point::max() && std::chrono::steady_clock::now() >= deadline;
+    }
 
 public:
+    SSAGenerator(std::ostream& out = std::cout) : out(&out) {}
+
+    /// give up converting once this point in time has passed, see convertToSSA
+    void setDeadline(std::chrono::steady_clock::time_point deadline) {
+        this->deadline = deadline;
+    }
+
     // getIdoms
     std::unordered_map<BasicBlock*, BasicBlock*> getIdoms() {
         return idoms;
@@ -296,7 +377,8 @@ public:
     }
 
     // Compute dominance tree using Cooper, Harvey, Kennedy algorithm
-    void computeDominators(CFG* cfg) {
+    // @return false if the deadline passed before the fixpoint was reached
+    bool computeDominators(CFG* cfg) {
     // for all nodes, b  /* 初始化支配者数组 */
     //     idoms[b] ← Undefined
     // idoms[start_node] ← start_node
@@ -327,6 +409,9 @@ public:
         
         bool changed = true;
         while (changed) {
+            if (pastDeadline()) {
+                return false;
+            }
             changed = false;
             
             // iterate blocks in reverse postorder
@@ -352,6 +437,7 @@ public:
                 }
             }
         }
+        return true;
     }
 
 // function intersect(b1, b2) returns node
@@ -387,6 +473,11 @@ public:
         for (BasicBlock* block : cfg->getBlocksList()) {
             if (block->getPredecessors().size() >= 2) {
                 for (BasicBlock* pred : block->getPredecessors()) {
+                    // a predecessor the entry does not reach (a case no switch value
+                    // selects, code after a jump) has no dominators to walk up
+                    if (idoms[pred] == nullptr) {
+                        continue;
+                    }
                     BasicBlock* runner = pred;
                     const auto& idom = idoms[block];
                     while (idom != runner) {
@@ -432,30 +523,35 @@ public:
         // 27  }
 
         std::unordered_set<BasicBlock*> worklist;
-        std::unordered_map<BasicBlock*, std::string> inserted;
-        std::unordered_map<BasicBlock*, std::string> inWorklist;
+        std::unordered_map<BasicBlock*, SymbolId> inserted;
+        std::unordered_map<BasicBlock*, SymbolId> inWorklist;
 
         for (BasicBlock* block : cfg->getBlocksList()) {
-            inserted[block] = "";
-            inWorklist[block] = "";
+            inserted[block] = NoSymbol;
+            inWorklist[block] = NoSymbol;
         }
 
-        std::unordered_set<std::string> variables;
-        std::unordered_map<std::string, std::unordered_set<BasicBlock*>> variableBlocks;
+        // in order of first definition, so phis come out in the same order every run
+        std::vector<SymbolId> variables;
+        std::unordered_map<SymbolId, std::unordered_set<BasicBlock*>> variableBlocks;
 
         // get all variables in the program
         for (BasicBlock* block : cfg->getBlocksList()) {
             for (LlStatement* stmt : block->getLlStatements()) {
-                std::string* def = stmt->getDefinedVariable();
-                // def is not start with #, which means it is a variable
-                if (def && def->at(0) != '#') {
-                    variables.insert(*def);
-                    variableBlocks[*def].insert(block);
+                LlLocation* def = stmt->getDefinedVariable();
+                // temps define no variable, see LlAssignStmt
+                if (def && def->getSymbol() != NoSymbol) {
+                    SymbolId var = def->getSymbol();
+                    auto& blocks = variableBlocks[var];
+                    if (blocks.empty()) {
+                        variables.push_back(var);
+                    }
+                    blocks.insert(block);
                 }
             }
         }
 
-        for (const auto& var : variables) {
+        for (SymbolId var : variables) {
             for (BasicBlock* block : variableBlocks[var]) {
                 inWorklist[block] = var;
                 worklist.insert(block);
@@ -492,10 +588,11 @@ public:
         // Initialize stacks for each variable
         for (BasicBlock* block : cfg->getBlocksList()) {
             for (LlStatement* stmt : block->getLlStatements()) {
-                std::string* def = stmt->getDefinedVariable();
-                if (def && def->at(0) != '#') {
-                    variableStack[*def] = std::stack<int>();
-                    variableVersions[*def] = 0;
+                LlLocation* def = stmt->getDefinedVariable();
+                if (def && def->getSymbol() != NoSymbol) {
+                    SymbolId var = def->getSymbol();
+                    variableStack[var] = std::stack<int>();
+                    variableVersions[var] = 0;
                 }
             }
         }
@@ -504,36 +601,46 @@ public:
         renameVariablesInBlock(cfg->getEntry());
     }
 
+    /// the variable of location, NoSymbol for locations that are not renamed variables
+    SymbolId renamedVariable(const LlLocation* location) const {
+        SymbolId var = location->getSymbol();
+        return var != NoSymbol && variableVersions.count(var) ? var : NoSymbol;
+    }
+
     void renameVariablesInBlock(BasicBlock* block) {
+        // the variables given a new version here, their stacks are popped on the way out
+        std::vector<SymbolId> defined;
 
         // For each phi function in block
         for (LlStatement* stmt : block->getLlStatements()) {
-            if (auto phi = dynamic_cast<LlPhiStatement*>(stmt)) {
-                std::string* def = phi->getDefinedVariable();
-                if (def && def->at(0) != '#') {
-                    int newVersion = variableVersions[*def]++;
-                    variableStack[*def].push(newVersion);
-                    phi->renameDef(*def, *def + "_" + std::to_string(newVersion));
-                }
+            if (auto phi = dyn_cast<LlPhiStatement>(stmt)) {
+                SymbolId var = phi->getVariable();
+                int newVersion = variableVersions[var]++;
+                variableStack[var].push(newVersion);
+                defined.push_back(var);
+                phi->setVersion(newVersion);
             }
         }
 
         // For each regular statement in block
         for (LlStatement* stmt : block->getLlStatements()) {
-            if (dynamic_cast<LlPhiStatement*>(stmt) == nullptr) {
+            if (!isa<LlPhiStatement>(stmt)) {
                 // Rename uses
-                for (std::string* use : stmt->getUsedVariables()) {
-                    if (!variableStack[*use].empty()) {
-                        stmt->renameUse(*use, *use + "_" + std::to_string(variableStack[*use].top()));
+                for (LlLocation* use : stmt->getUsedVariables()) {
+                    SymbolId var = renamedVariable(use);
+                    if (var != NoSymbol && !variableStack[var].empty()) {
+                        use->setVersion(variableStack[var].top());
                     }
                 }
                 
                 // Rename definition
-                std::string* def = stmt->getDefinedVariable();
-                if (def && def->at(0) != '#') {
-                    int newVersion = variableVersions[*def]++;
-                    variableStack[*def].push(newVersion);
-                    stmt->renameDef(*def, *def + "_" + std::to_string(newVersion));
+                LlLocation* def = stmt->getDefinedVariable();
+                SymbolId var = def ? renamedVariable(def) : NoSymbol;
+                if (var != NoSymbol) {
+                    int newVersion = variableVersions[var]++;
+                    variableStack[var].push(newVersion);
+                    defined.push_back(var);
+                    def->setVersion(newVersion);
                 }
             }
         }
@@ -542,15 +649,11 @@ public:
         for (BasicBlock* succ : block->getSuccessors()) {
             // Fill in phi function parameters in successor
             for (LlStatement* stmt : succ->getLlStatements()) {
-                if (auto phi = dynamic_cast<LlPhiStatement*>(stmt)) {
-                    std::string* phiVar = phi->getDefinedVariable();
-                    std::string* var = new std::string(phiVar->substr(0, phiVar->find("_")));
-                    if (phiVar && !variableStack[*var].empty()) {
+                if (auto phi = dyn_cast<LlPhiStatement>(stmt)) {
+                    SymbolId var = phi->getVariable();
+                    if (!variableStack[var].empty()) {
                         // Set the incoming value from this predecessor
-                        phi->setIncoming(
-                            new std::string(*var + "_" + std::to_string(variableStack[*var].top())),
-                            block
-                        );
+                        phi->setIncoming(variableStack[var].top(), block);
                     }
                 }
             }
@@ -564,11 +667,8 @@ public:
         }
 
         // Restore stacks by popping variables defined in this block
-        for (LlStatement* stmt : block->getLlStatements()) {
-            std::string* def = stmt->getDefinedVariable();
-            if (def && def->at(0) != '#' && !variableStack[*def].empty()) {
-                variableStack[*def].pop();
-            }
+        for (SymbolId var : defined) {
+            variableStack[var].pop();
         }
     }
 
@@ -589,29 +689,29 @@ public:
 
     // Print dominator tree in a tree-like format
     void printDominatorTree(CFG* cfg) {
-        std::cout << "\nDominator Tree Structure:" << std::endl;
+        *out << "\nDominator Tree Structure:" << std::endl;
         printDominatorTreeNode(cfg->getEntry(), 0);
     }
 
     // output the immediate dominators
     void printIdoms(){
-        std::cout << "\nImmediate Dominators:" << std::endl;
+        *out << "\nImmediate Dominators:" << std::endl;
         for (const auto& pair : idoms) {
             if (pair.second != nullptr) {
-                std::cout << pair.first->getLabel() << " -> " << pair.second->getLabel() << std::endl;
+                *out << pair.first->getLabel() << " -> " << pair.second->getLabel() << std::endl;
             }
         }
     }
 
     // output the dominance frontier
     void printDominanceFrontier() {
-        std::cout << "\nDominance Frontier:" << std::endl;
+        *out << "\nDominance Frontier:" << std::endl;
         for (const auto& pair : dominanceFrontier) {
-            std::cout << pair.first->getLabel() << " -> ";
+            *out << pair.first->getLabel() << " -> ";
             for (const auto &dfBlock: pair.second) {
-                std::cout << dfBlock->getLabel() << " ";
+                *out << dfBlock->getLabel() << " ";
             }
-            std::cout << std::endl;
+            *out << std::endl;
         }
     }
 
@@ -619,7 +719,7 @@ private:
     void printDominatorTreeNode(BasicBlock* block, int depth) {
         // Print current node with proper indentation
         std::string indent(depth * 2, ' ');
-        std::cout << indent << block->getLabel() << std::endl;
+        *out << indent << block->getLabel() << std::endl;
         
         // Recursively print children
         for (BasicBlock* child : domTree[block]) {
@@ -628,25 +728,56 @@ private:
     }
 
 public:
-    void convertToSSA(CFG* cfg) {
+    /// @return false if the deadline passed first; the CFG is then left unchanged
+    bool convertToSSA(CFG* cfg) {
+        // Forget the previous function, its blocks must not show up in this one's dumps
+        dominanceFrontier.clear();
+        idoms.clear();
+        domTree.clear();
+        postOrderNumbers.clear();
+        variableVersions.clear();
+        variableStack.clear();
+
         // Step 1: Compute dominators
-        computeDominators(cfg);
+        {
+            TraceScope scope("dominators");
+            if (!computeDominators(cfg)) {
+                return false;
+            }
+        }
         printIdoms();
 
         // Build and print dominator tree
-        buildDominatorTree(cfg);
+        {
+            TraceScope scope("dominator tree");
+            buildDominatorTree(cfg);
+        }
 
         // Step 2: Compute dominance frontier
-        computeDominanceFrontier(cfg);
+        {
+            TraceScope scope("dominance frontier");
+            computeDominanceFrontier(cfg);
+        }
+
+        // the last chance to give up, phi insertion and renaming rewrite the CFG
+        if (pastDeadline()) {
+            return false;
+        }
 
         // Step 3: Insert phi functions
-        insertPhiFunctions(cfg);
+        {
+            TraceScope scope("phi insertion");
+            insertPhiFunctions(cfg);
+        }
 
         printDominanceFrontier();
 
         // Step 4: Rename variables
-        renameVariables(cfg);
-
+        {
+            TraceScope scope("renaming");
+            renameVariables(cfg);
+        }
+        return true;
     }
 };
 
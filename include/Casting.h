@@ -0,0 +1,49 @@
+// LLVM-style isa<>, cast<> and dyn_cast<> over the kind tags of Ir and Ll nodes
+
+#ifndef CASTING_H
+#define CASTING_H
+
+#include <cassert>
+#include <type_traits>
+#include <utility>
+
+// Reaches a To below a virtual base From, where static_cast is ill-formed.
+// Specialized by hierarchies with virtual bases (Ir, in Ir.h).
+template <typename From>
+struct VirtualDownCast;
+
+template <typename To, typename From, typename = void>
+struct DownCast {
+    static To* cast(From* value) { return VirtualDownCast<From>::template cast<To>(value); }
+};
+
+template <typename To, typename From>
+struct DownCast<To, From, std::void_t<decltype(static_cast<To*>(std::declval<From*>()))>> {
+    static To* cast(From* value) { return static_cast<To*>(value); }
+};
+
+template <typename To, typename From>
+using CastResult = std::conditional_t<std::is_const_v<From>, const To*, To*>;
+
+/// @return whether value is a To, decided by To::classof on the node's kind
+/// unlike LLVM's, accepts nullptr (and says no) the way dynamic_cast does
+template <typename To, typename From>
+inline bool isa(From* value) {
+    return value && To::classof(value);
+}
+
+/// value as a To; value must be one
+template <typename To, typename From>
+inline CastResult<To, From> cast(From* value) {
+    assert(isa<To>(value) && "cast<> to a class the node is not an instance of");
+    using Mutable = std::remove_const_t<From>;
+    return DownCast<To, Mutable>::cast(const_cast<Mutable*>(value));
+}
+
+/// @return value as a To, or nullptr if it is not one (or is nullptr)
+template <typename To, typename From>
+inline CastResult<To, From> dyn_cast(From* value) {
+    return isa<To>(value) ? cast<To>(value) : nullptr;
+}
+
+#endif
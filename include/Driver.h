@@ -0,0 +1,74 @@
+// Pipeline driver for a single translation unit
+
+#ifndef DRIVER_H
+#define DRIVER_H
+
+#include <string>
+#include <ostream>
+#include <vector>
+#include <tree_sitter/api.h>
+#include "SourceBuffer.h"
+#include "ArtifactCache.h"
+#include "Stats.h"
+#include "OutputSink.h"
+#include "Budget.h"
+#include "HeaderCache.h"
+
+// Which artifacts a run should produce, resolved once from the command line
+struct DriverOptions {
+    bool verbose = false;
+    bool outputCst = false;
+    bool intermedial = false;
+    bool cfg = false;
+    bool ssa = false;
+    bool stream = false;    // process and free one function at a time, see analyzeStreaming
+    bool noTeardown = false;    // leave the AST and Ll IR to the exiting process instead of freeing them
+    unsigned astThreads = 1;    // threads building a file's function ASTs, 0 = all hardware threads
+    std::string cacheDir;   // empty disables the on-disk artifact cache
+    std::vector<std::string> includePaths;  // -I directories; empty leaves #include unresolved
+    bool expandMacros = false;  // expand #define macros in the source before parsing it
+    std::vector<std::string> functions;     // build and analyze only these function definitions, empty = all
+    uint64_t parseTimeoutMs = 0;    // 0 = no limit; a file that takes longer is skipped
+    BudgetLimits functionBudget;    // a function over it loses its SSA, or its CFG and SSA
+    bool recordBlocks = true;   // record basic blocks while lowering, false = CFGBuilder's leader pass finds them
+};
+
+// Runs parse -> AST -> Ll IR -> CFG -> SSA for one file at a time.
+// Every Driver owns its own TSParser, so one Driver per thread is safe.
+class Driver {
+private:
+    TSParser* parser;
+    const TSLanguage* language;
+    DriverOptions options;
+    ArtifactCache* cache = nullptr;
+    std::string sourceDir;  // of the file being analyzed, where "header.h" is looked up first
+    MacroExpander macroExpander;    // keeps its memoized expansions from file to file
+
+    /// the file's text with its macros expanded, source_code itself if it uses none
+    SourceBuffer* expandMacros(SourceBuffer* source_code, FileStats* stats);
+
+    /// the headers a file includes, through the process-wide HeaderCache; none without -I
+    std::vector<const HeaderUnit*> loadHeaders(const std::vector<IncludeDirective>& includes, FileStats* stats);
+    /// @return nullptr (after reporting it) if the parse ran out of time
+    TSTree* parse(SourceBuffer* source_code, FileStats* stats);
+    int analyzeSource(SourceBuffer* source_code, OutputSink& sink, FileStats* stats);
+    int analyzeStreaming(SourceBuffer* source_code, OutputSink& sink, FileStats* stats);
+    int analyzeCached(SourceBuffer* source_code, OutputSink& sink, FileStats* stats);
+    void emitCached(CacheEntry& globals, std::vector<CacheEntry>& functions, OutputSink& sink);
+
+public:
+    Driver(const DriverOptions& options);
+    ~Driver();
+
+    Driver(const Driver&) = delete;
+    Driver& operator=(const Driver&) = delete;
+
+    /// analyze one translation unit
+    /// @param filename the C file to read
+    /// @param sink receives the textual output (AST, IR, dominator info) and the DOT artifacts (cst.dot, cfg0.dot, ...)
+    /// @param stats if not null, receives per-phase and per-function statistics
+    /// @return 0 on success, non-zero if the file could not be processed
+    int analyzeFile(const std::string& filename, OutputSink& sink, FileStats* stats = nullptr);
+};
+
+#endif
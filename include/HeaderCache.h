@@ -0,0 +1,96 @@
+// Process-wide cache of parsed and lowered #include headers (-I)
+
+#ifndef HEADER_CACHE_H
+#define HEADER_CACHE_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <map>
+#include <set>
+#include <memory>
+#include <mutex>
+#include <cstdint>
+#include <tree_sitter/api.h>
+#include "IrArena.h"
+#include "LlBuilder.h"
+#include "SymbolTable.h"
+#include "SourceBuffer.h"
+#include "MacroExpander.h"
+
+class IrTransUnit;
+
+// An #include as written: the header name without its quotes or angle brackets
+struct IncludeDirective {
+    std::string name;
+    bool system;
+};
+
+/// the includes of a unit in source order
+std::vector<IncludeDirective> include_directives(const IrTransUnit* unit);
+
+// One header, parsed and lowered like the globals of a translation unit.
+// Its AST, Ll IR and symbol table live as long as the process, so every unit
+// that includes the header can share them read-only.
+struct HeaderUnit {
+    std::string path;
+    uint64_t hash = 0;          // of the content
+    std::unique_ptr<SourceBuffer> source;
+    IrArena arena;
+    LlPool pool;
+    IrTransUnit* unit = nullptr;
+    LlBuilder builder;          // the header's own global code, not that of its includes
+    SymbolTable symbolTable;    // the header's typedefs and globals, and those of its includes
+    MacroTable macros;          // defined by the end of the header, its includes' first
+    std::vector<const HeaderUnit*> includes;
+
+    explicit HeaderUnit(const std::string& path) : path(path), builder(path), symbolTable(path) {}
+};
+
+// Headers keyed by resolved path and content hash, so each header is parsed
+// once per process however many units include it, and an edited header is
+// parsed again. Loading is serialized on one lock: a header is only ever
+// parsed once, and nested loads (a header including another) cannot deadlock.
+class HeaderCache {
+private:
+    std::recursive_mutex lock;
+    std::map<std::pair<std::string, uint64_t>, std::unique_ptr<HeaderUnit>> headers;
+    std::set<std::string> loading;      // headers being parsed, to break include cycles
+    TSParser* parser = nullptr;
+
+    HeaderCache() = default;
+    ~HeaderCache();
+
+public:
+    HeaderCache(const HeaderCache&) = delete;
+    HeaderCache& operator=(const HeaderCache&) = delete;
+
+    static HeaderCache& global();
+
+    /// find a header: "name" next to the including file first, then both forms along the search paths
+    /// @return the normalized path, empty if the header is not found
+    static std::string resolve(std::string_view name, bool system, const std::string& includingDir,
+                               const std::vector<std::string>& searchPaths);
+
+    /// parse and lower a header unless this content was done before; its own includes are loaded too
+    /// @return nullptr (after reporting why) if the header cannot be read or includes itself
+    const HeaderUnit* load(const std::string& path, const std::vector<std::string>& searchPaths);
+
+    /// load the headers of a file's includes; system headers that are not found are skipped silently
+    std::vector<const HeaderUnit*> loadIncludes(const std::vector<IncludeDirective>& includes, const std::string& includingDir,
+                                                const std::vector<std::string>& searchPaths);
+
+    size_t size();
+};
+
+/// the headers and everything they include, each once, included headers first
+std::vector<const HeaderUnit*> include_closure(const std::vector<const HeaderUnit*>& headers);
+
+/// add the typedefs, globals and global code of headers (and their includes) to a unit's globals;
+/// call before lowering the unit's own globals so that its definitions win
+void import_headers(const std::vector<const HeaderUnit*>& headers, LlBuilder& builder, SymbolTable& symbolTable);
+
+/// chain the content hashes of headers (and their includes) onto a seed, for cache keys
+uint64_t hash_headers(const std::vector<const HeaderUnit*>& headers, uint64_t seed);
+
+#endif
@@ -0,0 +1,91 @@
+// Incremental re-analysis of one translation unit across edits
+
+#ifndef INCREMENTAL_SESSION_H
+#define INCREMENTAL_SESSION_H
+
+#include <string>
+#include <vector>
+#include <functional>
+#include <tree_sitter/api.h>
+#include "IrTransUnit.h"
+#include "CFG.h"
+
+// Keeps the syntax tree, AST, Ll IR and SSA-form CFGs of one file alive between
+// edits. An edit is applied to the old tree with ts_tree_edit, the file is
+// reparsed against it, and only the function definitions overlapping a changed
+// range are rebuilt; every other function keeps its LlBuilder and CFG.
+// Changes outside function bodies (globals, typedefs, macros) and added or
+// removed functions fall back to rebuilding the whole unit.
+class IncrementalSession {
+public:
+    // One function definition and everything lowered from it
+    struct Function {
+        std::string name;
+        uint32_t startByte = 0;
+        uint32_t endByte = 0;
+        IrFunctionDef* def = nullptr;
+        IrArena* arena = nullptr;           // owns def once it was rebuilt alone, before that the unit's arena does
+        LlPool* pool = nullptr;             // owns the Ll statements of builder and cfg
+        LlBuilder* builder = nullptr;
+        SymbolTable* symbolTable = nullptr;
+        CFG* cfg = nullptr;                 // in SSA form
+    };
+
+    // called for every rebuilt function after its CFG is built and before it is
+    // converted to SSA (SSA renames the Ll statements in place)
+    using CfgHook = std::function<void(size_t index, const Function& function)>;
+
+private:
+    TSParser* parser;
+    const TSLanguage* language;
+    std::string text;
+    TSTree* tree = nullptr;
+
+    IrArena* unitArena = nullptr;
+    IrTransUnit* unit = nullptr;
+    LlPool* globalPool = nullptr;
+    LlBuilder* globalBuilder = nullptr;
+    SymbolTable* globalTable = nullptr;
+    std::vector<Function> functions;   // in source order
+    bool mapped = false;               // functions line up with the top-level function_definition nodes
+
+    std::vector<size_t> rebuilt;
+    CfgHook cfgHook;
+
+    bool rebuildAll();
+    bool rebuildFunction(size_t index, const TSNode& node);
+    void finishFunction(size_t index);
+    static void releaseFunction(Function& function);
+    void releaseUnit();
+
+public:
+    IncrementalSession();
+    ~IncrementalSession();
+
+    IncrementalSession(const IncrementalSession&) = delete;
+    IncrementalSession& operator=(const IncrementalSession&) = delete;
+
+    void setCfgHook(CfgHook hook) { cfgHook = std::move(hook); }
+
+    /// parse and analyze the whole source
+    /// @return false if the AST could not be built
+    bool open(std::string source);
+
+    /// replace the bytes [startByte, oldEndByte) of the current text and re-analyze what changed
+    /// @return false if the AST could not be built
+    bool applyEdit(uint32_t startByte, uint32_t oldEndByte, const std::string& replacement);
+
+    /// diff a new version of the whole text against the current one and apply it as one edit
+    /// @return false if the AST could not be built
+    bool update(const std::string& source);
+
+    const std::string& getText() const { return text; }
+    const std::vector<Function>& getFunctions() const { return functions; }
+    LlBuilder* getGlobalBuilder() const { return globalBuilder; }
+    SymbolTable* getGlobalTable() const { return globalTable; }
+
+    /// indices of the functions rebuilt by the last open/applyEdit/update
+    const std::vector<size_t>& getRebuilt() const { return rebuilt; }
+};
+
+#endif
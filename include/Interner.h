@@ -0,0 +1,79 @@
+// Process-wide table mapping identifier names to dense 32-bit ids
+
+#ifndef INTERNER_H
+#define INTERNER_H
+
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+using SymbolId = uint32_t;
+
+constexpr SymbolId NoSymbol = UINT32_MAX;
+
+// Each distinct name is stored once and gets the next id, so ids can index
+// arrays and compare and hash as integers; the text is only needed for output.
+// Shared by every thread and every file of a run, names are never removed.
+class Interner {
+private:
+    std::deque<std::string> names;     // a deque keeps the strings in place as it grows
+    std::unordered_map<std::string_view, SymbolId> ids;
+    mutable std::shared_mutex mutex;
+
+public:
+    static Interner& global() {
+        static Interner interner;
+        return interner;
+    }
+
+    SymbolId intern(std::string_view name) {
+        {
+            std::shared_lock<std::shared_mutex> lock(mutex);
+            auto it = ids.find(name);
+            if (it != ids.end()) {
+                return it->second;
+            }
+        }
+        std::unique_lock<std::shared_mutex> lock(mutex);
+        auto it = ids.find(name);
+        if (it != ids.end()) {
+            return it->second;
+        }
+        SymbolId id = static_cast<SymbolId>(names.size());
+        names.emplace_back(name);
+        ids.emplace(names.back(), id);
+        return id;
+    }
+
+    /// @return the id of name, or NoSymbol if it was never interned (the table is left alone)
+    SymbolId lookup(std::string_view name) const {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        auto it = ids.find(name);
+        return it != ids.end() ? it->second : NoSymbol;
+    }
+
+    /// the name of an id returned by intern(), valid for the rest of the run
+    const std::string& name(SymbolId id) const {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        return names[id];
+    }
+
+    size_t size() const {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        return names.size();
+    }
+};
+
+inline SymbolId intern(std::string_view name) {
+    return Interner::global().intern(name);
+}
+
+inline const std::string& symbol_name(SymbolId id) {
+    return Interner::global().name(id);
+}
+
+#endif
@@ -4,29 +4,140 @@
 #include <tree_sitter/api.h>
 #include <vector>
 #include <deque>
+#include <map>
+#include <ostream>
+#include <sstream>
+#include <algorithm>
 #include "Ll.h"
 #include "LlBuilder.h"
 #include "SymbolTable.h"
+#include "Interner.h"
+#include "IrArena.h"
+#include "Casting.h"
+#include "SourceLocation.h"
 
 using namespace std;
 
+// Tag of the most derived class of an Ir node, for isa<>/cast<>/dyn_cast<>.
+// Subclasses follow their base so that a base's classof is a range check;
+// Ident is both an expression and a declarator and sits between the two ranges.
+enum class IrKind {
+    Type,
+    TypeBool,
+    TypeVoid,
+    TypeInt,
+    TypeChar,
+    TypeString,
+    TypeArray,
+    TypeIdent,
+    PointerType,
+    TypeStruct,
+    Expr,
+    BinaryExpr,
+    Literal,
+    LiteralBool,
+    LiteralChar,
+    LiteralNumber,
+    LiteralStringContent,
+    LiteralString,
+    NonBinaryExpr,
+    CallExpr,
+    AssignExpr,
+    FieldExpr,
+    PointerExpr,
+    ParenthesizedExpr,
+    UnaryExpr,
+    SubscriptExpr,
+    InitializerList,
+    Ident,
+    DeclDeclarator,
+    AbstractPointerDeclarator,
+    FunctionDecl,
+    Statement,
+    StmtReturn,
+    StmtReturnExpr,
+    StmtReturnVoid,
+    CompoundStmt,
+    ExprStmt,
+    ElseClause,
+    IfStmt,
+    Decl,
+    MultiDecl,
+    ForStmt,
+    WhileStmt,
+    BreakStmt,
+    CaseStmt,
+    SwitchStmt,
+    ArgList,
+    PreprocInclude,
+    PreprocArg,
+    PreprocDef,
+    StorageClassSpecifier,
+    FieldDecl,
+    FieldDeclList,
+    ParamDecl,
+    ParamList,
+    FunctionDef,
+    InitDeclarator,
+    TypeDef,
+    TransUnit
+};
+
+class IrExpr;
+class IrDeclDeclarator;
+
+// Stream manipulator writing the two spaces per level that printTree indents by
+struct IrIndent {
+    int depth;
+};
+
+inline std::ostream& operator<<(std::ostream& out, IrIndent indent) {
+    static const char spaces[] = "                                ";
+    for (size_t left = 2 * static_cast<size_t>(indent.depth); left > 0;) {
+        size_t chunk = std::min(left, sizeof(spaces) - 1);
+        out.write(spaces, chunk);
+        left -= chunk;
+    }
+    return out;
+}
+
 class Ir {
     private:
-        const TSNode & node;
+        SourceLocation location;
+    protected:
+        IrKind kind;    // set by each constructor, the most derived one runs last
     public:
-    Ir(const TSNode & node): node(node) {}
+    Ir(const SourceLocation& location): location(location) { IrArena::adoptNode(this); }
+    // copies (clone()) belong to the arena current at the time, like any other node
+    Ir(const Ir& other): location(other.location), kind(other.kind) { IrArena::adoptNode(this); }
+
+    IrKind getKind() const { return kind; }
+
+    // Ir is a virtual base of IrExpr and IrDeclDeclarator, which static_cast cannot
+    // reach; cast<> goes through these instead of dynamic_cast
+    virtual IrExpr* asExpr() { return nullptr; }
+    virtual IrDeclDeclarator* asDeclDeclarator() { return nullptr; }
+
+    // children are not deleted here, the IrArena owns every node
     virtual ~Ir() = default;
 
-    int getLineNumber() {
-        return ts_node_start_point(node).row;
+    static void* operator new(size_t size) {
+        return IrArena::allocateNode(size);
+    }
+
+    // nodes are freed by their IrArena; never delete one, the arena would destroy it again
+    static void operator delete(void*) {}
+
+    int getLineNumber() const {
+        return location.row;
     }
 
-    int getColNumber() {
-        return ts_node_start_point(node).column;
+    int getColNumber() const {
+        return location.column;
     }
 
-    const TSNode& getNode() {
-        return node;
+    const SourceLocation& getLocation() const {
+        return location;
     }
 
     virtual bool operator==(const Ir& other) const {
@@ -37,22 +148,57 @@ class Ir {
     // virtual string semanticCheck(ScopeStack& scopeStack) = 0;
 
     virtual LlLocation* generateLlIr(LlBuilder& builder, SymbolTable& symbolTable) = 0;
-    virtual string prettyPrint(string indentSpace) const =0;
-    virtual string toString() const = 0;
 
-    string addIndent(const string& baseIndent, int level = 1) const {
-        return baseIndent + string(level * 2, ' '); // 2 spaces per level
+    /// write the subtree, one "|--" line per node, two spaces of indent per level of depth
+    virtual void printTree(std::ostream& out, int depth) const = 0;
+    /// write the node as C-like source text
+    virtual void print(std::ostream& out) const = 0;
+
+    string prettyPrint() const {
+        std::ostringstream out;
+        printTree(out, 0);
+        return out.str();
+    }
+
+    string toString() const {
+        std::ostringstream out;
+        print(out);
+        return out.str();
+    }
+
+    static IrIndent indent(int depth) {
+        return IrIndent{depth};
     }
+};
 
+inline std::ostream& operator<<(std::ostream& out, const Ir& ir) {
+    ir.print(out);
+    return out;
+}
+
+template <>
+struct VirtualDownCast<Ir> {
+    template <typename To>
+    static To* cast(Ir* value) {
+        if constexpr (std::is_base_of_v<IrExpr, To>) {
+            return static_cast<To*>(value->asExpr());
+        } else {
+            return static_cast<To*>(value->asDeclDeclarator());
+        }
+    }
 };
 
 class IrExpr : public virtual Ir {
 public:
-    IrExpr(const TSNode & node) : Ir(node) {}
+    static bool classof(const Ir* ir) { return ir->getKind() >= IrKind::Expr && ir->getKind() <= IrKind::Ident; }
+
+    IrExpr(const TSNode & node) : Ir(node) { kind = IrKind::Expr; }
     ~IrExpr() = default;
 
-    string toString() const override {
-        return "baseIrExpr";
+    IrExpr* asExpr() override { return this; }
+
+    void print(std::ostream& out) const override {
+        out << "baseIrExpr";
     }
 
     LlLocation* generateLlIr(LlBuilder& builder, SymbolTable& symbolTable) override{
@@ -73,13 +219,12 @@ private:
     IrExpr* rightOperand;
 
 public:
+    static bool classof(const Ir* ir) { return ir->getKind() == IrKind::BinaryExpr; }
+
     IrBinaryExpr(string& operation, IrExpr* leftOperand, IrExpr* rightOperand, const TSNode & node)
         : Ir(node), IrExpr(node), operation(operation),
-          leftOperand(leftOperand), rightOperand(rightOperand) {}
-    ~IrBinaryExpr() {
-        delete leftOperand;
-        delete rightOperand;
-    }
+          leftOperand(leftOperand), rightOperand(rightOperand) { kind = IrKind::BinaryExpr; }
+    ~IrBinaryExpr() = default;
     const IrExpr* getLeftOperand() const{
         return this->leftOperand;
     }
@@ -92,22 +237,20 @@ public:
         return this->operation;
     }
 
-    string toString() const override{
-        return leftOperand->toString() + " " + operation + " " + rightOperand->toString();
+    void print(std::ostream& out) const override {
+        out << *leftOperand << " " << operation << " " << *rightOperand;
     }
 
-    string prettyPrint(string indentSpace) const override {
-        string prettyString = indentSpace + "|--binaryExpr\n";
+    void printTree(std::ostream& out, int depth) const override {
+        out << indent(depth) << "|--binaryExpr\n";
 
-        prettyString += addIndent(indentSpace) + + "|--lhs\n";
-        prettyString += this->leftOperand->prettyPrint(addIndent(indentSpace, 2));
+        out << indent(depth + 1) << "|--lhs\n";
+        this->leftOperand->printTree(out, depth + 2);
 
-        prettyString += addIndent(indentSpace) + "|--op: " + operation + "\n";
+        out << indent(depth + 1) << "|--op: " << operation << "\n";
 
-        prettyString += addIndent(indentSpace) + "|--rhs\n";
-        prettyString += this->rightOperand->prettyPrint(addIndent(indentSpace, 2));
-
-        return prettyString;
+        out << indent(depth + 1) << "|--rhs\n";
+        this->rightOperand->printTree(out, depth + 2);
     }
 
     LlLocation* generateLlIr(LlBuilder& builder, SymbolTable& symbolTable) override {
@@ -126,7 +269,9 @@ protected:
     int width = 0;
 
 public:
-    IrType(const TSNode& node) : Ir(node) {}
+    static bool classof(const Ir* ir) { return ir->getKind() >= IrKind::Type && ir->getKind() <= IrKind::TypeStruct; }
+
+    IrType(const SourceLocation& location) : Ir(location) { kind = IrKind::Type; }
     virtual ~IrType() = default;
     virtual IrType* clone() const = 0;
     int getWidth() const { return width; }
@@ -134,7 +279,9 @@ public:
 
 class IrLiteral : public IrExpr {
 public:
-    IrLiteral(const TSNode& node) : IrExpr(node), Ir(node) {}
+    static bool classof(const Ir* ir) { return ir->getKind() >= IrKind::Literal && ir->getKind() <= IrKind::LiteralString; }
+
+    IrLiteral(const TSNode& node) : IrExpr(node), Ir(node) { kind = IrKind::Literal; }
 
     virtual ~IrLiteral() = default;
 
@@ -147,7 +294,9 @@ public:
 class IrTypeBool : public IrType {
 
 public:
-    IrTypeBool(const TSNode& node) : IrType(node) {width = 1;}
+    static bool classof(const Ir* ir) { return ir->getKind() == IrKind::TypeBool; }
+
+    IrTypeBool(const SourceLocation& location) : IrType(location) { kind = IrKind::TypeBool; width = 1; }
     ~IrTypeBool() override = default;
 
     IrTypeBool* clone() const override {
@@ -155,15 +304,15 @@ public:
     }
 
     bool operator==(const Ir& that) const override{
-        return dynamic_cast<const IrTypeBool*>(&that) != nullptr;
+        return isa<IrTypeBool>(&that);
     }
 
-    string toString() const override{
-        return "bool";
+    void print(std::ostream& out) const override {
+        out << "bool";
     }
 
-    string prettyPrint(string indentSpace) const override{
-        return indentSpace + "|--type: bool\n";
+    void printTree(std::ostream& out, int depth) const override {
+        out << indent(depth) << "|--type: bool\n";
     }
 
     LlLocation* generateLlIr(LlBuilder& builder, SymbolTable& symbolTable) override{
@@ -174,7 +323,9 @@ public:
 class IrTypeVoid : public IrType {
 
 public:
-    IrTypeVoid(const TSNode& node) : IrType(node) {}
+    static bool classof(const Ir* ir) { return ir->getKind() == IrKind::TypeVoid; }
+
+    IrTypeVoid(const SourceLocation& location) : IrType(location) { kind = IrKind::TypeVoid; }
     ~IrTypeVoid() override = default;
 
     IrTypeVoid* clone() const override {
@@ -182,15 +333,15 @@ public:
     }
 
     bool operator==(const Ir& that) const override{
-        return dynamic_cast<const IrTypeVoid*>(&that) != nullptr;
+        return isa<IrTypeVoid>(&that);
     }
 
-    string toString() const override{
-        return "void";
+    void print(std::ostream& out) const override {
+        out << "void";
     }
 
-    string prettyPrint(string indentSpace) const override{
-        return indentSpace + "|--type: void\n";
+    void printTree(std::ostream& out, int depth) const override {
+        out << indent(depth) << "|--type: void\n";
     }
 
     LlLocation* generateLlIr(LlBuilder& builder, SymbolTable& symbolTable) override{
@@ -201,7 +352,9 @@ public:
 class IrTypeInt : public IrType {
 
 public:
-    IrTypeInt(const TSNode& node) : IrType(node) { width = 4;}
+    static bool classof(const Ir* ir) { return ir->getKind() == IrKind::TypeInt; }
+
+    IrTypeInt(const SourceLocation& location) : IrType(location) { kind = IrKind::TypeInt; width = 4; }
     ~IrTypeInt() override = default;
 
     IrTypeInt* clone() const override {
@@ -209,18 +362,18 @@ public:
     }
 
     bool operator==(const Ir& that) const override{
-        if (auto thatTypeInt = dynamic_cast<const IrTypeInt*>(&that)) {
+        if (auto thatTypeInt = dyn_cast<IrTypeInt>(&that)) {
             return this->width == thatTypeInt->width;
         }
         return false;
     }
 
-    string toString() const override{
-        return "int";
+    void print(std::ostream& out) const override {
+        out << "int";
     }
 
-    string prettyPrint(string indentSpace) const override{
-        return indentSpace + "|--type: int\n";
+    void printTree(std::ostream& out, int depth) const override {
+        out << indent(depth) << "|--type: int\n";
     }
 
     LlLocation* generateLlIr(LlBuilder& builder, SymbolTable& symbolTable) override{
@@ -230,7 +383,9 @@ public:
 
 class IrTypeChar : public IrType {
 public:
-    IrTypeChar(const TSNode& node) : IrType(node) { width = 1;}
+    static bool classof(const Ir* ir) { return ir->getKind() == IrKind::TypeChar; }
+
+    IrTypeChar(const TSNode& node) : IrType(node) { kind = IrKind::TypeChar; width = 1; }
     ~IrTypeChar() override = default;
 
     IrTypeChar* clone() const override {
@@ -238,15 +393,15 @@ public:
     }
 
     bool operator==(const Ir& that) const override{
-        return dynamic_cast<const IrTypeChar*>(&that) != nullptr;
+        return isa<IrTypeChar>(&that);
     }
 
-    string prettyPrint(string indentSpace) const override{
-        return indentSpace + "|--type: char\n";
+    void printTree(std::ostream& out, int depth) const override {
+        out << indent(depth) << "|--type: char\n";
     }
 
-    string toString() const override{
-        return "char";
+    void print(std::ostream& out) const override {
+        out << "char";
     }
 
     LlLocation* generateLlIr(LlBuilder& builder, SymbolTable& symbolTable) override{
@@ -257,7 +412,9 @@ public:
 class IrTypeString : public IrType {
 
 public:
-    IrTypeString(const TSNode& node) : IrType(node) {}
+    static bool classof(const Ir* ir) { return ir->getKind() == IrKind::TypeString; }
+
+    IrTypeString(const TSNode& node) : IrType(node) { kind = IrKind::TypeString; }
     ~IrTypeString() override = default;
 
     IrTypeString* clone() const override {
@@ -265,15 +422,15 @@ public:
     }
 
     bool operator==(const Ir& that) const override{
-        return dynamic_cast<const IrTypeString*>(&that) != nullptr;
+        return isa<IrTypeString>(&that);
     }
 
-    string toString() const override{
-        return "string";
+    void print(std::ostream& out) const override {
+        out << "string";
     }
 
-    string prettyPrint(string indentSpace) const override{
-        return indentSpace + "|--type: string\n";
+    void printTree(std::ostream& out, int depth) const override {
+        out << indent(depth) << "|--type: string\n";
     }
 
     LlLocation* generateLlIr(LlBuilder& builder, SymbolTable& symbolTable) override{
@@ -288,8 +445,10 @@ private:
     int width = 0;
 
 public:
+    static bool classof(const Ir* ir) { return ir->getKind() == IrKind::TypeArray; }
+
     IrTypeArray(IrType* baseType, deque<IrLiteral*> dimension, const TSNode& node)
-            : IrType(node), baseType(baseType), dimension(dimension) {}
+            : IrType(node), baseType(baseType), dimension(dimension) { kind = IrKind::TypeArray; }
     ~IrTypeArray();
 
     IrType* getBaseType() const {
@@ -312,7 +471,7 @@ public:
         if (&that == this) {
             return true;
         }
-        if (auto thatTypeArray = dynamic_cast<const IrTypeArray*>(&that)) {
+        if (auto thatTypeArray = dyn_cast<IrTypeArray>(&that)) {
             if (this->baseType != thatTypeArray->baseType) {
                 return false;
             }
@@ -329,9 +488,9 @@ public:
         return false;
     }
 
-    string prettyPrint(string indentSpace) const override ;
+    void printTree(std::ostream& out, int depth) const override;
 
-    string toString() const override;
+    void print(std::ostream& out) const override;
 
     LlLocation* generateLlIr(LlBuilder& builder, SymbolTable& symbolTable) override{
         return nullptr;
@@ -345,27 +504,28 @@ private:
     bool value;
 
 public:
-    IrLiteralBool(bool value, const TSNode& node) : IrLiteral(node), Ir(node), value(value) {}
+    static bool classof(const Ir* ir) { return ir->getKind() == IrKind::LiteralBool; }
+
+    IrLiteralBool(bool value, const TSNode& node) : IrLiteral(node), Ir(node), value(value) { kind = IrKind::LiteralBool; }
     ~IrLiteralBool() override = default;
     IrType* getExpressionType() {
-        return new IrTypeBool(getNode());
+        return new IrTypeBool(getLocation());
     }
 
     bool operator==(const Ir& that) const override{
-        if (auto thatLiteralBool = dynamic_cast<const IrLiteralBool*>(&that)) {
+        if (auto thatLiteralBool = dyn_cast<IrLiteralBool>(&that)) {
             return this->value == thatLiteralBool->value;
         }
         return false;
     }
 
-    string prettyPrint(string indentSpace)  const override{
-        string prettyPrint = indentSpace + "|--boolLiteral\n";
-        prettyPrint += addIndent(indentSpace)+ "|--value: " + (this->value ? "true" : "false") + "\n";
-        return prettyPrint;
+    void printTree(std::ostream& out, int depth) const override {
+        out << indent(depth) << "|--boolLiteral\n";
+        out << indent(depth + 1) << "|--value: " << (this->value ? "true" : "false") << "\n";
     }
 
-    string toString() const override{
-        return std::string(1, value);
+    void print(std::ostream& out) const override {
+        out << static_cast<char>(value);
     }
 
     LlLocation* generateLlIr(LlBuilder& builder, SymbolTable& symbolTable) override{
@@ -383,27 +543,32 @@ private:
     char value;
 
 public:
-    IrLiteralChar(char value, const TSNode& node) : IrLiteral(node), Ir(node), value(value) {}
+    static bool classof(const Ir* ir) { return ir->getKind() == IrKind::LiteralChar; }
+
+    IrLiteralChar(char value, const TSNode& node) : IrLiteral(node), Ir(node), value(value) { kind = IrKind::LiteralChar; }
     ~IrLiteralChar() override = default;
+    char getValue() const {
+        return this->value;
+    }
+
     IrType* getExpressionType() {
-        return new IrTypeVoid(getNode());
+        return new IrTypeVoid(getLocation());
     }
 
     bool operator==(const Ir& that) const override{
-        if (auto thatLiteralChar = dynamic_cast<const IrLiteralChar*>(&that)) {
+        if (auto thatLiteralChar = dyn_cast<IrLiteralChar>(&that)) {
             return this->value == thatLiteralChar->value;
         }
         return false;
     }
 
-    string prettyPrint(string indentSpace)  const override{
-        string prettyPrint = indentSpace + "|--charLiteral\n";
-        prettyPrint += addIndent(indentSpace) + "|--value: '" + this->value + "'\n";
-        return prettyPrint;
+    void printTree(std::ostream& out, int depth) const override {
+        out << indent(depth) << "|--charLiteral\n";
+        out << indent(depth + 1) << "|--value: '" << this->value << "'\n";
     }
 
-    string toString() const override{
-        return "'" + std::string(1, value) + "'";
+    void print(std::ostream& out) const override {
+        out << "'" << value << "'";
     }
 
     LlLocation* generateLlIr(LlBuilder& builder, SymbolTable& symbolTable) override{
@@ -421,31 +586,32 @@ private:
     int value;
 
 public:
-    IrLiteralNumber(long value, const TSNode& node) : IrLiteral(node), Ir(node), value(value) {}
+    static bool classof(const Ir* ir) { return ir->getKind() == IrKind::LiteralNumber; }
+
+    IrLiteralNumber(long value, const TSNode& node) : IrLiteral(node), Ir(node), value(value) { kind = IrKind::LiteralNumber; }
     ~IrLiteralNumber() override = default;
     int getValue() {
         return this->value;
     }
 
     IrType* getExpressionType() {
-        return new IrTypeInt(getNode());
+        return new IrTypeInt(getLocation());
     }
 
     bool operator==(const Ir& that) const override{
-        if (auto thatLiteralNumber = dynamic_cast<const IrLiteralNumber*>(&that)) {
+        if (auto thatLiteralNumber = dyn_cast<IrLiteralNumber>(&that)) {
             return this->value == thatLiteralNumber->value;
         }
         return false;
     }
 
-    string prettyPrint(string indentSpace) const override {
-        string prettyPrint = indentSpace + "|--NumberLiteral\n";
-        prettyPrint += addIndent(indentSpace) + "|--value: " + to_string(this->value) + "\n";
-        return prettyPrint;
+    void printTree(std::ostream& out, int depth) const override {
+        out << indent(depth) << "|--NumberLiteral\n";
+        out << indent(depth + 1) << "|--value: " << this->value << "\n";
     }
 
-    string toString() const override{
-        return to_string(value); // "IrLiteralNumber";
+    void print(std::ostream& out) const override {
+        out << value; // "IrLiteralNumber";
     }
 
     LlLocation* generateLlIr(LlBuilder& builder, SymbolTable& symbolTable) override{
@@ -462,8 +628,10 @@ private:
     string value;
 
 public:
+    static bool classof(const Ir* ir) { return ir->getKind() == IrKind::LiteralStringContent; }
+
     IrLiteralStringContent(const string& value, const TSNode& node)
-        : IrLiteral(node), Ir(node), value(value) {}
+        : IrLiteral(node), Ir(node), value(value) { kind = IrKind::LiteralStringContent; }
 
         ~IrLiteralStringContent() override = default;
 
@@ -472,18 +640,18 @@ public:
     }
 
     bool operator==(const Ir& that) const override{
-        if (auto thatLiteralStringContent = dynamic_cast<const IrLiteralStringContent*>(&that)) {
+        if (auto thatLiteralStringContent = dyn_cast<IrLiteralStringContent>(&that)) {
             return this->value == thatLiteralStringContent->value;
         }
         return false;
     }
 
-    string prettyPrint(string indentSpace) const override {
-        return indentSpace + "|--stringContent: " + value + "\n";
+    void printTree(std::ostream& out, int depth) const override {
+        out << indent(depth) << "|--stringContent: " << value << "\n";
     }
 
-    string toString() const override{
-        return "IrLiteralStringContent";
+    void print(std::ostream& out) const override {
+        out << "IrLiteralStringContent";
     }
 };
 
@@ -493,32 +661,31 @@ private:
     IrLiteralStringContent* stringContent;
 
 public:
+    static bool classof(const Ir* ir) { return ir->getKind() == IrKind::LiteralString; }
+
     IrLiteralString(IrLiteralStringContent* stringContent, const TSNode& node)
-        : IrLiteral(node), Ir(node), stringContent(stringContent) {}
+        : IrLiteral(node), Ir(node), stringContent(stringContent) { kind = IrKind::LiteralString; }
 
-    ~IrLiteralString() {
-        delete stringContent;
-    }
+    ~IrLiteralString() = default;
 
     const string& getValue() const {
         return stringContent->getValue();
     }
 
     bool operator==(const Ir& that) const override{
-        if (auto thatLiteralString = dynamic_cast<const IrLiteralString*>(&that)) {
+        if (auto thatLiteralString = dyn_cast<IrLiteralString>(&that)) {
             return *this->stringContent == *thatLiteralString->stringContent;
         }
         return false;
     }
 
-    string prettyPrint(string indentSpace) const override {
-        string prettyPrint = indentSpace + "|--StringLiteral\n";
-        prettyPrint += stringContent->prettyPrint(addIndent(indentSpace));
-        return prettyPrint;
+    void printTree(std::ostream& out, int depth) const override {
+        out << indent(depth) << "|--StringLiteral\n";
+        stringContent->printTree(out, depth + 1);
     }
 
-    string toString() const override{
-        return "IrLiteralString";
+    void print(std::ostream& out) const override {
+        out << "IrLiteralString";
     }
 
     LlLocation* generateLlIr(LlBuilder& builder, SymbolTable& symbolTable) override{
@@ -535,12 +702,10 @@ class IrArgList : public Ir {
 private:
     deque<IrExpr*> argsList;
 public:
-    IrArgList(const TSNode& node) : Ir(node) {}
-    ~IrArgList() {
-        for (IrExpr* arg: this->argsList) {
-            delete arg;
-        }
-    }
+    static bool classof(const Ir* ir) { return ir->getKind() == IrKind::ArgList; }
+
+    IrArgList(const TSNode& node) : Ir(node) { kind = IrKind::ArgList; }
+    ~IrArgList() = default;
 
     deque<IrExpr*> getArgsList() {
         return this->argsList;
@@ -550,22 +715,18 @@ public:
         this->argsList.push_front(newArg);
     }
 
-    string prettyPrint(string indentSpace) const override {
-        string prettyString = indentSpace + "|--argList:\n";
+    void printTree(std::ostream& out, int depth) const override {
+        out << indent(depth) << "|--argList:\n";
 
         for (IrExpr* arg: this->argsList) {
-            prettyString += arg->prettyPrint(addIndent(indentSpace));
+            arg->printTree(out, depth + 1);
         }
-
-        return prettyString;
     }
 
-    string toString() const override{
-        string argsString = "";
+    void print(std::ostream& out) const override {
         for (IrExpr* arg: this->argsList) {
-            argsString += arg->toString() + ", ";
+            out << *arg << ", ";
         }
-        return argsString;
     }
 
     LlLocation* generateLlIr(LlBuilder& builder, SymbolTable& symbolTable) override {
@@ -578,22 +739,38 @@ public:
 
 class IrPreprocInclude : public Ir {
 private:
-    IrLiteralString* path;
+    IrLiteralString* path;      // nullptr for #include <...>
+    string headerName;
+    bool system;
 
 public:
-    IrPreprocInclude(IrLiteralString* path, const TSNode& node) : Ir(node), path(path) {}
-    ~IrPreprocInclude() {
-        delete path;
-    }
-
-    string prettyPrint(string indentSpace) const override {
-        string prettyString = indentSpace + "|--preprocInclude\n";
-        prettyString += path->prettyPrint(addIndent(indentSpace));
-        return prettyString;
+    static bool classof(const Ir* ir) { return ir->getKind() == IrKind::PreprocInclude; }
+
+    IrPreprocInclude(IrLiteralString* path, const TSNode& node)
+        : Ir(node), path(path), headerName(path->getValue()), system(false) { kind = IrKind::PreprocInclude; }
+    IrPreprocInclude(const string& headerName, const TSNode& node)
+        : Ir(node), path(nullptr), headerName(headerName), system(true) { kind = IrKind::PreprocInclude; }
+    ~IrPreprocInclude() = default;
+
+    /// the header as written, without its quotes or angle brackets
+    const string& getHeaderName() const { return headerName; }
+    bool isSystem() const { return system; }
+
+    void printTree(std::ostream& out, int depth) const override {
+        out << indent(depth) << "|--preprocInclude\n";
+        if (path) {
+            path->printTree(out, depth + 1);
+        } else {
+            out << indent(depth + 1) << "|--systemLib: " << headerName << "\n";
+        }
     }
 
-    string toString() const override{
-        return "#include " + path->getValue();
+    void print(std::ostream& out) const override {
+        if (system) {
+            out << "#include <" << headerName << ">";
+        } else {
+            out << "#include " << headerName;
+        }
     }
 
     LlLocation* generateLlIr(LlBuilder& builder, SymbolTable& symbolTable) override{
@@ -605,7 +782,10 @@ public:
 
 class IrDeclDeclarator : public virtual Ir {
 public:
-    IrDeclDeclarator(const TSNode& node) : Ir(node) {}
+    static bool classof(const Ir* ir) { return ir->getKind() >= IrKind::Ident && ir->getKind() <= IrKind::FunctionDecl; }
+
+    IrDeclDeclarator(const TSNode& node) : Ir(node) { kind = IrKind::DeclDeclarator; }
+    IrDeclDeclarator* asDeclDeclarator() override { return this; }
     virtual const string getName() const {
         static const string emptyString = "";
         return emptyString;
@@ -616,12 +796,12 @@ class IrAbstractPointerDeclarator : public IrDeclDeclarator {
 private:
     IrDeclDeclarator* baseDeclarator;
 public:
+    static bool classof(const Ir* ir) { return ir->getKind() == IrKind::AbstractPointerDeclarator; }
+
     IrAbstractPointerDeclarator(IrDeclDeclarator* base, const TSNode& node)
-        : Ir(node), IrDeclDeclarator(node), baseDeclarator(base) {}
+        : Ir(node), IrDeclDeclarator(node), baseDeclarator(base) { kind = IrKind::AbstractPointerDeclarator; }
 
-    ~IrAbstractPointerDeclarator() {
-        delete baseDeclarator;
-    }
+    ~IrAbstractPointerDeclarator() = default;
 
     const string getName() const override {
         if (baseDeclarator) {
@@ -630,19 +810,19 @@ public:
         return "";
     }
 
-    string prettyPrint(string indentSpace) const override {
-        string str = indentSpace + "|--abstract_pointer_declarator: *\n";
+    void printTree(std::ostream& out, int depth) const override {
+        out << indent(depth) << "|--abstract_pointer_declarator: *\n";
         if(baseDeclarator){
-            str += baseDeclarator->prettyPrint(addIndent(indentSpace));
+            baseDeclarator->printTree(out, depth + 1);
         }
-        return str;
     }
 
-    string toString() const override{
+    void print(std::ostream& out) const override {
         if (baseDeclarator) {
-            return baseDeclarator->toString() + "*";
+            out << *baseDeclarator << "*";
+            return;
         }
-        return "*";
+        out << "*";
     }
 
     LlLocation* generateLlIr(LlBuilder& builder, SymbolTable& symbolTable) override{
@@ -653,23 +833,30 @@ public:
 
 class IrIdent : public IrDeclDeclarator, public IrExpr {
 private:
-    const string name;
+    const SymbolId symbol;
     bool isTypeAlias;
 
 public:
-    IrIdent(const string& name, const TSNode & node, bool isTypeAlias = false) : Ir(node), IrDeclDeclarator(node), IrExpr(node), name(name) {}
+    static bool classof(const Ir* ir) { return ir->getKind() == IrKind::Ident; }
+
+    IrIdent(std::string_view name, const TSNode & node, bool isTypeAlias = false)
+        : Ir(node), IrDeclDeclarator(node), IrExpr(node), symbol(intern(name)), isTypeAlias(isTypeAlias) { kind = IrKind::Ident; }
     ~IrIdent() = default;
 
     const string & getValue() const {
-        return name;
+        return symbol_name(symbol);
+    }
+
+    SymbolId getSymbol() const {
+        return symbol;
     }
 
     bool operator==(const Ir & that) const override{
         if (&that == this) {
             return true;
         }
-        if (auto thatIdent = dynamic_cast<const IrIdent *>(&that)) {
-            return this->name == thatIdent->name;
+        if (auto thatIdent = dyn_cast<IrIdent>(&that)) {
+            return this->symbol == thatIdent->symbol;
         }
         return false;
     }
@@ -677,20 +864,20 @@ public:
     bool isType() const { return isTypeAlias; }
     void markAsTypeAlias() { isTypeAlias = true; }
 
-    string prettyPrint(string indentSpace) const override{
-        return indentSpace + "|--id: " + name + "\n";
+    void printTree(std::ostream& out, int depth) const override {
+        out << indent(depth) << "|--id: " << getValue() << "\n";
     }
 
     const string getName() const override {
-        return name;
+        return getValue();
     }
 
-    string toString() const override{
-        return name;
+    void print(std::ostream& out) const override {
+        out << getValue();
     }
 
     LlLocation* generateLlIr(LlBuilder& builder, SymbolTable& symbolTable) override {
-        return new LlLocationVar(new string(name));
+        return new LlLocationVar(symbol);
     }
 
 };
@@ -698,18 +885,20 @@ public:
 class IrPreprocArg : public Ir {
 public:
     string text;
+    static bool classof(const Ir* ir) { return ir->getKind() == IrKind::PreprocArg; }
+
 
     IrPreprocArg(const string& t, const TSNode& node)
-        : Ir(node), text(t) {}
+        : Ir(node), text(t) { kind = IrKind::PreprocArg; }
 
     ~IrPreprocArg() = default;
 
-    string prettyPrint(string indentSpace) const override {
-        return indentSpace + "|-- preproc_arg: " + text + "\n";
+    void printTree(std::ostream& out, int depth) const override {
+        out << indent(depth) << "|-- preproc_arg: " << text << "\n";
     }
 
-    string toString() const override {
-        return "PreprocArg(" + text + ")";
+    void print(std::ostream& out) const override {
+        out << "PreprocArg(" << text << ")";
     }
 
     LlLocation* generateLlIr(LlBuilder& builder, SymbolTable& symbolTable) override{
@@ -722,25 +911,24 @@ class IrPreprocDef : public Ir {
 public:
     IrIdent* name;
     IrPreprocArg* value;
+    static bool classof(const Ir* ir) { return ir->getKind() == IrKind::PreprocDef; }
+
 
     IrPreprocDef(IrIdent* n, const TSNode& node,
                  IrPreprocArg* v = nullptr)
-        : Ir(node), name(n), value(v) {}
+        : Ir(node), name(n), value(v) { kind = IrKind::PreprocDef; }
 
-    ~IrPreprocDef() {
-        delete name;
-        delete value;
-    }
+    ~IrPreprocDef() = default;
 
-    string prettyPrint(string indentSpace) const override {
-        string result = indentSpace + "|-- preproc_def: " + name->getValue();
-        if (value) result += " " + value->text;
-        result += "\n";
-        return result;
+    void printTree(std::ostream& out, int depth) const override {
+        out << indent(depth) << "|-- preproc_def: " << name->getValue();
+        if (value) out << " " << value->text;
+        out << "\n";
     }
 
-    string toString() const override {
-        return "#define " + name->toString() + (value ? " " + value->text : "");
+    void print(std::ostream& out) const override {
+        out << "#define " << *name;
+        if (value) out << " " << value->text;
     }
 
     LlLocation* generateLlIr(LlBuilder& builder, SymbolTable& symbolTable) override{
@@ -752,7 +940,9 @@ public:
 
 class IrNonBinaryExpr : public IrExpr {
 public:
-    IrNonBinaryExpr(const TSNode & node) : IrExpr(node) {}
+    static bool classof(const Ir* ir) { return ir->getKind() >= IrKind::NonBinaryExpr && ir->getKind() <= IrKind::SubscriptExpr; }
+
+    IrNonBinaryExpr(const TSNode & node) : IrExpr(node) { kind = IrKind::NonBinaryExpr; }
 };
 
 class IrCallExpr : public IrNonBinaryExpr {
@@ -761,12 +951,11 @@ private:
     IrArgList* argList;
 
 public:
+    static bool classof(const Ir* ir) { return ir->getKind() == IrKind::CallExpr; }
+
     IrCallExpr(IrIdent* functionName, IrArgList* argList, const TSNode & node)
-        : Ir(node), IrNonBinaryExpr(node), functionName(functionName), argList(argList) {}
-    ~IrCallExpr() {
-        delete functionName;
-        delete argList;
-    }
+        : Ir(node), IrNonBinaryExpr(node), functionName(functionName), argList(argList) { kind = IrKind::CallExpr; }
+    ~IrCallExpr() = default;
     IrIdent* getFunctionName() {
         return this->functionName;
     }
@@ -775,18 +964,16 @@ public:
         return this->argList;
     }
 
-    string prettyPrint(string indentSpace) const override {
-        string prettyString = indentSpace + "|--callExpr\n";
+    void printTree(std::ostream& out, int depth) const override {
+        out << indent(depth) << "|--callExpr\n";
 
-        prettyString += addIndent(indentSpace) + "|--functionName\n";
-        prettyString += this->functionName->prettyPrint(addIndent(indentSpace, 2));
-        prettyString += this->argList->prettyPrint(addIndent(indentSpace));
-
-        return prettyString;
+        out << indent(depth + 1) << "|--functionName\n";
+        this->functionName->printTree(out, depth + 2);
+        this->argList->printTree(out, depth + 1);
     }
 
-    string toString() const override{
-        return functionName->toString() + " (" + argList->toString() + ")";
+    void print(std::ostream& out) const override {
+        out << *functionName << " (" << *argList << ")";
     }
 
     LlLocation* generateLlIr(LlBuilder& builder, SymbolTable& symbolTable) override {
@@ -808,50 +995,48 @@ private:
     IrExpr* rhs;
     string op;
 public:
+    static bool classof(const Ir* ir) { return ir->getKind() == IrKind::AssignExpr; }
+
     IrAssignExpr(IrExpr* lhs, IrExpr* rhs, const string& op, const TSNode& node)
-        : Ir(node), IrNonBinaryExpr(node), lhs(lhs), rhs(rhs), op(op) {}
+        : Ir(node), IrNonBinaryExpr(node), lhs(lhs), rhs(rhs), op(op) { kind = IrKind::AssignExpr; }
 
-    ~IrAssignExpr() {
-        delete lhs;
-        delete rhs;
-    }
+    ~IrAssignExpr() = default;
 
     IrExpr* getLhs() const { return lhs; }
     IrExpr* getRhs() const { return rhs; }
     const string& getOp() const { return op; }
 
-    string prettyPrint(string indentSpace) const override {
-        string prettyString = indentSpace + "|--assignExpr\n";
-        prettyString += addIndent(indentSpace) + "|--lhs\n";
-        prettyString += lhs->prettyPrint(addIndent(indentSpace, 2));
-        prettyString += addIndent(indentSpace) + "|--op: " + op + "\n";
-        prettyString += addIndent(indentSpace) + "|--rhs\n";
-        prettyString += rhs->prettyPrint(addIndent(indentSpace, 2));
-        return prettyString;
+    void printTree(std::ostream& out, int depth) const override {
+        out << indent(depth) << "|--assignExpr\n";
+        out << indent(depth + 1) << "|--lhs\n";
+        lhs->printTree(out, depth + 2);
+        out << indent(depth + 1) << "|--op: " << op << "\n";
+        out << indent(depth + 1) << "|--rhs\n";
+        rhs->printTree(out, depth + 2);
     }
 
-    string toString() const override {
-        return lhs->toString() + " " + op + " " + rhs->toString();
+    void print(std::ostream& out) const override {
+        out << *lhs << " " << op << " " << *rhs;
     }
 
     LlLocation* generateLlIr(LlBuilder& builder, SymbolTable& symbolTable) override {
         LlLocation* left = lhs->generateLlIr(builder, symbolTable);
         LlLocation* right = rhs->generateLlIr(builder, symbolTable);
         // If RHS is a pointer dereference, load into a temp first
-        if (dynamic_cast<LlLocationDeref*>(right)) {
+        if (isa<LlLocationDeref>(right)) {
             LlLocation* temp = builder.generateTemp();
             LlAssignStmtRegular* derefLoad = new LlAssignStmtRegular(temp, right);
             builder.appendStatement(derefLoad);
             right = temp;
         }
         // If LHS is a pointer dereference, assign *t0 = value directly
-        if (dynamic_cast<LlLocationDeref*>(left)) {
+        if (isa<LlLocationDeref>(left)) {
             LlAssignStmtDeref* storeStmt = new LlAssignStmtDeref(left, right);
             builder.appendStatement(storeStmt);
             return nullptr;
         }
 
-        LlLocation* location = dynamic_cast<LlLocation*>(left);
+        LlLocation* location = dyn_cast<LlLocation>(left);
         string operation = op;
         if (op != "=") {
             operation = op.substr(0, op.size() - 1);
@@ -874,26 +1059,22 @@ private:
     bool isArrow;
 
 public:
+    static bool classof(const Ir* ir) { return ir->getKind() == IrKind::FieldExpr; }
+
     IrFieldExpr(IrExpr* base, IrIdent* field, bool isArrow, const TSNode & node)
-      : Ir(node), IrNonBinaryExpr(node), baseExpr(base), fieldName(field), isArrow(isArrow) {}
+      : Ir(node), IrNonBinaryExpr(node), baseExpr(base), fieldName(field), isArrow(isArrow) { kind = IrKind::FieldExpr; }
 
-    ~IrFieldExpr() override {
-        delete baseExpr;
-        delete fieldName;
-    }
+    ~IrFieldExpr() override = default;
 
-    string prettyPrint(string indentSpace) const override {
-        string op = isArrow ? "->" : ".";
-        string prettyString = indentSpace + "|--field_expression\n";
-        prettyString += baseExpr->prettyPrint(addIndent(indentSpace));
-        prettyString += addIndent(indentSpace) + "|--op: " + op + "\n";
-        prettyString += fieldName->prettyPrint(addIndent(indentSpace));
-        return prettyString;
+    void printTree(std::ostream& out, int depth) const override {
+        out << indent(depth) << "|--field_expression\n";
+        baseExpr->printTree(out, depth + 1);
+        out << indent(depth + 1) << "|--op: " << (isArrow ? "->" : ".") << "\n";
+        fieldName->printTree(out, depth + 1);
     }
 
-    string toString() const override{
-        string op = isArrow ? "->" : ".";
-        return baseExpr->toString() + op + fieldName->toString();
+    void print(std::ostream& out) const override {
+        out << *baseExpr << (isArrow ? "->" : ".") << *fieldName;
     }
 
     IrExpr* getBaseExpr() const { return baseExpr; }
@@ -915,32 +1096,28 @@ private:
     bool isDereference; // true if operator is '*'
 
 public:
+    static bool classof(const Ir* ir) { return ir->getKind() == IrKind::PointerExpr; }
+
     IrPointerExpr(IrExpr* arg, bool addressOf, bool dereference, const TSNode & node)
-        : Ir(node), IrNonBinaryExpr(node), argument(arg), isAddressOf(addressOf), isDereference(dereference) {}
+        : Ir(node), IrNonBinaryExpr(node), argument(arg), isAddressOf(addressOf), isDereference(dereference) { kind = IrKind::PointerExpr; }
 
-    ~IrPointerExpr() override {
-        delete argument;
-    }
+    ~IrPointerExpr() override = default;
 
     IrExpr* getArgument() const { return argument; }
     bool getIsAddressOf() const { return isAddressOf; }
     bool getIsDereference() const { return isDereference; }
 
-    string prettyPrint(string indentSpace) const override {
-        string op = isAddressOf ? "&" : "*";
-        string prettyString = indentSpace + "|--pointer_expression\n";
+    void printTree(std::ostream& out, int depth) const override {
+        out << indent(depth) << "|--pointer_expression\n";
 
-        prettyString += addIndent(indentSpace) + "|--op: " + op + "\n";
+        out << indent(depth + 1) << "|--op: " << (isAddressOf ? "&" : "*") << "\n";
         if (argument) {
-            prettyString += argument->prettyPrint(addIndent(indentSpace));
+            argument->printTree(out, depth + 1);
         }
-
-        return prettyString;
     }
 
-    string toString() const override{
-        string op = isAddressOf ? "&" : "*";
-        return op + argument->toString();
+    void print(std::ostream& out) const override {
+        out << (isAddressOf ? "&" : "*") << *argument;
     }
 
     LlLocation* generateLlIr(LlBuilder& builder, SymbolTable& symbolTable) override {
@@ -966,25 +1143,24 @@ private:
     IrExpr* innerExpr;
 
 public:
+    static bool classof(const Ir* ir) { return ir->getKind() == IrKind::ParenthesizedExpr; }
+
     IrParenthesizedExpr(IrExpr* expr, const TSNode & node)
-        : Ir(node), IrNonBinaryExpr(node), innerExpr(expr) {}
+        : Ir(node), IrNonBinaryExpr(node), innerExpr(expr) { kind = IrKind::ParenthesizedExpr; }
 
-    ~IrParenthesizedExpr() {
-        delete innerExpr;
-    }
+    ~IrParenthesizedExpr() = default;
 
     IrExpr* getInnerExpr() const { return innerExpr; }
 
-    string prettyPrint(string indentSpace) const override {
-        string prettyString = indentSpace + "|--parenthesizedExpr\n";
+    void printTree(std::ostream& out, int depth) const override {
+        out << indent(depth) << "|--parenthesizedExpr\n";
         if (innerExpr) {
-            prettyString += innerExpr->prettyPrint(addIndent(indentSpace));
+            innerExpr->printTree(out, depth + 1);
         }
-        return prettyString;
     }
 
-    string toString() const override {
-        return "(" + innerExpr->toString() + ")";
+    void print(std::ostream& out) const override {
+        out << "(" << *innerExpr << ")";
     }
 
     LlLocation* generateLlIr(LlBuilder& builder, SymbolTable& symbolTable) override {
@@ -998,25 +1174,24 @@ private:
     IrExpr* argument;
 
 public:
+    static bool classof(const Ir* ir) { return ir->getKind() == IrKind::UnaryExpr; }
+
     IrUnaryExpr(const string& op, IrExpr* arg, const TSNode &node)
-        : Ir(node), IrNonBinaryExpr(node), op(op), argument(arg) {}
+        : Ir(node), IrNonBinaryExpr(node), op(op), argument(arg) { kind = IrKind::UnaryExpr; }
 
-    ~IrUnaryExpr() {
-        delete argument;
-    }
+    ~IrUnaryExpr() = default;
 
     IrExpr* getArgument() const { return argument; }
     const string& getOperator() const { return op; }
 
-    string prettyPrint(string indentSpace) const override {
-        string prettyString = indentSpace + "|--unaryExpr\n";
-        prettyString += addIndent(indentSpace) + "|--op: " + op + "\n";
-        prettyString += argument->prettyPrint(addIndent(indentSpace));
-        return prettyString;
+    void printTree(std::ostream& out, int depth) const override {
+        out << indent(depth) << "|--unaryExpr\n";
+        out << indent(depth + 1) << "|--op: " << op << "\n";
+        argument->printTree(out, depth + 1);
     }
 
-    string toString() const override {
-        return op + argument->toString();
+    void print(std::ostream& out) const override {
+        out << op << *argument;
     }
 
     LlLocation* generateLlIr(LlBuilder& builder, SymbolTable& symbolTable) override {
@@ -1031,10 +1206,12 @@ public:
 
 class IrStatement : public Ir {
 public:
-    IrStatement(const TSNode& node) : Ir(node) {}
+    static bool classof(const Ir* ir) { return ir->getKind() >= IrKind::Statement && ir->getKind() <= IrKind::SwitchStmt; }
+
+    IrStatement(const TSNode& node) : Ir(node) { kind = IrKind::Statement; }
     virtual ~IrStatement() = default;
-    string toString() const override{
-        return "IrStatement";
+    void print(std::ostream& out) const override {
+        out << "IrStatement";
     }
 
     LlLocation* generateLlIr(LlBuilder& builder, SymbolTable& symbolTable) override{
@@ -1045,7 +1222,9 @@ public:
 
 class IrStmtReturn : public IrStatement {
 public:
-    IrStmtReturn(const TSNode& node) : IrStatement(node) {}
+    static bool classof(const Ir* ir) { return ir->getKind() >= IrKind::StmtReturn && ir->getKind() <= IrKind::StmtReturnVoid; }
+
+    IrStmtReturn(const TSNode& node) : IrStatement(node) { kind = IrKind::StmtReturn; }
     virtual ~IrStmtReturn() = default;
 
     virtual LlLocation* generateLlIr(LlBuilder& builder, SymbolTable& symbolTable) override{
@@ -1059,24 +1238,21 @@ private:
     IrExpr* result;
 
 public:
-    IrStmtReturnExpr(IrExpr* result, const TSNode& node) : IrStmtReturn(node), result(result) {}
-    virtual ~IrStmtReturnExpr() {
-        delete result;
-    }
+    static bool classof(const Ir* ir) { return ir->getKind() == IrKind::StmtReturnExpr; }
+
+    IrStmtReturnExpr(IrExpr* result, const TSNode& node) : IrStmtReturn(node), result(result) { kind = IrKind::StmtReturnExpr; }
+    virtual ~IrStmtReturnExpr() = default;
     // IrType* getExpressionType() override {
     //     return this->result->getExpressionType();
     // }
 
-    string prettyPrint(string indentSpace)const override {
-        string prettyString = indentSpace + "|--returnExpr\n";
-
-        prettyString += this->result->prettyPrint(addIndent(indentSpace));
+    void printTree(std::ostream& out, int depth) const override {
+        out << indent(depth) << "|--returnExpr\n";
 
-        return prettyString;
+        this->result->printTree(out, depth + 1);
     }
-    string toString() const override{
-        string s = "return " + result->toString();
-        return s;
+    void print(std::ostream& out) const override {
+        out << "return " << *result;
     }
 
     LlLocation* generateLlIr(LlBuilder& builder, SymbolTable& symbolTable) override{
@@ -1089,18 +1265,19 @@ public:
 
 class IrStmtReturnVoid : public IrStmtReturn {
 public:
-    IrStmtReturnVoid(const TSNode& node) : IrStmtReturn(node) {}
+    static bool classof(const Ir* ir) { return ir->getKind() == IrKind::StmtReturnVoid; }
+
+    IrStmtReturnVoid(const TSNode& node) : IrStmtReturn(node) { kind = IrKind::StmtReturnVoid; }
     virtual ~IrStmtReturnVoid() = default;
     // IrType* getExpressionType() override {
     //     return new IrTypeVoid(this->getLineNumber(), this->getColNumber());
     // }
 
-    string prettyPrint(string indentSpace)const override  {
-        string prettyString = indentSpace + "|--returnVoid\n";
-        return prettyString;
+    void printTree(std::ostream& out, int depth) const override {
+        out << indent(depth) << "|--returnVoid\n";
     }
-    string toString() const override{
-        return "IrStmtReturnVoid";
+    void print(std::ostream& out) const override {
+        out << "IrStmtReturnVoid";
     }
     LlLocation* generateLlIr(LlBuilder& builder, SymbolTable& symbolTable) override{
         LlReturn* returnStmt = new LlReturn(nullptr);
@@ -1113,14 +1290,12 @@ class IrCompoundStmt : public IrStatement {
 private:
     deque<IrStatement*> stmtsList;
 public:
+    static bool classof(const Ir* ir) { return ir->getKind() == IrKind::CompoundStmt; }
+
     IrCompoundStmt(const TSNode& node)
         : IrStatement(node),
-          stmtsList() {}
-    virtual ~IrCompoundStmt() {
-        for (IrStatement* stmt: this->stmtsList) {
-            delete stmt;
-        }
-    }
+          stmtsList() { kind = IrKind::CompoundStmt; }
+    virtual ~IrCompoundStmt() = default;
 
     deque<IrStatement*> getStmtsList() {
         return this->stmtsList;
@@ -1134,21 +1309,17 @@ public:
         this->stmtsList.push_front(stmt);
     }
 
-    string prettyPrint(string indentSpace)const override  {
-        string prettyString = indentSpace + "|--compoundStmt:\n";
+    void printTree(std::ostream& out, int depth) const override {
+        out << indent(depth) << "|--compoundStmt:\n";
 
         for (IrStatement* statement: this->stmtsList) {
-            prettyString += statement->prettyPrint(addIndent(indentSpace));
+            statement->printTree(out, depth + 1);
         }
-
-        return prettyString;
     }
-    string toString() const override{
-        string s = "";
+    void print(std::ostream& out) const override {
         for (IrStatement* statement: this->stmtsList) {
-            s += statement->toString() + "\n";
+            out << *statement << "\n";
         }
-        return s;
     }
 
     LlLocation* generateLlIr(LlBuilder& builder, SymbolTable& symbolTable) override {
@@ -1163,24 +1334,22 @@ class IrExprStmt : public IrStatement {
 private:
     IrExpr* expr;
 public:
-    IrExprStmt(IrExpr* expr, const TSNode& node) : IrStatement(node), expr(expr) {}
-    virtual ~IrExprStmt() {
-        delete expr;
-    }
+    static bool classof(const Ir* ir) { return ir->getKind() == IrKind::ExprStmt; }
+
+    IrExprStmt(IrExpr* expr, const TSNode& node) : IrStatement(node), expr(expr) { kind = IrKind::ExprStmt; }
+    virtual ~IrExprStmt() = default;
 
     IrExpr* getExpr() {
         return this->expr;
     }
 
-    string prettyPrint(string indentSpace)const override  {
-        string prettyString = indentSpace + "|--exprStmt\n";
-        prettyString += this->expr->prettyPrint(addIndent(indentSpace));
-        return prettyString;
+    void printTree(std::ostream& out, int depth) const override {
+        out << indent(depth) << "|--exprStmt\n";
+        this->expr->printTree(out, depth + 1);
     }
 
-    string toString() const override{
-        string s = expr->toString();
-        return s;
+    void print(std::ostream& out) const override {
+        out << *expr;
     }
 
     LlLocation* generateLlIr(LlBuilder& builder, SymbolTable& symbolTable) override{
@@ -1193,26 +1362,24 @@ private:
     IrStatement* alternative;
 
 public:
+    static bool classof(const Ir* ir) { return ir->getKind() == IrKind::ElseClause; }
+
     IrElseClause(IrStatement* alternative, const TSNode& node)
-        : IrStatement(node), alternative(alternative) {}
+        : IrStatement(node), alternative(alternative) { kind = IrKind::ElseClause; }
 
-    ~IrElseClause() {
-        delete alternative;
-    }
+    ~IrElseClause() = default;
 
     IrStatement* getAlternative() const {
         return alternative;
     }
 
-    string prettyPrint(string indentSpace) const override {
-        string prettyString = indentSpace + "|--elseClause\n";
-        prettyString += alternative->prettyPrint(addIndent(indentSpace));
-        return prettyString;
+    void printTree(std::ostream& out, int depth) const override {
+        out << indent(depth) << "|--elseClause\n";
+        alternative->printTree(out, depth + 1);
     }
 
-    string toString() const override {
-        string result = "else " + alternative->toString();
-        return result;
+    void print(std::ostream& out) const override {
+        out << "else " << *alternative;
     }
 
     virtual LlLocation* generateLlIr(LlBuilder& builder, SymbolTable& symbolTable) override{
@@ -1227,57 +1394,50 @@ private:
     IrStatement* thenBody;
     IrElseClause* elseBody;
 public:
+    static bool classof(const Ir* ir) { return ir->getKind() == IrKind::IfStmt; }
+
     IrIfStmt(IrParenthesizedExpr* condition, IrStatement* thenBody, IrElseClause* elseBody, const TSNode& node)
-        : IrStatement(node), condition(condition), thenBody(thenBody), elseBody(elseBody) {}
+        : IrStatement(node), condition(condition), thenBody(thenBody), elseBody(elseBody) { kind = IrKind::IfStmt; }
 
-    ~IrIfStmt() {
-        delete condition;
-        delete thenBody;
-        delete elseBody;
-    }
+    ~IrIfStmt() = default;
 
-    string prettyPrint(string indentSpace) const override {
-        string prettyString = indentSpace + "|--ifStmt\n";
+    void printTree(std::ostream& out, int depth) const override {
+        out << indent(depth) << "|--ifStmt\n";
 
         // Print condition
-        prettyString += addIndent(indentSpace) + "|--condition\n";
-        prettyString += condition->prettyPrint(addIndent(indentSpace, 2));
+        out << indent(depth + 1) << "|--condition\n";
+        condition->printTree(out, depth + 2);
 
         // Print thenBody (if block)
-        prettyString += addIndent(indentSpace) + "|--consequence\n";
-        prettyString += thenBody->prettyPrint(addIndent(indentSpace, 2));
+        out << indent(depth + 1) << "|--consequence\n";
+        thenBody->printTree(out, depth + 2);
 
         // Print elseBody (if exists)
         if (elseBody) {
-            prettyString += addIndent(indentSpace) + "|--else\n";
-            prettyString += elseBody->prettyPrint(addIndent(indentSpace, 2));
+            out << indent(depth + 1) << "|--else\n";
+            elseBody->printTree(out, depth + 2);
         }
-
-        return prettyString;
     }
 
-    string toString() const override {
-        string result = "if " + condition->toString() + " " + thenBody->toString();
+    void print(std::ostream& out) const override {
+        out << "if " << *condition << " " << *thenBody;
         if (elseBody) {
-            result += " " + elseBody->toString();
+            out << " " << *elseBody;
         }
-        return result;
     }
 
     LlLocation* generateLlIr(LlBuilder& builder, SymbolTable& symbolTable) override{
         LlLocation* conditionVar = this->condition->generateLlIr(builder, symbolTable);
 
-        string label = builder.generateLabel();
+        LlLabel label = builder.generateLabel();
 
         // if.end label
-        string* endLabel = new string();
-        endLabel->append("if.end.");
-        endLabel->append(label);
+        LlLabel endLabel = label.as(LlLabelKind::IfEnd);
 
         // If there's an else, we also need an "if.else" label
-        std::string* elseLabel = nullptr;
+        LlLabel elseLabel;
         if (elseBody) {
-            elseLabel = new std::string("if.else." + label);
+            elseLabel = label.as(LlLabelKind::IfElse);
         }
 
         // CASE A: if (cond) THEN ... else ...
@@ -1293,13 +1453,13 @@ public:
             // if-else, else body
             if (elseBody) {
                 LlEmptyStmt* emptyStmtElse = new LlEmptyStmt();
-                builder.appendStatement(*elseLabel, emptyStmtElse);
+                builder.appendStatement(elseLabel, emptyStmtElse);
                 elseBody->generateLlIr(builder, symbolTable);
             }
 
             // append end if label
             LlEmptyStmt* endIfEmptyStmt = new LlEmptyStmt();
-            builder.appendStatement(*endLabel, endIfEmptyStmt);}
+            builder.appendStatement(endLabel, endIfEmptyStmt);}
         // CASE B: if (cond) THEN ... (no else)
         else {
             //   1) ifZ cond => if.end
@@ -1313,7 +1473,7 @@ public:
 
             //   3) if.end label
             LlEmptyStmt* endIfEmptyStmt = new LlEmptyStmt();
-            builder.appendStatement(*endLabel, endIfEmptyStmt);
+            builder.appendStatement(endLabel, endIfEmptyStmt);
         }
         return nullptr;
     }
@@ -1325,19 +1485,21 @@ private:
     string specifier;
 
 public:
+    static bool classof(const Ir* ir) { return ir->getKind() == IrKind::StorageClassSpecifier; }
+
     IrStorageClassSpecifier(const string& specifier, const TSNode& node)
-        : Ir(node), specifier(specifier) {}
+        : Ir(node), specifier(specifier) { kind = IrKind::StorageClassSpecifier; }
 
     const string& getValue() const {
         return this->specifier;
     }
 
-    string prettyPrint(string indentSpace) const override {
-        return indentSpace + "|--storageClassSpecifier: " + this->specifier + "\n";
+    void printTree(std::ostream& out, int depth) const override {
+        out << indent(depth) << "|--storageClassSpecifier: " << this->specifier << "\n";
     }
 
-    string toString() const override{
-        return "IrStorageClassSpecifier: " + this->specifier;
+    void print(std::ostream& out) const override {
+        out << "IrStorageClassSpecifier: " << this->specifier;
     }
 
     LlLocation* generateLlIr(LlBuilder& builder, SymbolTable& symbolTable) override{
@@ -1353,39 +1515,37 @@ private:
     IrDeclDeclarator* declarator;        // Field name or declarator
 
 public:
+    static bool classof(const Ir* ir) { return ir->getKind() == IrKind::FieldDecl; }
+
     IrFieldDecl(IrType* type, IrDeclDeclarator* declarator, const TSNode& node)
-        : Ir(node), type(type), declarator(declarator){} // bitfieldSize(bitfieldSize)
+        : Ir(node), type(type), declarator(declarator){ kind = IrKind::FieldDecl; } // bitfieldSize(bitfieldSize)
 
-    ~IrFieldDecl() {
-        delete type;
-        delete declarator;
-    }
+    ~IrFieldDecl() = default;
 
     IrType* getType() const { return type; }
     IrDeclDeclarator* getDeclarator() const { return declarator; }
 
     // int getBitfieldSize() const { return bitfieldSize; }
 
-    string prettyPrint(string indentSpace) const override {
-        string str = indentSpace + "|--field_declaration:\n";
-        str += type->prettyPrint(addIndent(indentSpace));
+    void printTree(std::ostream& out, int depth) const override {
+        out << indent(depth) << "|--field_declaration:\n";
+        type->printTree(out, depth + 1);
 
         if (declarator) {
-            str += declarator->prettyPrint(addIndent(indentSpace));
+            declarator->printTree(out, depth + 1);
         }
         // if (bitfieldSize != -1) {
         //     str += indentSpace + "  |--bitfield_size: " + to_string(bitfieldSize) + "\n";
         // }
-        return str;
     }
 
-    string toString() const override{
-        return type->toString() + " " + declarator->toString();
+    void print(std::ostream& out) const override {
+        out << *type << " " << *declarator;
     }
 
     LlLocation* generateLlIr(LlBuilder& builder, SymbolTable& symbolTable) override {
         LlLocation* declaratorComponent = declarator->generateLlIr(builder, symbolTable);
-        LlLocationVar* location = dynamic_cast<LlLocationVar*>(declaratorComponent);
+        LlLocationVar* location = dyn_cast<LlLocationVar>(declaratorComponent);
         symbolTable.putOnVarTable(*location->getVarName(), type);
         return location;
     }
@@ -1396,36 +1556,31 @@ private:
     deque<IrFieldDecl*> fieldDeclarations; // List of field declarations
 
 public:
-    IrFieldDeclList(const TSNode& node) : Ir(node) {}
+    static bool classof(const Ir* ir) { return ir->getKind() == IrKind::FieldDeclList; }
 
-    ~IrFieldDeclList() {
-        for (auto* fieldDecl : fieldDeclarations) {
-            delete fieldDecl;
-        }
-    }
+    IrFieldDeclList(const TSNode& node) : Ir(node) { kind = IrKind::FieldDeclList; }
+
+    ~IrFieldDeclList() = default;
 
     void addField(IrFieldDecl* fieldDecl) {
         fieldDeclarations.push_front(fieldDecl);
     }
 
-    string prettyPrint(string indentSpace) const override {
+    void printTree(std::ostream& out, int depth) const override {
         if (fieldDeclarations.empty()) {
-            return "";
+            return;
         }
 
-        string str = indentSpace + "|--field_declaration_list:\n";
+        out << indent(depth) << "|--field_declaration_list:\n";
         for (auto* fieldDecl : fieldDeclarations) {
-            str += fieldDecl->prettyPrint(addIndent(indentSpace));
+            fieldDecl->printTree(out, depth + 1);
         }
-        return str;
     }
 
-    string toString() const override{
-        string str = "";
+    void print(std::ostream& out) const override {
         for (auto* fieldDecl : fieldDeclarations) {
-            str += fieldDecl->toString() + ", ";
+            out << *fieldDecl << ", ";
         }
-        return str;
     }
 
     LlLocation* generateLlIr(LlBuilder& builder, SymbolTable& symbolTable) override{
@@ -1441,13 +1596,12 @@ private:
     IrDeclDeclarator* declarator;      // Can represent a name or abstract declarator
 
 public:
+    static bool classof(const Ir* ir) { return ir->getKind() == IrKind::ParamDecl; }
+
     IrParamDecl(IrType* paramType, IrDeclDeclarator* declarator, const TSNode& node)
-        : Ir(node), paramType(paramType), declarator(declarator) {}
+        : Ir(node), paramType(paramType), declarator(declarator) { kind = IrKind::ParamDecl; }
 
-    ~IrParamDecl() {
-        delete paramType;
-        delete declarator;
-    }
+    ~IrParamDecl() = default;
 
     IrType* getParamType() const {
         return this->paramType;
@@ -1457,23 +1611,22 @@ public:
         return this->declarator;
     }
 
-    string toString() const override{
+    void print(std::ostream& out) const override {
         if (declarator) {
-            return paramType->toString() + " " + declarator->toString();
+            out << *paramType << " " << *declarator;
+            return;
         }
-        return paramType->toString();
+        out << *paramType;
     }
 
-    string prettyPrint(string indentSpace) const override {
-        string prettyString = indentSpace + "|--param:\n";
+    void printTree(std::ostream& out, int depth) const override {
+        out << indent(depth) << "|--param:\n";
 
-        prettyString += paramType->prettyPrint(addIndent(indentSpace));
+        paramType->printTree(out, depth + 1);
 
         if (declarator) {
-            prettyString += declarator->prettyPrint(addIndent(indentSpace));
+            declarator->printTree(out, depth + 1);
         }
-
-        return prettyString;
     }
 
     LlLocation* generateLlIr(LlBuilder& builder, SymbolTable& symbolTable) override{
@@ -1488,12 +1641,10 @@ private:
     deque<IrParamDecl*> paramsList;
 
 public:
-    IrParamList(const TSNode& node) : Ir(node) {}
-    ~IrParamList() {
-        for (IrParamDecl* param: this->paramsList) {
-            delete param;
-        }
-    }
+    static bool classof(const Ir* ir) { return ir->getKind() == IrKind::ParamList; }
+
+    IrParamList(const TSNode& node) : Ir(node) { kind = IrKind::ParamList; }
+    ~IrParamList() = default;
 
     deque<IrParamDecl*> getParamsList() {
         return this->paramsList;
@@ -1503,22 +1654,18 @@ public:
         this->paramsList.push_front(newParam);
     }
 
-    string toString() const override{
-        string paramsString = "";
+    void print(std::ostream& out) const override {
         for (IrParamDecl* paramDecl: this->paramsList) {
-            paramsString += paramDecl->toString() + ", ";
+            out << *paramDecl << ", ";
         }
-        return paramsString;
     }
 
-    string prettyPrint(string indentSpace) const override {
-        string prettyString = indentSpace + "|--paramList:\n";
+    void printTree(std::ostream& out, int depth) const override {
+        out << indent(depth) << "|--paramList:\n";
 
         for (IrParamDecl* paramDecl: this->paramsList) {
-            prettyString += paramDecl->prettyPrint(addIndent(indentSpace));
+            paramDecl->printTree(out, depth + 1);
         }
-
-        return prettyString;
     }
 
     LlLocation* generateLlIr(LlBuilder& builder, SymbolTable& symbolTable) override{
@@ -1535,13 +1682,12 @@ private:
     IrParamList* paramsList;   // List of function parameters
 
 public:
+    static bool classof(const Ir* ir) { return ir->getKind() == IrKind::FunctionDecl; }
+
     IrFunctionDecl(IrDeclDeclarator* declarator, IrParamList* paramsList, const TSNode& node)
-        : Ir(node), IrDeclDeclarator(node), declarator(declarator), paramsList(paramsList) {}
+        : Ir(node), IrDeclDeclarator(node), declarator(declarator), paramsList(paramsList) { kind = IrKind::FunctionDecl; }
 
-    ~IrFunctionDecl() override {
-        delete declarator;
-        delete paramsList;
-    }
+    ~IrFunctionDecl() override = default;
 
     IrDeclDeclarator* getDeclarator() const { return declarator; }
 
@@ -1552,15 +1698,14 @@ public:
         return "";
     }
 
-    string toString() const override{
-        return getName() + " (" + paramsList->toString() + ")";
+    void print(std::ostream& out) const override {
+        out << getName() << " (" << *paramsList << ")";
     }
 
-    string prettyPrint(string indentSpace) const override {
-        string prettyString = indentSpace + "|--function_declarator\n";
-        prettyString += declarator->prettyPrint(addIndent(indentSpace));
-        prettyString += paramsList->prettyPrint(addIndent(indentSpace));
-        return prettyString;
+    void printTree(std::ostream& out, int depth) const override {
+        out << indent(depth) << "|--function_declarator\n";
+        declarator->printTree(out, depth + 1);
+        paramsList->printTree(out, depth + 1);
     }
 
     LlLocation* generateLlIr(LlBuilder& builder, SymbolTable& symbolTable) override {
@@ -1575,12 +1720,10 @@ private:
     IrFunctionDecl* functionDecl;
     IrCompoundStmt* compoundStmt;
 public:
-    IrFunctionDef(IrType* returnType ,IrFunctionDecl* functionDecl, IrCompoundStmt* compoundStmt, const TSNode& node) : returnType(returnType), functionDecl(functionDecl), compoundStmt(compoundStmt), Ir(node) {}
-    ~IrFunctionDef() {
-        delete returnType;
-        delete functionDecl;
-        delete compoundStmt;
-    }
+    static bool classof(const Ir* ir) { return ir->getKind() == IrKind::FunctionDef; }
+
+    IrFunctionDef(IrType* returnType ,IrFunctionDecl* functionDecl, IrCompoundStmt* compoundStmt, const TSNode& node) : returnType(returnType), functionDecl(functionDecl), compoundStmt(compoundStmt), Ir(node) { kind = IrKind::FunctionDef; }
+    ~IrFunctionDef() = default;
 
     IrType* getReturnType() const { return returnType; }
     IrFunctionDecl* getFunctionDecl() const { return functionDecl; }
@@ -1589,30 +1732,26 @@ public:
     LlLocation* generateLlIr(LlBuilder& builder, SymbolTable& symbolTable) override {
         string name = functionDecl->getName();
         LlEmptyStmt* emptyStmt = new LlEmptyStmt();
-        builder.appendStatement(name, emptyStmt);
+        builder.appendStatement(LlLabel::named(name), emptyStmt);
         functionDecl->generateLlIr(builder, symbolTable);
         this->compoundStmt->generateLlIr(builder, symbolTable);
         return nullptr;
     }
 
-    string toString() const override{
-        string result = returnType->toString() + " ";
-        result += functionDecl->toString();
-        result += " {\n";
+    void print(std::ostream& out) const override {
+        out << *returnType << " " << *functionDecl << " {\n";
         if (compoundStmt) {
-            result += compoundStmt->toString();  // Include the body
+            out << *compoundStmt;  // Include the body
         }
-        result += "\n}";
-        return result;
+        out << "\n}";
     }
     string getFunctionName() { return functionDecl->toString();}
 
-    string prettyPrint(string indentSpace) const override {
-        string prettyString = indentSpace + "|--function_definition\n";
-        prettyString += returnType->prettyPrint(addIndent(indentSpace));
-        prettyString += functionDecl->prettyPrint(addIndent(indentSpace));
-        prettyString += compoundStmt->prettyPrint(addIndent(indentSpace));
-        return prettyString;
+    void printTree(std::ostream& out, int depth) const override {
+        out << indent(depth) << "|--function_definition\n";
+        returnType->printTree(out, depth + 1);
+        functionDecl->printTree(out, depth + 1);
+        compoundStmt->printTree(out, depth + 1);
     }
 };
 
@@ -1621,13 +1760,11 @@ private:
     deque<IrExpr*> elements;
 
 public:
-    IrInitializerList(const TSNode& node) : IrExpr(node), Ir(node) {}
+    static bool classof(const Ir* ir) { return ir->getKind() == IrKind::InitializerList; }
 
-    ~IrInitializerList() {
-        for (IrExpr* expr : elements) {
-            delete expr;
-        }
-    }
+    IrInitializerList(const TSNode& node) : IrExpr(node), Ir(node) { kind = IrKind::InitializerList; }
+
+    ~IrInitializerList() = default;
 
     void addElement(IrExpr* expr) {
         elements.push_front(expr);
@@ -1637,21 +1774,19 @@ public:
         return elements;
     }
 
-    string prettyPrint(string indentSpace) const override {
-        string prettyPrint = indentSpace + "|--initializer_list\n";
+    void printTree(std::ostream& out, int depth) const override {
+        out << indent(depth) << "|--initializer_list\n";
         for (IrExpr* expr : elements) {
-            prettyPrint += expr->prettyPrint(addIndent(indentSpace));
+            expr->printTree(out, depth + 1);
         }
-        return prettyPrint;
     }
 
-    string toString() const override {
-        string str = "{ ";
+    void print(std::ostream& out) const override {
+        out << "{ ";
         for (auto expr : elements) {
-            str += expr->toString() + ", ";
+            out << *expr << ", ";
         }
-        str += "}";
-        return str;
+        out << "}";
     }
 };
 
@@ -1661,31 +1796,29 @@ private:
     IrExpr* initializer;
 
 public:
+    static bool classof(const Ir* ir) { return ir->getKind() == IrKind::InitDeclarator; }
+
     IrInitDeclarator(IrDeclDeclarator* declarator, IrExpr* initializer, const TSNode& node)
-        : Ir(node), declarator(declarator), initializer(initializer) {}
+        : Ir(node), declarator(declarator), initializer(initializer) { kind = IrKind::InitDeclarator; }
 
-    ~IrInitDeclarator() override {
-        delete declarator;
-        delete initializer;
-    }
+    ~IrInitDeclarator() override = default;
 
     IrDeclDeclarator* getDeclarator() const { return declarator; }
     IrExpr* getInitializer() const { return initializer; }
 
-    string prettyPrint(string indentSpace) const override {
-        string prettyString = indentSpace + "|--init_declarator:\n";
-        prettyString += declarator->prettyPrint(addIndent(indentSpace));
-        prettyString += initializer->prettyPrint(addIndent(indentSpace));
-        return prettyString;
+    void printTree(std::ostream& out, int depth) const override {
+        out << indent(depth) << "|--init_declarator:\n";
+        declarator->printTree(out, depth + 1);
+        initializer->printTree(out, depth + 1);
     }
 
-    string toString() const override{
-        return declarator->toString() + " = " + initializer->toString();
+    void print(std::ostream& out) const override {
+        out << *declarator << " = " << *initializer;
     }
 
     LlLocation* generateLlIr(LlBuilder& builder, SymbolTable& symbolTable) override {
         LlLocation* compo = declarator->generateLlIr(builder, symbolTable);
-        LlLocationVar* location = dynamic_cast<LlLocationVar*>(compo);
+        LlLocationVar* location = dyn_cast<LlLocationVar>(compo);
         LlLocation* init = initializer->generateLlIr(builder, symbolTable);
         LlAssignStmtRegular* assignStmt = new LlAssignStmtRegular(location, init);
         builder.appendStatement(assignStmt);
@@ -1704,22 +1837,19 @@ private:
 
 public:
     // Constructor for an initialized declarator (e.g. int a=10)
+    static bool classof(const Ir* ir) { return ir->getKind() == IrKind::Decl; }
+
     IrDecl(IrType* type, IrStorageClassSpecifier* specifier, IrInitDeclarator* initDecl,
            const TSNode& node)
-        : IrStatement(node), type(type), specifier(specifier), initDecl(initDecl), simpleDecl(nullptr) {}
+        : IrStatement(node), type(type), specifier(specifier), initDecl(initDecl), simpleDecl(nullptr) { kind = IrKind::Decl; }
 
     // Constructor for a simple declarator (e.g. int a)
     IrDecl(IrType* type, IrStorageClassSpecifier* specifier, IrDeclDeclarator* simpleDecl,
            const TSNode& node)
         : IrStatement(node), type(type), specifier(specifier),
-          initDecl(nullptr), simpleDecl(simpleDecl) {}
+          initDecl(nullptr), simpleDecl(simpleDecl) { kind = IrKind::Decl; }
 
-    ~IrDecl() override {
-        delete type;
-        delete specifier;
-        delete initDecl;
-        delete simpleDecl;
-    }
+    ~IrDecl() override = default;
 
     IrType* getType() const {
         return type;
@@ -1746,39 +1876,35 @@ public:
         return "";
     }
 
-    string prettyPrint(string indentSpace) const override {
-        string prettyString = indentSpace + "|--declaration:\n";
+    void printTree(std::ostream& out, int depth) const override {
+        out << indent(depth) << "|--declaration:\n";
 
         if (specifier) {
-            prettyString += specifier->prettyPrint(addIndent(indentSpace));
+            specifier->printTree(out, depth + 1);
         }
         if (type) {
-            prettyString += type->prettyPrint(addIndent(indentSpace));
+            type->printTree(out, depth + 1);
         }
 
         if (initDecl) {
-            prettyString += initDecl->prettyPrint(addIndent(indentSpace));
+            initDecl->printTree(out, depth + 1);
         } else if (simpleDecl) {
-            prettyString += simpleDecl->prettyPrint(addIndent(indentSpace));
+            simpleDecl->printTree(out, depth + 1);
         }
-
-        return prettyString;
     }
 
-    string toString() const override {
-        string str;
+    void print(std::ostream& out) const override {
         if (specifier) {
-            str += specifier->getValue() + " ";
+            out << specifier->getValue() << " ";
         }
         if (type) {
-            str += type->toString();
+            out << *type;
         }
         if (initDecl) {
-            str += " " + initDecl->toString();
+            out << " " << *initDecl;
         } else if (simpleDecl) {
-            str += " " + simpleDecl->toString();
+            out << " " << *simpleDecl;
         }
-        return str;
     }
 
     LlLocation* generateLlIr(LlBuilder& builder, SymbolTable& symbolTable) override {
@@ -1793,7 +1919,7 @@ public:
                 symbolTable.putOnVarTable(*(location->getVarName()), type);
             }
         };
-        if(auto castType = dynamic_cast<IrType*>(type)){
+        if(auto castType = dyn_cast<IrType>(type)){
             handleDeclaration(type);
         }
         return nullptr;
@@ -1806,14 +1932,12 @@ private:
     deque<IrDecl*> decls;
 
 public:
+    static bool classof(const Ir* ir) { return ir->getKind() == IrKind::MultiDecl; }
+
     IrMultiDecl(const TSNode& node)
-        : IrStatement(node) {}
+        : IrStatement(node) { kind = IrKind::MultiDecl; }
 
-    ~IrMultiDecl() override {
-        for (auto* d : decls) {
-            delete d;
-        }
-    }
+    ~IrMultiDecl() override = default;
 
     // Add an IrDecl to this container
     void addDeclaration(IrDecl* decl) {
@@ -1825,24 +1949,20 @@ public:
         // Move the entire 'decls' out to a temporary.
         // 'decls' will become empty.
         deque<IrDecl*> temp = std::move(decls);
-        // now 'decls' is empty, so ~IrMultiDecl won't delete these pointers
         return temp;
     }
 
-    string prettyPrint(string indentSpace) const override {
-        string result = indentSpace + "|--multiDecl:\n";
+    void printTree(std::ostream& out, int depth) const override {
+        out << indent(depth) << "|--multiDecl:\n";
         for (auto* d : decls) {
-            result += d->prettyPrint(addIndent(indentSpace));
+            d->printTree(out, depth + 1);
         }
-        return result;
     }
 
-    string toString() const override {
-        string out;
+    void print(std::ostream& out) const override {
         for (auto* d : decls) {
-            out += d->toString() + ";\n";
+            out << *d << ";\n";
         }
-        return out;
     }
 
     LlLocation* generateLlIr(LlBuilder& builder, SymbolTable& symbolTable) override {
@@ -1862,49 +1982,43 @@ private:
     IrStatement* body;
 
 public:
+    static bool classof(const Ir* ir) { return ir->getKind() == IrKind::ForStmt; }
+
     IrForStmt(IrAssignExpr* initializer, IrExpr* condition, IrExpr* update, IrStatement* body, const TSNode& node)
-        : IrStatement(node), initializer(initializer), condition(condition), update(update), body(body) {}
-    ~IrForStmt() {
-        delete initializer;
-        delete condition;
-        delete update;
-        delete body;
-    }
+        : IrStatement(node), initializer(initializer), condition(condition), update(update), body(body) { kind = IrKind::ForStmt; }
+    ~IrForStmt() = default;
 
-    string prettyPrint(string indentSpace) const override {
-        string prettyString = indentSpace + "|--forStmt\n";
+    void printTree(std::ostream& out, int depth) const override {
+        out << indent(depth) << "|--forStmt\n";
 
         if (initializer) {
-            prettyString += addIndent(indentSpace) + "|--initializer\n";
-            prettyString += initializer->prettyPrint(addIndent(indentSpace, 2));
+            out << indent(depth + 1) << "|--initializer\n";
+            initializer->printTree(out, depth + 2);
         }
         if (condition) {
-            prettyString += addIndent(indentSpace) + "|--condition\n";
-            prettyString += condition->prettyPrint(addIndent(indentSpace, 2));
+            out << indent(depth + 1) << "|--condition\n";
+            condition->printTree(out, depth + 2);
         }
         if (update) {
-            prettyString += addIndent(indentSpace) + "|--update\n";
-            prettyString += update->prettyPrint(addIndent(indentSpace, 2));
+            out << indent(depth + 1) << "|--update\n";
+            update->printTree(out, depth + 2);
         }
-        prettyString += addIndent(indentSpace) + "|--body\n";
-        prettyString += body->prettyPrint(addIndent(indentSpace, 2));
-
-        return prettyString;
+        out << indent(depth + 1) << "|--body\n";
+        body->printTree(out, depth + 2);
     }
 
-    string toString() const override {
-        string result = "for (";
+    void print(std::ostream& out) const override {
+        out << "for (";
 
-        result += initializer->toString() + "; ";
-        result += condition->toString()+ "; ";
-        result += update->toString()+ ") ";
+        out << *initializer << "; ";
+        out << *condition << "; ";
+        out << *update << ") ";
 
         if (body) {
-            result += "\t\n" + body->toString();
+            out << "\t\n" << *body;
         } else {
-            result += "{}";
+            out << "{}";
         }
-        return result;
     }
 
     LlLocation* generateLlIr(LlBuilder& builder, SymbolTable& symbolTable) override {
@@ -1913,19 +2027,19 @@ public:
         }
 
         // each for-loop gets its own unique label--forLabel
-        string forLabel = builder.generateLabel();
-        string* condLabel = new string("for.cond." + forLabel);
-        string* bodyLabel = new string("for.body." + forLabel);
-        string* incLabel = new string("for.inc." + forLabel); // increment e.g. i +=1
-        string* endLabel = new string("for.end." + forLabel);
+        LlLabel forLabel = builder.generateLabel();
+        LlLabel condLabel = forLabel.as(LlLabelKind::ForCond);
+        LlLabel bodyLabel = forLabel.as(LlLabelKind::ForBody);
+        LlLabel incLabel = forLabel.as(LlLabelKind::ForInc); // increment e.g. i +=1
+        LlLabel endLabel = forLabel.as(LlLabelKind::ForEnd);
 
         // push loop labels onto stack
         builder.getInBlock(forLabel);
-        builder.pushLoopExit(*endLabel);
+        builder.pushLoopExit(endLabel);
 
         // Condition Check Block
         LlEmptyStmt* emptyStmtFor = new LlEmptyStmt();
-        builder.appendStatement(*condLabel, emptyStmtFor);
+        builder.appendLeader(condLabel, emptyStmtFor);
 
         LlLocation* conditionVar = this->condition->generateLlIr(builder, symbolTable);
         LlJumpConditional* conditionalJump = new LlJumpConditional(endLabel,conditionVar);
@@ -1933,14 +2047,14 @@ public:
 
         // Loop Body Block
         LlEmptyStmt* emptyStmtForBody = new LlEmptyStmt();
-        builder.appendStatement(*bodyLabel, emptyStmtForBody);
+        builder.appendStatement(bodyLabel, emptyStmtForBody);
         if (body) {
             body->generateLlIr(builder, symbolTable);
         }
 
         // Update Block
         LlEmptyStmt* emptyStmtForInc = new LlEmptyStmt();
-        builder.appendStatement(*incLabel, emptyStmtForInc);
+        builder.appendStatement(incLabel, emptyStmtForInc);
         update->generateLlIr(builder, symbolTable);
 
         // Jump back to condition
@@ -1949,7 +2063,7 @@ public:
 
         // End Block
         LlEmptyStmt* emptyStmtForEnd = new LlEmptyStmt();
-        builder.appendStatement(*endLabel, emptyStmtForEnd);
+        builder.appendStatement(endLabel, emptyStmtForEnd);
 
         builder.popLoopExit();
         builder.getOutOfBlock();
@@ -1964,40 +2078,37 @@ class IrWhileStmt : public IrStatement {
         IrStatement* body;
 
     public:
-        IrWhileStmt(IrParenthesizedExpr* condition, IrStatement* body, const TSNode& node)
-            : IrStatement(node), condition(condition), body(body) {}
+    static bool classof(const Ir* ir) { return ir->getKind() == IrKind::WhileStmt; }
 
-        ~IrWhileStmt() {
-            delete condition;
-            delete body;
-        }
+        IrWhileStmt(IrParenthesizedExpr* condition, IrStatement* body, const TSNode& node)
+            : IrStatement(node), condition(condition), body(body) { kind = IrKind::WhileStmt; }
 
-    string prettyPrint(string indentSpace) const override {
-        string prettyString = indentSpace + "|--whileStmt\n";
+        ~IrWhileStmt() = default;
 
-        prettyString += addIndent(indentSpace) + "|--condition\n";
-        prettyString += condition->prettyPrint(addIndent(indentSpace, 2));
+    void printTree(std::ostream& out, int depth) const override {
+        out << indent(depth) << "|--whileStmt\n";
 
-        prettyString += addIndent(indentSpace) + "|--body\n";
-        prettyString += body->prettyPrint(addIndent(indentSpace, 2));
+        out << indent(depth + 1) << "|--condition\n";
+        condition->printTree(out, depth + 2);
 
-        return prettyString;
+        out << indent(depth + 1) << "|--body\n";
+        body->printTree(out, depth + 2);
     }
 
-    string toString() const override {
-        return "while " + condition->toString() + " {" + body->toString(); + "}";
+    void print(std::ostream& out) const override {
+        out << "while " << *condition << " {" << *body;
     }
 
     LlLocation* generateLlIr(LlBuilder& builder, SymbolTable& symbolTable) override {
         // Generate IR for while loop
-        string loopLabel = builder.generateLabel();
-        string* condLabel = new string("while.cond." + loopLabel);
-        string* bodyLabel = new string("while.body." + loopLabel);
-        string* endLabel = new string("while.end." + loopLabel);
+        LlLabel loopLabel = builder.generateLabel();
+        LlLabel condLabel = loopLabel.as(LlLabelKind::WhileCond);
+        LlLabel bodyLabel = loopLabel.as(LlLabelKind::WhileBody);
+        LlLabel endLabel = loopLabel.as(LlLabelKind::WhileEnd);
 
         // Condition Block
         LlEmptyStmt* emptyStmtWhile = new LlEmptyStmt();
-        builder.appendStatement(*condLabel, emptyStmtWhile);
+        builder.appendLeader(condLabel, emptyStmtWhile);
 
         LlLocation* conditionVar = this->condition->generateLlIr(builder, symbolTable);
         LlJumpConditional* conditionalJump = new LlJumpConditional(endLabel, conditionVar);
@@ -2005,7 +2116,7 @@ class IrWhileStmt : public IrStatement {
 
         // Body Block
         LlEmptyStmt* emptyStmtWhileBody = new LlEmptyStmt();
-        builder.appendStatement(*bodyLabel, emptyStmtWhileBody);
+        builder.appendStatement(bodyLabel, emptyStmtWhileBody);
         if (body) {
             body->generateLlIr(builder, symbolTable);
         }
@@ -2016,7 +2127,7 @@ class IrWhileStmt : public IrStatement {
 
         // End Block
         LlEmptyStmt* emptyStmtWhileEnd = new LlEmptyStmt();
-        builder.appendStatement(*endLabel, emptyStmtWhileEnd);
+        builder.appendStatement(endLabel, emptyStmtWhileEnd);
 
         return nullptr;
     }
@@ -2025,14 +2136,16 @@ class IrWhileStmt : public IrStatement {
 
 class IrBreakStmt : public IrStatement {
 public:
-    IrBreakStmt(const TSNode& node) : IrStatement(node) {}
+    static bool classof(const Ir* ir) { return ir->getKind() == IrKind::BreakStmt; }
+
+    IrBreakStmt(const TSNode& node) : IrStatement(node) { kind = IrKind::BreakStmt; }
 
-    string prettyPrint(string indentSpace) const override {
-        return indentSpace + "|--breakStmt\n";
+    void printTree(std::ostream& out, int depth) const override {
+        out << indent(depth) << "|--breakStmt\n";
     }
 
-    string toString() const override {
-        return "break;";
+    void print(std::ostream& out) const override {
+        out << "break;";
     }
 
     LlLocation* generateLlIr(LlBuilder& builder, SymbolTable& symbolTable) {
@@ -2041,16 +2154,16 @@ public:
         // std::string currentBlock = builder.getCurrentBlock();  // Get current block label
 
         // Retrieve the correct loop exit label
-        std::string exitLabel = builder.getCurrentLoopExit();
+        LlLabel exitLabel = builder.getCurrentLoopExit();
 
         // Ensure we're inside a valid loop before using `break`
-        if (exitLabel.empty()) {
+        if (!exitLabel.isValid()) {
             std::cerr << "Error: break statement found outside of a loop!" << std::endl;
             return nullptr;
         }
 
         // Generate an unconditional jump to the loop exit label
-        LlJumpUnconditional* breakJump = new LlJumpUnconditional(new std::string(exitLabel));
+        LlJumpUnconditional* breakJump = new LlJumpUnconditional(exitLabel);
         builder.appendStatement(breakJump);
 
         return nullptr;
@@ -2064,45 +2177,43 @@ class IrCaseStmt : public IrStatement {
         std::deque<IrStatement*> body;
 
     public:
+    static bool classof(const Ir* ir) { return ir->getKind() == IrKind::CaseStmt; }
+
         IrCaseStmt(IrExpr* value, std::deque<IrStatement*> body, const TSNode& node)
-            : IrStatement(node), value(value), body(body) {}
+            : IrStatement(node), value(value), body(body) { kind = IrKind::CaseStmt; }
 
-        ~IrCaseStmt() {
-            delete value;
-            for (auto* stmt : body) {
-                delete stmt;
-            }
-        }
+        ~IrCaseStmt() = default;
 
-    std::string prettyPrint(std::string indentSpace) const override {
-        std::string result = indentSpace + "|--caseStmt\n";
+    void printTree(std::ostream& out, int depth) const override {
+        out << indent(depth) << "|--caseStmt\n";
         if (value) {
-            result += addIndent(indentSpace) + "|--caseValue\n" + value->prettyPrint(addIndent(indentSpace, 2));
+            out << indent(depth + 1) << "|--caseValue\n";
+            value->printTree(out, depth + 2);
         } else {
-            result += addIndent(indentSpace) + "|--defaultCase\n";
+            out << indent(depth + 1) << "|--defaultCase\n";
         }
         for (auto* stmt : body) {
-            result += stmt->prettyPrint(addIndent(indentSpace));
+            stmt->printTree(out, depth + 1);
         }
-        return result;
     }
 
-    std::string toString() const override {
-        std::string result = value ? "case " + value->toString() + ":" : "default:";
+    void print(std::ostream& out) const override {
+        if (value) {
+            out << "case " << *value << ":";
+        } else {
+            out << "default:";
+        }
         for (auto* stmt : body) {
-            result += "\n  " + stmt->toString();
+            out << "\n  " << *stmt;
         }
-        return result;
     }
 
     IrExpr* getValueExpr() const {
         return value;
     }
 
+    // only the body, the value is a constant that the switch statement tests
     LlLocation* generateLlIr(LlBuilder& builder, SymbolTable& symbolTable) override {
-        if (value){
-            value->generateLlIr(builder, symbolTable);
-        }
         for (auto* stmt : body) {
             stmt->generateLlIr(builder, symbolTable);
         }
@@ -2116,83 +2227,138 @@ class IrSwitchStmt : public IrStatement {
         IrCompoundStmt* body; // Contains all case statements
 
     public:
+    static bool classof(const Ir* ir) { return ir->getKind() == IrKind::SwitchStmt; }
+
         IrSwitchStmt(IrParenthesizedExpr* expr, IrCompoundStmt* body, const TSNode& node)
-            : IrStatement(node), expr(expr), body(body) {}
+            : IrStatement(node), expr(expr), body(body) { kind = IrKind::SwitchStmt; }
 
-        ~IrSwitchStmt() {
-            delete expr;
-            delete body;
-        }
+        ~IrSwitchStmt() = default;
 
-    std::string prettyPrint(std::string indentSpace) const override {
-        std::string result = indentSpace + "|--switchStmt\n";
-        result += addIndent(indentSpace) + "|--condition\n" + expr->prettyPrint(addIndent(indentSpace, 2));
-        result += addIndent(indentSpace) + "|--body\n" + body->prettyPrint(addIndent(indentSpace, 2));
-        return result;
+    void printTree(std::ostream& out, int depth) const override {
+        out << indent(depth) << "|--switchStmt\n";
+        out << indent(depth + 1) << "|--condition\n";
+        expr->printTree(out, depth + 2);
+        out << indent(depth + 1) << "|--body\n";
+        body->printTree(out, depth + 2);
+    }
+
+    void print(std::ostream& out) const override {
+        out << "switch " << *expr << " {\n" << *body << "}";
+    }
+
+    // the integer value of a constant case expression: a number or char literal,
+    // possibly negated or parenthesized
+    static bool foldCaseValue(IrExpr* expr, int& value) {
+        if (auto* number = dyn_cast<IrLiteralNumber>(expr)) {
+            value = number->getValue();
+            return true;
+        }
+        if (auto* character = dyn_cast<IrLiteralChar>(expr)) {
+            value = character->getValue();
+            return true;
+        }
+        if (auto* paren = dyn_cast<IrParenthesizedExpr>(expr)) {
+            return foldCaseValue(paren->getInnerExpr(), value);
+        }
+        if (auto* unary = dyn_cast<IrUnaryExpr>(expr)) {
+            if (!foldCaseValue(unary->getArgument(), value)) {
+                return false;
+            }
+            if (unary->getOperator() == "-") {
+                value = -value;
+                return true;
+            }
+            return unary->getOperator() == "+";
+        }
+        return false;
     }
 
-    std::string toString() const override {
-        return "switch " + expr->toString() + " {\n" + body->toString() + "}";
+    // test the cases [lo, hi), sorted by value, with two-way jumps only: a few
+    // cases are compared one by one, more are split at the middle value
+    static void lowerDecisionTree(LlBuilder& builder, LlLocation* switchVar, const std::vector<std::pair<int, LlLabel>>& cases,
+                                  size_t lo, size_t hi, LlLabel otherwise) {
+        const size_t linearCases = 3;
+        if (hi - lo <= linearCases) {
+            for (size_t i = lo; i < hi; i++) {
+                // ifZ => the value is equal, jump to the case
+                LlLocationVar* cmpTemp = builder.generateTemp();
+                builder.appendStatement(new LlAssignStmtBinaryOp(cmpTemp, switchVar, "!=", new LlLiteralInt(cases[i].first)));
+                builder.appendStatement(new LlJumpConditional(cases[i].second, cmpTemp));
+            }
+            builder.appendStatement(new LlJumpUnconditional(otherwise));
+            return;
+        }
+
+        size_t mid = lo + (hi - lo) / 2;
+        LlLabel upperLabel = builder.generateLabel();
+        // ifZ => the value is at least the middle one
+        LlLocationVar* cmpTemp = builder.generateTemp();
+        builder.appendStatement(new LlAssignStmtBinaryOp(cmpTemp, switchVar, "<", new LlLiteralInt(cases[mid].first)));
+        builder.appendStatement(new LlJumpConditional(upperLabel, cmpTemp));
+        lowerDecisionTree(builder, switchVar, cases, lo, mid, otherwise);
+        builder.appendStatement(upperLabel, new LlEmptyStmt());
+        lowerDecisionTree(builder, switchVar, cases, mid, hi, otherwise);
     }
 
+    // compares for the case values that are not constants, then one LlSwitch,
+    // or a decision tree if the builder asks for two-way switches, then the case bodies in source order so that they fall through
     LlLocation* generateLlIr(LlBuilder& builder, SymbolTable& symbolTable) override {
         LlLocation* switchVar = expr->generateLlIr(builder, symbolTable);
-        std::string* endLabel = new std::string("switch.end." + builder.generateLabel());
-        builder.pushLoopExit(*endLabel);
+        LlLabel endLabel = builder.generateLabel().as(LlLabelKind::SwitchEnd);
+        builder.pushLoopExit(endLabel);
 
-        std::unordered_map<int, std::string*> caseLabels;
-        std::string* defaultLabel = nullptr;
+        // the label of each case statement in source order, and the cases by value
+        std::vector<LlLabel> caseStmtLabels;
+        std::map<int, LlLabel> caseLabels;
+        // cases whose value does not fold to a constant, compared one by one
+        std::vector<std::pair<IrExpr*, LlLabel>> computedCases;
+        LlLabel defaultLabel;
 
         for (auto* stmt : body->getStmtsList()) {
-            if (auto* caseStmt = dynamic_cast<IrCaseStmt*>(stmt)) {
-                if (caseStmt->getValueExpr()) {
-                    if (auto* literal = dynamic_cast<IrLiteralNumber*>(caseStmt->getValueExpr())) {
-                        caseLabels[literal->getValue()] = new std::string(
-                            "case." + std::to_string(literal->getValue()) + "." + builder.generateLabel()
-                        );
+            if (auto* caseStmt = dyn_cast<IrCaseStmt>(stmt)) {
+                if (caseStmt->getValueExpr() == nullptr) {
+                    defaultLabel = builder.generateLabel().as(LlLabelKind::Default);
+                    caseStmtLabels.push_back(defaultLabel);
+                } else if (int value; foldCaseValue(caseStmt->getValueExpr(), value)) {
+                    LlLabel caseLabel = builder.generateLabel().as(LlLabelKind::Case, value);
+                    if (!caseLabels.emplace(value, caseLabel).second) {
+                        std::cerr << "Error: duplicate case value " << value << " in switch" << std::endl;
                     }
+                    caseStmtLabels.push_back(caseLabel);
                 } else {
-                    defaultLabel = new std::string("default." + builder.generateLabel());
+                    LlLabel caseLabel = builder.generateLabel();
+                    computedCases.emplace_back(caseStmt->getValueExpr(), caseLabel);
+                    caseStmtLabels.push_back(caseLabel);
                 }
             }
         }
 
-        for (const auto& [caseValue, caseLabel] : caseLabels) {
-            LlLocationVar* caseTemp = builder.generateTemp();
-            builder.appendStatement(new LlAssignStmtRegular(caseTemp, new LlLiteralInt(caseValue)));
-
+        for (auto& [valueExpr, caseLabel] : computedCases) {
+            // ifZ => the value is equal, jump to the case
+            LlLocation* caseValue = valueExpr->generateLlIr(builder, symbolTable);
             LlLocationVar* cmpTemp = builder.generateTemp();
-            builder.appendStatement(new LlAssignStmtBinaryOp(cmpTemp, switchVar, "==", caseTemp));
-            // ifZ => default/end, else => case
-            if (defaultLabel) {
-                // If comparison == 0 => jump to default
-                builder.appendStatement(new LlJumpConditional(defaultLabel, cmpTemp));
-            } else {
-                // If comparison == 0 => jump to switch.end
-                builder.appendStatement(new LlJumpConditional(endLabel, cmpTemp));
-            }
-            builder.appendStatement(new LlJumpUnconditional(caseLabel));
+            builder.appendStatement(new LlAssignStmtBinaryOp(cmpTemp, switchVar, "!=", caseValue));
+            builder.appendStatement(new LlJumpConditional(caseLabel, cmpTemp));
         }
 
-        // if (defaultLabel) {
-        //     builder.appendStatement(new LlJumpUnconditional(defaultLabel));
-        // } else {
-        //     builder.appendStatement(new LlJumpUnconditional(endLabel));
-        // }
+        std::vector<std::pair<int, LlLabel>> cases(caseLabels.begin(), caseLabels.end());
+        LlLabel otherwise = defaultLabel.isValid() ? defaultLabel : endLabel;
+        if (builder.hasTwoWaySwitches()) {
+            lowerDecisionTree(builder, switchVar, cases, 0, cases.size(), otherwise);
+        } else {
+            builder.appendStatement(new LlSwitch(switchVar, std::move(cases), otherwise));
+        }
 
+        size_t caseIndex = 0;
         for (auto* stmt : body->getStmtsList()) {
-            if (auto* caseStmt = dynamic_cast<IrCaseStmt*>(stmt)) {
-                std::string* caseLabel = caseStmt->getValueExpr()
-                                             ? caseLabels[dynamic_cast<IrLiteralNumber*>(caseStmt->getValueExpr())->getValue()]
-                                             : defaultLabel;
-
-                builder.appendStatement(*caseLabel, new LlEmptyStmt());
+            if (auto* caseStmt = dyn_cast<IrCaseStmt>(stmt)) {
+                builder.appendStatement(caseStmtLabels[caseIndex++], new LlEmptyStmt());
                 caseStmt->generateLlIr(builder, symbolTable);
             }
         }
 
         builder.popLoopExit();
-        builder.appendStatement(*endLabel, new LlEmptyStmt());
+        builder.appendStatement(endLabel, new LlEmptyStmt());
 
         return nullptr;
     }
@@ -2207,13 +2373,12 @@ private:
     int level = 0;
 
 public:
+    static bool classof(const Ir* ir) { return ir->getKind() == IrKind::SubscriptExpr; }
+
     IrSubscriptExpr(IrExpr* baseExpr, IrExpr* indexExpr, const TSNode& node)
-        : Ir(node), IrNonBinaryExpr(node), baseExpr(baseExpr), indexExpr(indexExpr){}
+        : Ir(node), IrNonBinaryExpr(node), baseExpr(baseExpr), indexExpr(indexExpr){ kind = IrKind::SubscriptExpr; }
 
-    ~IrSubscriptExpr() {
-        delete baseExpr;
-        delete indexExpr;
-    }
+    ~IrSubscriptExpr() = default;
 
     void setLevel(int l){
         level = l;
@@ -2231,33 +2396,32 @@ public:
         return indexExpr;
     }
 
-    string prettyPrint(string indentSpace) const override {
-        string prettyString = indentSpace + "|--subscript_expression\n";
+    void printTree(std::ostream& out, int depth) const override {
+        out << indent(depth) << "|--subscript_expression\n";
 
         if (baseExpr) {
-            prettyString += baseExpr->prettyPrint(addIndent(indentSpace));
+            baseExpr->printTree(out, depth + 1);
         } else {
-            prettyString += addIndent(indentSpace) + "|--Error: Missing base expression\n";
+            out << indent(depth + 1) << "|--Error: Missing base expression\n";
         }
 
-        prettyString += addIndent(indentSpace) + "|--index\n";
+        out << indent(depth + 1) << "|--index\n";
         // Print index expression
         if (indexExpr) {
-             prettyString += indexExpr->prettyPrint(addIndent(indentSpace, 2));
+             indexExpr->printTree(out, depth + 2);
         } else {
-            prettyString += addIndent(indentSpace, 2) + "|--Error: Missing index expression\n";
+            out << indent(depth + 2) << "|--Error: Missing index expression\n";
         }
-        return prettyString;
     }
 
-    string toString() const override{
-        return baseExpr->toString() + "[" + indexExpr->toString() + "]";
+    void print(std::ostream& out) const override {
+        out << *baseExpr << "[" << *indexExpr << "]";
     }
 
     LlLocation* generateLlIr(LlBuilder& builder, SymbolTable& symbolTable) override {
         string baseName = baseExpr->getName();
         IrType* type = symbolTable.getFromVarTable(baseName);
-        IrTypeArray* arrayType = dynamic_cast<IrTypeArray*>(type);
+        IrTypeArray* arrayType = dyn_cast<IrTypeArray>(type);
 
         if (!arrayType) {
             cerr << "Error: " << baseName << " is not an array." << endl;
@@ -2275,7 +2439,7 @@ public:
 
         LlLocation* offsetTemp = nullptr;
 
-        while (auto* sub = dynamic_cast<IrSubscriptExpr*>(currentExpr)) {
+        while (auto* sub = dyn_cast<IrSubscriptExpr>(currentExpr)) {
             if (currentLevel <= 0) {
                 cerr << "Error: Too many subscripts for array " << baseName << endl;
                 return nullptr;
@@ -2283,7 +2447,7 @@ public:
 
             // Get the size of the current dimension
             IrLiteral* dimLiteral = dims[currentLevel - 1];
-            int dimSize = dynamic_cast<IrLiteralNumber*>(dimLiteral)->getValue();
+            int dimSize = dyn_cast<IrLiteralNumber>(dimLiteral)->getValue();
 
             LlLocation* indexLocation = sub->getIndexExpr()->generateLlIr(builder, symbolTable);
 
@@ -2312,8 +2476,10 @@ class IrTypeIdent : public IrType {
     private:
         string name;
     public:
+    static bool classof(const Ir* ir) { return ir->getKind() == IrKind::TypeIdent; }
+
         IrTypeIdent(string& name, const TSNode& node)
-            : IrType(node), name(name) {}
+            : IrType(node), name(name) { kind = IrKind::TypeIdent; }
         ~IrTypeIdent() = default;
 
         IrTypeIdent* clone() const override {
@@ -2328,18 +2494,18 @@ class IrTypeIdent : public IrType {
             if (&that == this) {
                 return true;
             }
-            if (auto thatIdent = dynamic_cast<const IrTypeIdent*>(&that)) {
+            if (auto thatIdent = dyn_cast<IrTypeIdent>(&that)) {
                 return this->name == thatIdent->name;
             }
             return false;
         }
 
-        string prettyPrint(string indentSpace) const override{
-            return indentSpace + "|--typeId: " + name + "\n";
+        void printTree(std::ostream& out, int depth) const override {
+            out << indent(depth) << "|--typeId: " << name << "\n";
         }
 
-        string toString() const override{
-            return name;
+        void print(std::ostream& out) const override {
+            out << name;
         }
 
         LlLocation* generateLlIr(LlBuilder& builder, SymbolTable& symbolTable) override {
@@ -2353,19 +2519,20 @@ private:
     IrType* baseType;
 
 public:
+    static bool classof(const Ir* ir) { return ir->getKind() == IrKind::PointerType; }
+
     IrPointerType(IrType* baseType, const TSNode& node)
-        : IrType(node), baseType(baseType) {}
+        : IrType(node), baseType(baseType) { kind = IrKind::PointerType; }
 
-    ~IrPointerType() { delete baseType; }
+    ~IrPointerType() = default;
 
-    string toString() const override {
-        return baseType->toString() + "*";
+    void print(std::ostream& out) const override {
+        out << *baseType << "*";
     }
 
-    string prettyPrint(string indentSpace) const override {
-        string result = indentSpace + "|--pointer: *\n";
-        result += baseType->prettyPrint(addIndent(indentSpace));
-        return result;
+    void printTree(std::ostream& out, int depth) const override {
+        out << indent(depth) << "|--pointer: *\n";
+        baseType->printTree(out, depth + 1);
     }
 
     IrType* getBaseType() const {
@@ -2388,33 +2555,31 @@ private:
     IrFieldDeclList* fieldDeclList;      // List of field declarations
 
 public:
+    static bool classof(const Ir* ir) { return ir->getKind() == IrKind::TypeStruct; }
+
     IrTypeStruct(IrIdent* name, IrFieldDeclList* fieldDeclList, const TSNode& node)
-        : IrType(node), name(name), fieldDeclList(fieldDeclList) {}
+        : IrType(node), name(name), fieldDeclList(fieldDeclList) { kind = IrKind::TypeStruct; }
 
-    ~IrTypeStruct() {
-        delete name;
-        delete fieldDeclList;
-    }
+    ~IrTypeStruct() = default;
 
     IrTypeStruct* clone() const override {
         return new IrTypeStruct(*this);
     }
 
-    string prettyPrint(string indentSpace) const override {
-        string prettyString = indentSpace + "|--type: struct\n";
+    void printTree(std::ostream& out, int depth) const override {
+        out << indent(depth) << "|--type: struct\n";
         if (name) {
-            prettyString += name->prettyPrint(addIndent(indentSpace));
+            name->printTree(out, depth + 1);
         }
-        prettyString += fieldDeclList->prettyPrint(addIndent(indentSpace));
-        return prettyString;
+        fieldDeclList->printTree(out, depth + 1);
     }
 
-    string toString() const override{
-        string str = "struct ";
+    void print(std::ostream& out) const override {
+        out << "struct ";
         if (name) {
-            str += name->toString();
+            out << *name;
         }
-        return str + " {" + fieldDeclList->toString() + "}";
+        out << " {" << *fieldDeclList << "}";
     }
 
     LlLocation* generateLlIr(LlBuilder& builder, SymbolTable& symbolTable) override{
@@ -2429,13 +2594,12 @@ private:
     IrTypeIdent* alias;   // The alias name
 
 public:
+    static bool classof(const Ir* ir) { return ir->getKind() == IrKind::TypeDef; }
+
     IrTypeDef(IrType* type, IrTypeIdent* alias, const TSNode& node)
-        : Ir(node), type(type), alias(alias) {}
+        : Ir(node), type(type), alias(alias) { kind = IrKind::TypeDef; }
 
-    ~IrTypeDef() {
-        delete type;
-        delete alias;
-    }
+    ~IrTypeDef() = default;
 
     IrType* getbaseType() const {
         return type;
@@ -2445,22 +2609,21 @@ public:
         return alias;
     }
 
-    string prettyPrint(string indentSpace) const override {
-        string prettyString = indentSpace + "|--typedef:\n";
-        prettyString += type->prettyPrint(addIndent(indentSpace));
-        prettyString += alias->prettyPrint(addIndent(indentSpace));
-        return prettyString;
+    void printTree(std::ostream& out, int depth) const override {
+        out << indent(depth) << "|--typedef:\n";
+        type->printTree(out, depth + 1);
+        alias->printTree(out, depth + 1);
     }
 
-    string toString() const override{
-        return "typedef " + type->toString() + " " + alias->toString();
+    void print(std::ostream& out) const override {
+        out << "typedef " << *type << " " << *alias;
     }
 
     LlLocation* generateLlIr(LlBuilder& builder, SymbolTable& symbolTable) override {
-        IrTypeStruct* structType = dynamic_cast<IrTypeStruct*>(type);
+        IrTypeStruct* structType = dyn_cast<IrTypeStruct>(type);
         if (structType) {
             LlLocation *compo = alias->generateLlIr(builder, symbolTable);
-            LlLocationTypeAlias* location = dynamic_cast<LlLocationTypeAlias*>(compo);
+            LlLocationTypeAlias* location = dyn_cast<LlLocationTypeAlias>(compo);
             symbolTable.putOnTypeDefTable(*location->getAliasTypeName(), structType);
         }
         return nullptr;
@@ -2468,4 +2631,14 @@ public:
 };
 
 
+inline void IrArena::release() {
+    for (auto it = nodes.rbegin(); it != nodes.rend(); ++it) {
+        (*it)->~Ir();
+    }
+    nodes.clear();
+    chunks.clear();
+    next = end = nullptr;
+    allocated = 0;
+}
+
 #endif
\ No newline at end of file
@@ -0,0 +1,111 @@
+// Bump-pointer arena owning the Ir nodes of one translation unit
+
+#ifndef IR_ARENA_H
+#define IR_ARENA_H
+
+#include <vector>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+class Ir;
+
+// Every Ir node allocated while an arena is current is carved out of its chunks
+// and registered with it; release() runs their destructors (for the strings and
+// containers they hold) and frees the chunks in one go. Ir destructors do not
+// delete their children and Ir nodes are never deleted one by one: dropping a
+// node simply leaves it to the arena. Nodes allocated while no arena is current
+// come from the heap and are never freed.
+class IrArena {
+private:
+    static constexpr size_t ChunkSize = 64 * 1024;
+    static constexpr size_t Alignment = alignof(std::max_align_t);
+
+    std::vector<std::unique_ptr<char[]>> chunks;
+    char* next = nullptr;
+    char* end = nullptr;
+    size_t allocated = 0;
+    std::vector<Ir*> nodes;
+    static inline thread_local IrArena* current = nullptr;
+
+    void* allocate(size_t size) {
+        size = (size + Alignment - 1) & ~(Alignment - 1);
+        if (static_cast<size_t>(end - next) < size) {
+            // a node bigger than a chunk gets a chunk of its own
+            size_t chunkSize = size > ChunkSize ? size : ChunkSize;
+            chunks.emplace_back(new char[chunkSize + Alignment]);
+            char* base = chunks.back().get();
+            next = base + (Alignment - reinterpret_cast<uintptr_t>(base) % Alignment) % Alignment;
+            end = next + chunkSize;
+        }
+        void* p = next;
+        next += size;
+        allocated += size;
+        return p;
+    }
+
+public:
+    IrArena() = default;
+    ~IrArena() { release(); }
+
+    IrArena(const IrArena&) = delete;
+    IrArena& operator=(const IrArena&) = delete;
+
+    // Makes an arena current for the calling thread until the end of the scope
+    class Scope {
+    private:
+        IrArena* saved;
+    public:
+        explicit Scope(IrArena& arena) : saved(current) { current = &arena; }
+        ~Scope() { current = saved; }
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+    };
+
+    /// destroy every node and free the chunks, defined in Ir.h
+    void release();
+
+    /// forget the nodes without destroying them, for a process that is about to exit (--no-teardown)
+    void abandon() {
+        for (auto& chunk : chunks) {
+            chunk.release();
+        }
+        chunks.clear();
+        nodes.clear();
+        next = end = nullptr;
+        allocated = 0;
+    }
+
+    /// take over another arena's nodes and chunks, e.g. one filled on a worker thread;
+    /// other is left empty. Not synchronized, the caller serializes calls on this arena.
+    void absorb(IrArena& other) {
+        for (auto& chunk : other.chunks) {
+            chunks.push_back(std::move(chunk));
+        }
+        nodes.insert(nodes.end(), other.nodes.begin(), other.nodes.end());
+        allocated += other.allocated;
+        other.chunks.clear();
+        other.nodes.clear();
+        other.next = other.end = nullptr;
+        other.allocated = 0;
+    }
+
+    /// the arena current on the calling thread, nullptr if none
+    static IrArena* active() { return current; }
+
+    size_t size() const { return nodes.size(); }
+    size_t bytesUsed() const { return allocated; }
+
+    static void* allocateNode(size_t size) {
+        return current ? current->allocate(size) : ::operator new(size);
+    }
+
+    static void adoptNode(Ir* node) {
+        if (current) {
+            current->nodes.push_back(node);
+        }
+    }
+};
+
+#endif
@@ -3,43 +3,48 @@
 #include "Ir.h"
 #include "LlBuilderList.h"
 #include <deque>
+#include <algorithm>
 
 class IrTransUnit : public Ir {
 private:
     std::deque<Ir*> topLevelNodes; 
     std::vector<IrDecl*> declerationList;
-    std::vector<IrFunctionDef*> functionList;
+    std::deque<IrFunctionDef*> functionList;    // in source order, builders and cfg<N>.dot are numbered by it
     std::vector<IrPreprocInclude*> preprocIncludeList;
     std::vector<IrTypeDef*> typeDefList;
     std::vector<IrPreprocDef*> preprocDefList;
     std::vector<IrExprStmt*> exprStmtList;
 
 public:
-    IrTransUnit(const TSNode& node) : Ir(node) {}
-    ~IrTransUnit() {
-        for (Ir* item : this->topLevelNodes) {
-            delete item;
-        }
-    }
+    static bool classof(const Ir* ir) { return ir->getKind() == IrKind::TransUnit; }
+
+    IrTransUnit(const TSNode& node) : Ir(node) { kind = IrKind::TransUnit; }
+    ~IrTransUnit() = default;
 
     void addTopLevelNodeFront(Ir* node) {
         this->topLevelNodes.push_front(node);
         // Categorize nodes 
-        if (auto* decl = dynamic_cast<IrDecl*>(node)) {
-            this->declerationList.push_back(decl);
-        } else if (auto* func = dynamic_cast<IrFunctionDef*>(node)) {
-            this->functionList.push_back(func);
-        } else if (auto* preprocInclude = dynamic_cast<IrPreprocInclude*>(node)) {
-            this->preprocIncludeList.push_back(preprocInclude);
-        } else if (auto* typeDef = dynamic_cast<IrTypeDef*>(node)) {
-            this->typeDefList.push_back(typeDef);
-        } else if (auto* preprocDef = dynamic_cast<IrPreprocDef*>(node)) {
-            this->preprocDefList.push_back(preprocDef);
-        } else if(auto* exprStmt = dynamic_cast<IrExprStmt*>(node)){
-            this->exprStmtList.push_back(exprStmt);
-        }
-        else {
-            std::cerr << "Warning: Skipping unrecognized node." << std::endl;
+        switch (node->getKind()) {
+            case IrKind::Decl:
+                this->declerationList.push_back(cast<IrDecl>(node));
+                break;
+            case IrKind::FunctionDef:
+                this->functionList.push_front(cast<IrFunctionDef>(node));
+                break;
+            case IrKind::PreprocInclude:
+                this->preprocIncludeList.push_back(cast<IrPreprocInclude>(node));
+                break;
+            case IrKind::TypeDef:
+                this->typeDefList.push_back(cast<IrTypeDef>(node));
+                break;
+            case IrKind::PreprocDef:
+                this->preprocDefList.push_back(cast<IrPreprocDef>(node));
+                break;
+            case IrKind::ExprStmt:
+                this->exprStmtList.push_back(cast<IrExprStmt>(node));
+                break;
+            default:
+                std::cerr << "Warning: Skipping unrecognized node." << std::endl;
         }
     }
 
@@ -50,20 +55,40 @@ public:
 
     LlBuildersList* getLlBuilder();
 
-    std::string prettyPrint(std::string indentSpace) const override {
-        std::string prettyString = indentSpace + "|--transUnit:\n";
+    /// lower typedefs, top-level expression statements and global declarations
+    void lowerGlobals(LlBuilder& builder, SymbolTable& symbolTable);
+
+    /// lower one function definition, symbolTable should have the global table as its parent
+    /// @param recordBlocks an empty builder also records the basic blocks, so CFGBuilder::buildCFG needs no leader pass
+    void lowerFunction(IrFunctionDef* func, LlBuilder& builder, SymbolTable& symbolTable, bool recordBlocks = true);
+
+    /// swap a re-parsed function definition in for an old one, the old one stays in its arena
+    void replaceFunction(IrFunctionDef* oldFunc, IrFunctionDef* newFunc) {
+        std::replace(this->topLevelNodes.begin(), this->topLevelNodes.end(), static_cast<Ir*>(oldFunc), static_cast<Ir*>(newFunc));
+        std::replace(this->functionList.begin(), this->functionList.end(), oldFunc, newFunc);
+    }
+
+    const std::deque<IrFunctionDef*>& getFunctionList() const {
+        return this->functionList;
+    }
+
+    /// in reverse source order, unlike the function list
+    const std::vector<IrPreprocInclude*>& getPreprocIncludeList() const {
+        return this->preprocIncludeList;
+    }
+
+    void printTree(std::ostream& out, int depth) const override {
+        out << indent(depth) << "|--transUnit:\n";
         for (Ir* node : this->topLevelNodes) {
-            prettyString += node->prettyPrint(addIndent(indentSpace));
+            node->printTree(out, depth + 1);
         }
-        return prettyString;
     }
 
-    std::string toString() const override {
-        std::string result = "IrTransUnit";
+    void print(std::ostream& out) const override {
+        out << "IrTransUnit";
         for (auto node : topLevelNodes) {
-            result += "\n" + node->toString();
+            out << "\n" << *node;
         }
-        return result;
     }
 
     LlLocation* generateLlIr(LlBuilder& builder, SymbolTable& symbolTable) override{
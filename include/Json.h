@@ -0,0 +1,250 @@
+// Minimal JSON reader/writer helpers
+
+#ifndef JSON_H
+#define JSON_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <cstdlib>
+#include <cctype>
+
+// A parsed JSON value. Only what the frontend needs: compile databases and
+// the line-oriented request protocol.
+class JsonValue {
+public:
+    enum class Type { Null, Bool, Number, String, Array, Object };
+
+private:
+    Type type = Type::Null;
+    bool boolValue = false;
+    double numberValue = 0;
+    std::string stringValue;
+    std::vector<JsonValue> arrayValue;
+    std::map<std::string, JsonValue> objectValue;
+
+    friend class JsonParser;
+
+public:
+    JsonValue() = default;
+
+    Type getType() const { return type; }
+    bool isNull() const { return type == Type::Null; }
+    bool isString() const { return type == Type::String; }
+    bool isArray() const { return type == Type::Array; }
+    bool isObject() const { return type == Type::Object; }
+
+    bool asBool() const { return boolValue; }
+    double asNumber() const { return numberValue; }
+    const std::string& asString() const { return stringValue; }
+    const std::vector<JsonValue>& asArray() const { return arrayValue; }
+    const std::map<std::string, JsonValue>& asObject() const { return objectValue; }
+
+    /// look up a member of an object, nullptr if absent or not an object
+    const JsonValue* get(const std::string& key) const {
+        if (type != Type::Object) {
+            return nullptr;
+        }
+        auto it = objectValue.find(key);
+        return it == objectValue.end() ? nullptr : &it->second;
+    }
+
+    /// convenience accessor for string members
+    std::string getString(const std::string& key, const std::string& fallback = "") const {
+        const JsonValue* value = get(key);
+        return (value && value->isString()) ? value->asString() : fallback;
+    }
+};
+
+class JsonParser {
+private:
+    std::string_view text;
+    size_t pos = 0;
+
+    [[noreturn]] void fail(const std::string& what) const {
+        throw std::runtime_error("JSON error at offset " + std::to_string(pos) + ": " + what);
+    }
+
+    void skipWhitespace() {
+        while (pos < text.size() && (text[pos] == ' ' || text[pos] == '\t' || text[pos] == '\n' || text[pos] == '\r')) {
+            pos++;
+        }
+    }
+
+    bool consume(char c) {
+        skipWhitespace();
+        if (pos < text.size() && text[pos] == c) {
+            pos++;
+            return true;
+        }
+        return false;
+    }
+
+    void expect(char c) {
+        if (!consume(c)) {
+            fail(std::string("expected '") + c + "'");
+        }
+    }
+
+    static void appendUtf8(std::string& out, unsigned codepoint) {
+        if (codepoint < 0x80) {
+            out += static_cast<char>(codepoint);
+        } else if (codepoint < 0x800) {
+            out += static_cast<char>(0xC0 | (codepoint >> 6));
+            out += static_cast<char>(0x80 | (codepoint & 0x3F));
+        } else {
+            out += static_cast<char>(0xE0 | (codepoint >> 12));
+            out += static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (codepoint & 0x3F));
+        }
+    }
+
+    std::string parseString() {
+        expect('"');
+        std::string result;
+        while (pos < text.size() && text[pos] != '"') {
+            char c = text[pos++];
+            if (c != '\\') {
+                result += c;
+                continue;
+            }
+            if (pos >= text.size()) {
+                fail("unterminated escape");
+            }
+            char escaped = text[pos++];
+            switch (escaped) {
+                case '"': result += '"'; break;
+                case '\\': result += '\\'; break;
+                case '/': result += '/'; break;
+                case 'b': result += '\b'; break;
+                case 'f': result += '\f'; break;
+                case 'n': result += '\n'; break;
+                case 'r': result += '\r'; break;
+                case 't': result += '\t'; break;
+                case 'u': {
+                    if (pos + 4 > text.size()) {
+                        fail("truncated \\u escape");
+                    }
+                    unsigned long codepoint = 0;
+                    for (size_t i = 0; i < 4; i++) {
+                        char digit = text[pos + i];
+                        if (!std::isxdigit(static_cast<unsigned char>(digit))) {
+                            fail("invalid \\u escape");
+                        }
+                        codepoint = codepoint * 16 + (std::isdigit(static_cast<unsigned char>(digit)) ? digit - '0' : std::tolower(digit) - 'a' + 10);
+                    }
+                    appendUtf8(result, codepoint);
+                    pos += 4;
+                    break;
+                }
+                default:
+                    fail("invalid escape");
+            }
+        }
+        if (pos >= text.size()) {
+            fail("unterminated string");
+        }
+        pos++;
+        return result;
+    }
+
+    JsonValue parseValue() {
+        skipWhitespace();
+        if (pos >= text.size()) {
+            fail("unexpected end of input");
+        }
+
+        JsonValue value;
+        char c = text[pos];
+        if (c == '{') {
+            pos++;
+            value.type = JsonValue::Type::Object;
+            if (consume('}')) {
+                return value;
+            }
+            do {
+                skipWhitespace();
+                std::string key = parseString();
+                expect(':');
+                value.objectValue[key] = parseValue();
+            } while (consume(','));
+            expect('}');
+        } else if (c == '[') {
+            pos++;
+            value.type = JsonValue::Type::Array;
+            if (consume(']')) {
+                return value;
+            }
+            do {
+                value.arrayValue.push_back(parseValue());
+            } while (consume(','));
+            expect(']');
+        } else if (c == '"') {
+            value.type = JsonValue::Type::String;
+            value.stringValue = parseString();
+        } else if (text.compare(pos, 4, "true") == 0) {
+            pos += 4;
+            value.type = JsonValue::Type::Bool;
+            value.boolValue = true;
+        } else if (text.compare(pos, 5, "false") == 0) {
+            pos += 5;
+            value.type = JsonValue::Type::Bool;
+        } else if (text.compare(pos, 4, "null") == 0) {
+            pos += 4;
+        } else {
+            size_t start = pos;
+            while (pos < text.size() && std::string_view("+-0123456789.eE").find(text[pos]) != std::string_view::npos) {
+                pos++;
+            }
+            if (start == pos) {
+                fail("unexpected character");
+            }
+            value.type = JsonValue::Type::Number;
+            value.numberValue = std::strtod(std::string(text.substr(start, pos - start)).c_str(), nullptr);
+        }
+        return value;
+    }
+
+public:
+    explicit JsonParser(std::string_view text) : text(text) {}
+
+    /// parse a complete document, throws std::runtime_error on malformed input
+    JsonValue parse() {
+        JsonValue value = parseValue();
+        skipWhitespace();
+        if (pos != text.size()) {
+            fail("trailing characters");
+        }
+        return value;
+    }
+};
+
+// Escape a string for embedding in a JSON document (without the surrounding quotes)
+inline std::string json_escape(std::string_view text) {
+    std::string out;
+    out.reserve(text.size());
+    for (char c : text) {
+        switch (c) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    static const char* hex = "0123456789abcdef";
+                    out += "\\u00";
+                    out += hex[(c >> 4) & 0xF];
+                    out += hex[c & 0xF];
+                } else {
+                    out += c;
+                }
+        }
+    }
+    return out;
+}
+
+#endif
@@ -5,95 +5,213 @@
 #include <iostream>
 #include <vector>
 #include <sstream>
+#include <unordered_set>
+#include <utility>
+#include <algorithm>
 #include "BasicBlock.h"
+#include "Casting.h"
+#include "Interner.h"
+#include "LlId.h"
+
+class Ll;
+
+// Tag of the most derived class of an Ll node, for isa<>/cast<>/dyn_cast<>.
+// Subclasses follow their base so that a base's classof is a range check.
+enum class LlKind {
+    Statement,
+    PhiStatement,
+    EmptyStmt,
+    AssignStmt,
+    AssignStmtRegular,
+    AssignStmtBinaryOp,
+    AssignStmtAddr,
+    AssignStmtDeref,
+    AssignStmtUnaryOp,
+    Jump,
+    JumpConditional,
+    JumpUnconditional,
+    Switch,
+    MethodCallStmt,
+    ParallelMethodStmt,
+    Return,
+    Component,
+    Literal,
+    LiteralBool,
+    LiteralInt,
+    LiteralChar,
+    LiteralString,
+    Location,
+    LocationDeref,
+    LocationArray,
+    LocationVar,
+    LocationTypeAlias,
+    LocationStruct
+};
+
+// Owns every Ll node and name string created while it is current.
+// Ll nodes share children and name strings freely (a location is also its
+// statement's definedVar, a label is shared by several jumps), so
+// no node deletes what it points to; the pool frees everything at once.
+// Nodes created while no pool is current are never freed.
+class LlPool {
+private:
+    std::vector<Ll*> nodes;
+    std::unordered_set<std::string*> strings;
+    static inline thread_local LlPool* current = nullptr;
+
+public:
+    LlPool() = default;
+    ~LlPool() { release(); }
+
+    LlPool(const LlPool&) = delete;
+    LlPool& operator=(const LlPool&) = delete;
+
+    // Makes a pool current for the calling thread until the end of the scope
+    class Scope {
+    private:
+        LlPool* saved;
+    public:
+        explicit Scope(LlPool& pool) : saved(current) { current = &pool; }
+        ~Scope() { current = saved; }
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+    };
+
+    /// free every node and string owned by this pool
+    void release();
+
+    /// forget the nodes without freeing them, for a process that is about to exit (--no-teardown)
+    void abandon() {
+        nodes.clear();
+        strings.clear();
+    }
+
+    size_t size() const { return nodes.size(); }
+
+    static void adoptNode(Ll* node) {
+        if (current) {
+            current->nodes.push_back(node);
+        }
+    }
+
+    /// hand a name string to the current pool; adopting the same string twice is fine
+    static std::string* adopt(std::string* str) {
+        if (current && str) {
+            current->strings.insert(str);
+        }
+        return str;
+    }
+};
 
 class Ll{
+protected:
+    LlKind kind;    // set by each constructor, the most derived one runs last
+
 public:
-    Ll (){};
+    Ll (){ LlPool::adoptNode(this); };
+    LlKind getKind() const { return kind; }
     virtual ~Ll()=default;
-    virtual std::string toString() const = 0;
+    /// write the node as three-address code
+    virtual void print(std::ostream& out) const = 0;
+
+    std::string toString() const {
+        std::ostringstream out;
+        print(out);
+        return out.str();
+    }
     virtual bool operator==(const Ll& other) const = 0;
     virtual std::size_t hashCode() const = 0;
 };
 
+inline std::ostream& operator<<(std::ostream& out, const Ll& ll) {
+    ll.print(out);
+    return out;
+}
+
+inline void LlPool::release() {
+    for (Ll* node : nodes) {
+        delete node;
+    }
+    for (std::string* str : strings) {
+        delete str;
+    }
+    nodes.clear();
+    strings.clear();
+}
+
+class LlLocation;
 class LlStatement : public Ll{
 protected:
-    std::string* definedVar;
-    std::vector<std::string*> usedVars;
+    LlLocation* definedVar;
+    std::vector<LlLocation*> usedVars;
     bool isJumpInst;
     bool isCondJump;
-    std::string* jumpLabel;
 
 public:
-    LlStatement() : definedVar(nullptr), isJumpInst(false), isCondJump(false), jumpLabel(nullptr) {}
-    virtual ~LlStatement() {
-        delete definedVar;
-        delete jumpLabel;
-        for(auto var : usedVars) {
-            delete var;
-        }
-    }
+    static bool classof(const Ll* ll) { return ll->getKind() >= LlKind::Statement && ll->getKind() <= LlKind::Return; }
+
+    LlStatement() : definedVar(nullptr), isJumpInst(false), isCondJump(false) { kind = LlKind::Statement; }
+    // definedVar and usedVars are locations of this statement, SSA renaming sets their
+    // versions; temps are not tracked, SSA does not rename them
+    virtual ~LlStatement() = default;
 
-    std::string* getDefinedVariable() const { return definedVar; }
-    const std::vector<std::string*>& getUsedVariables() const { return usedVars; }
+    LlLocation* getDefinedVariable() const { return definedVar; }
+    const std::vector<LlLocation*>& getUsedVariables() const { return usedVars; }
     bool isJump() const { return isJumpInst; }
     bool isConditionalJump() const { return isCondJump; }
-    std::string* getJumpToLabel() const { return jumpLabel; }
-
-    void renameUse(const std::string& oldName, const std::string& newName) {
-        for(auto var : usedVars) {
-            if(*var == oldName) *var = newName;
-            else std::cerr << "Error: oldName variable " << oldName << " not found in used variables\n";
-        }
-    }
-
-    void renameDef(const std::string& oldName, const std::string& newName) {
-        if(definedVar && *definedVar == oldName) *definedVar = newName;
-        else std::cerr << "Error: oldName variable " << oldName << " not found in used definedVar\n";
-    }
 };
 
 class BasicBlock;
 // Phi function statement
 class LlPhiStatement : public LlStatement {
 private:
-    std::vector<std::string*> incomingVars;
+    SymbolId variable;  // the variable the phi was placed for
+    int version = -1;   // the version it defines, set by SSA renaming
+    std::vector<int> incomingVersions;  // the versions of variable reaching it, one per block
     std::vector<BasicBlock*> incomingBlocks;
 
 public:
-    LlPhiStatement(const std::string& var) {
-        definedVar = new std::string(var);
+    static bool classof(const Ll* ll) { return ll->getKind() == LlKind::PhiStatement; }
 
+    LlPhiStatement(SymbolId variable) : variable(variable) {
+        kind = LlKind::PhiStatement;
     }
 
-    void setIncoming(std::string* var, BasicBlock* block) {
-        incomingVars.push_back(var);
+    SymbolId getVariable() const { return variable; }
+
+    int getVersion() const { return version; }
+
+    void setVersion(int version) { this->version = version; }
+
+    void setIncoming(int version, BasicBlock* block) {
+        incomingVersions.push_back(version);
         incomingBlocks.push_back(block);
     }
-    std::string toString() const override{
-        std::ostringstream ss;
-    ss << *definedVar << " = phi [";
-    for(size_t i = 0; i < incomingVars.size(); ++i) {
-        if(i > 0) ss << ", ";
-        ss << *incomingVars[i] << " from " << incomingBlocks[i]->getLabel();
+    void print(std::ostream& out) const override {
+    const std::string& name = symbol_name(variable);
+    out << name;
+    if (version >= 0) out << "_" << version;
+    out << " = phi [";
+    for(size_t i = 0; i < incomingVersions.size(); ++i) {
+        if(i > 0) out << ", ";
+        out << name << "_" << incomingVersions[i] << " from " << incomingBlocks[i]->getLabel();
     }
-    ss << "]";
-    return ss.str();
+    out << "]";
     }
 
     bool operator==(const Ll& other) const override {
         if (&other == this) {
             return true;
         }
-        if (auto otherPhi = dynamic_cast<const LlPhiStatement*>(&other)) {
-            if (*definedVar != *otherPhi->definedVar) {
+        if (auto otherPhi = dyn_cast<LlPhiStatement>(&other)) {
+            if (variable != otherPhi->variable || version != otherPhi->version) {
                 return false;
             }
-            if (incomingVars.size() != otherPhi->incomingVars.size()) {
+            if (incomingVersions.size() != otherPhi->incomingVersions.size()) {
                 return false;
             }
-            for (size_t i = 0; i < incomingVars.size(); i++) {
-                if (*incomingVars[i] != *otherPhi->incomingVars[i]) {
+            for (size_t i = 0; i < incomingVersions.size(); i++) {
+                if (incomingVersions[i] != otherPhi->incomingVersions[i]) {
                     return false;
                 }
                 if (incomingBlocks[i] != otherPhi->incomingBlocks[i]) {
@@ -106,9 +224,9 @@ public:
     }
 
     std::size_t hashCode() const override {
-        std::size_t hash = std::hash<std::string>()(*definedVar);
-        for (size_t i = 0; i < incomingVars.size(); i++) {
-            hash ^= std::hash<std::string>()(*incomingVars[i]);
+        std::size_t hash = std::hash<SymbolId>()(variable) * 31 + std::hash<int>()(version);
+        for (size_t i = 0; i < incomingVersions.size(); i++) {
+            hash ^= std::hash<int>()(incomingVersions[i]);
             hash ^= std::hash<BasicBlock*>()(incomingBlocks[i]);
         }
         return hash;
@@ -118,10 +236,12 @@ public:
 
 class LlComponent: public Ll{
     public:
-        LlComponent ()= default;
+        static bool classof(const Ll* ll) { return ll->getKind() >= LlKind::Component && ll->getKind() <= LlKind::LocationStruct; }
+
+        LlComponent () { kind = LlKind::Component; }
         ~LlComponent () override =default;
-        std::string toString() const override{
-            return "LlComponent";
+        void print(std::ostream& out) const override {
+            out << "LlComponent";
         }
         bool operator==(const Ll& other) const override{
             return this == &other;
@@ -133,24 +253,28 @@ class LlComponent: public Ll{
 
 class LlLiteral: public LlComponent{
     public:
-        LlLiteral ()= default;
+        static bool classof(const Ll* ll) { return ll->getKind() >= LlKind::Literal && ll->getKind() <= LlKind::LiteralString; }
+
+        LlLiteral () { kind = LlKind::Literal; }
         ~LlLiteral () override =default;
-        std::string toString() const override{
-            return "LlLiteral";
+        void print(std::ostream& out) const override {
+            out << "LlLiteral";
         }
 
 };
 
 class LlEmptyStmt : public LlStatement {
 public:
-    LlEmptyStmt() = default;
+    static bool classof(const Ll* ll) { return ll->getKind() == LlKind::EmptyStmt; }
+
+    LlEmptyStmt() { kind = LlKind::EmptyStmt; }
     ~LlEmptyStmt() override = default;
-    std::string toString() const override{
-        return "EMPTY_STATEMENT";
+    void print(std::ostream& out) const override {
+        out << "EMPTY_STATEMENT";
     }
 
    bool operator==(const Ll& other) const override{
-        if (dynamic_cast<const LlEmptyStmt*>(&other) == nullptr)
+        if (!isa<LlEmptyStmt>(&other))
             return false;
         else
             return true;
@@ -162,30 +286,103 @@ public:
 
 };
 
+// A named variable, or a temp whose name is only rendered if asked for.
+// A variable is its interned name plus the version SSA renaming gave it,
+// the two are only put together as name_version when printed.
 class LlLocation: public LlComponent{
 private:
-    std::string* varName;
+    mutable const std::string* varName;
+    SymbolId symbol = NoSymbol;
+    int version = -1;   // -1 until SSA renaming versions the variable
+    LlTemp temp;
+
+protected:
+    // the same variable or temp as named, e.g. the pointer of a dereference
+    explicit LlLocation(const LlLocation* named)
+        : varName(named->varName), symbol(named->symbol), version(named->version), temp(named->temp) { kind = LlKind::Location; }
+
+    bool sameName(const LlLocation& other) const {
+        if (temp.isValid() || other.temp.isValid()) {
+            return temp == other.temp;
+        }
+        if (symbol != NoSymbol || other.symbol != NoSymbol) {
+            return symbol == other.symbol && version == other.version;
+        }
+        return *varName == *other.varName;
+    }
+
+    std::size_t nameHash() const {
+        if (temp.isValid()) {
+            return temp.hash();
+        }
+        if (symbol != NoSymbol) {
+            return std::hash<SymbolId>()(symbol) * 31 + std::hash<int>()(version);
+        }
+        return std::hash<std::string>()(*varName);
+    }
+
+    // the temp, or the variable with its version if it has one
+    void printName(std::ostream& out) const {
+        if (temp.isValid()) {
+            out << temp;
+        } else if (version >= 0) {
+            out << symbol_name(symbol) << "_" << version;
+        } else {
+            out << *getVarName();
+        }
+    }
+
 public:
-    LlLocation (std::string* varName): varName(varName){};
-    ~LlLocation () override{delete varName;};
+    static bool classof(const Ll* ll) { return ll->getKind() >= LlKind::Location && ll->getKind() <= LlKind::LocationStruct; }
+
+    LlLocation (std::string* varName)
+        : varName(LlPool::adopt(varName)), symbol(varName->empty() ? NoSymbol : intern(*varName)) { kind = LlKind::Location; };
+    explicit LlLocation (SymbolId symbol): varName(nullptr), symbol(symbol){ kind = LlKind::Location; };
+    explicit LlLocation (LlTemp temp): varName(nullptr), temp(temp){ kind = LlKind::Location; };
+    ~LlLocation () override = default;
 
-    std::string toString() const override{
-        return *(this->varName);
+    void print(std::ostream& out) const override {
+        printName(out);
     };
 
-    std::string* getVarName() const {
+    bool isTemp() const {
+        return temp.isValid();
+    }
+
+    LlTemp getTemp() const {
+        return temp;
+    }
+
+    /// the variable, NoSymbol for temps and unnamed locations
+    SymbolId getSymbol() const {
+        return symbol;
+    }
+
+    int getVersion() const {
+        return version;
+    }
+
+    void setVersion(int version) {
+        this->version = version;
+    }
+
+    /// the name without its SSA version; a temp's is rendered on the first call
+    const std::string* getVarName() const {
+        if (varName == nullptr) {
+            varName = temp.isValid() ? LlPool::adopt(new std::string(temp.toString())) : &symbol_name(symbol);
+        }
         return varName;
     }
 
     bool operator==(const Ll& other) const override{
-        if (dynamic_cast<const LlLocation*>(&other) == nullptr)
+        if (!isa<LlLocation>(&other))
             return false;
         else
-            return *varName == *dynamic_cast<const LlLocation*>(&other)->varName;
+            return sameName(*cast<LlLocation>(&other));
     }
 
     std::size_t hashCode() const override{
-        return std::hash<std::string>()(*varName);
+        return nameHash();
     }
 };
 
@@ -193,13 +390,13 @@ class LlLocationDeref : public LlLocation {
     private:
         LlLocation* base;
     public:
-    LlLocationDeref(LlLocation* base) : LlLocation(base->getVarName()), base(base) {}
-    ~LlLocationDeref() override {
-        delete base;
-    }
+    static bool classof(const Ll* ll) { return ll->getKind() == LlKind::LocationDeref; }
+
+    LlLocationDeref(LlLocation* base) : LlLocation(base), base(base) { kind = LlKind::LocationDeref; }
+    ~LlLocationDeref() override = default;
 
-    std::string toString() const override {
-        return "*" + base->toString();
+    void print(std::ostream& out) const override {
+        out << "*" << *base;
     }
 
     LlLocation* getBase() {
@@ -212,18 +409,19 @@ protected:
     LlLocation* storeLocation;
 
 public:
+    static bool classof(const Ll* ll) { return ll->getKind() >= LlKind::AssignStmt && ll->getKind() <= LlKind::AssignStmtUnaryOp; }
+
     LlAssignStmt(LlLocation* storeLocation) : storeLocation(storeLocation) {
-        definedVar = storeLocation->getVarName();
-    }
-    virtual ~LlAssignStmt() {
-        delete storeLocation;
+        kind = LlKind::AssignStmt;
+        definedVar = storeLocation->isTemp() ? nullptr : storeLocation;
     }
+    virtual ~LlAssignStmt() = default;
 
     LlLocation* getStoreLocation() {
         return this->storeLocation;
     }
-    std::string toString() const override{
-        return this->storeLocation->toString() + " = ";
+    void print(std::ostream& out) const override {
+        out << *this->storeLocation << " = ";
     }
 };
 
@@ -233,24 +431,24 @@ private:
     LlComponent* rightHandSide;
 
 public:
-    LlAssignStmtRegular(LlLocation* storeLocation, LlComponent* rightHandSide) : LlAssignStmt(storeLocation), rightHandSide(rightHandSide) {}
-    ~LlAssignStmtRegular() override {
-        delete rightHandSide;
-    }
+    static bool classof(const Ll* ll) { return ll->getKind() == LlKind::AssignStmtRegular; }
+
+    LlAssignStmtRegular(LlLocation* storeLocation, LlComponent* rightHandSide) : LlAssignStmt(storeLocation), rightHandSide(rightHandSide) { kind = LlKind::AssignStmtRegular; }
+    ~LlAssignStmtRegular() override = default;
 
     LlComponent* getRightHandSide() {
         return this->rightHandSide;
     }
 
-    std::string toString() const override{
-        return this->storeLocation->toString() + " = " + this->rightHandSide->toString();
+    void print(std::ostream& out) const override {
+        out << *this->storeLocation << " = " << *this->rightHandSide;
     }
 
     bool operator==(const Ll& other) const override {
         if (&other == this) {
             return true;
         }
-        if (auto otherOp = dynamic_cast<const LlAssignStmtRegular*>(&other)) {
+        if (auto otherOp = dyn_cast<LlAssignStmtRegular>(&other)) {
             return *storeLocation == *otherOp->storeLocation &&
                    *rightHandSide == *otherOp->rightHandSide;
         }
@@ -269,13 +467,12 @@ private:
     LlComponent* rightOperand;
 
 public:
+    static bool classof(const Ll* ll) { return ll->getKind() == LlKind::AssignStmtBinaryOp; }
+
     LlAssignStmtBinaryOp(LlLocation* storeLocation, LlComponent* leftOperand, std::string operation, LlComponent* rightOperand)
-        : LlAssignStmt(storeLocation), leftOperand(leftOperand), operation(operation), rightOperand(rightOperand) {}
+        : LlAssignStmt(storeLocation), leftOperand(leftOperand), operation(operation), rightOperand(rightOperand) { kind = LlKind::AssignStmtBinaryOp; }
 
-    ~LlAssignStmtBinaryOp() override {
-        delete leftOperand;
-        delete rightOperand;
-    }
+    ~LlAssignStmtBinaryOp() override = default;
 
     LlComponent* getLeftOperand() {
         return this->leftOperand;
@@ -289,15 +486,15 @@ public:
         return this->rightOperand;
     }
 
-    std::string toString() const override{
-        return this->storeLocation->toString() + " = " + this->leftOperand->toString() + " " + (this->operation)  + " " + this->rightOperand->toString();
+    void print(std::ostream& out) const override {
+        out << *this->storeLocation << " = " << *this->leftOperand << " " << (this->operation) << " " << *this->rightOperand;
     }
 
     bool operator==(const Ll& other) const override {
         if (&other == this) {
             return true;
         }
-        if (auto otherOp = dynamic_cast<const LlAssignStmtBinaryOp*>(&other)) {
+        if (auto otherOp = dyn_cast<LlAssignStmtBinaryOp>(&other)) {
             return *storeLocation == *otherOp->storeLocation &&
                    *leftOperand == *otherOp->leftOperand &&
                    *rightOperand == *otherOp->rightOperand &&
@@ -319,26 +516,26 @@ class LlAssignStmtAddr : public LlAssignStmt {
 private:
     LlLocation* loadLocation;
 public:
+    static bool classof(const Ll* ll) { return ll->getKind() == LlKind::AssignStmtAddr; }
+
     LlAssignStmtAddr(LlLocation* storeLocation, LlLocation* loadLocation)
-        : LlAssignStmt(storeLocation), loadLocation(loadLocation) {}
+        : LlAssignStmt(storeLocation), loadLocation(loadLocation) { kind = LlKind::AssignStmtAddr; }
 
-    ~LlAssignStmtAddr() override {
-        delete loadLocation;
-    }
+    ~LlAssignStmtAddr() override = default;
 
     LlLocation* getLoadLocation() {
         return this->loadLocation;
     }
 
-    std::string toString() const override{
-        return this->storeLocation->toString() + " = &" + this->loadLocation->toString();
+    void print(std::ostream& out) const override {
+        out << *this->storeLocation << " = &" << *this->loadLocation;
     }
 
     bool operator==(const Ll& other) const override{
         if (&other == this) {
             return true;
         }
-        if (auto otherOp = dynamic_cast<const LlAssignStmtAddr*>(&other)) {
+        if (auto otherOp = dyn_cast<LlAssignStmtAddr>(&other)) {
             return *storeLocation == *otherOp->storeLocation &&
                    *loadLocation == *otherOp->loadLocation;
         }
@@ -355,26 +552,26 @@ private:
     LlComponent* storeValue;
 
 public:
+    static bool classof(const Ll* ll) { return ll->getKind() == LlKind::AssignStmtDeref; }
+
     LlAssignStmtDeref(LlLocation* storeLocation, LlComponent* storeValue)
-        : LlAssignStmt(storeLocation), storeValue(storeValue) {}
+        : LlAssignStmt(storeLocation), storeValue(storeValue) { kind = LlKind::AssignStmtDeref; }
 
-    ~LlAssignStmtDeref() override {
-        delete storeValue;
-    }
+    ~LlAssignStmtDeref() override = default;
 
     LlComponent* getStoreValue() {
         return this->storeValue;
     }
 
-    std::string toString() const override{
-        return storeLocation->toString() + " = " + storeValue->toString();
+    void print(std::ostream& out) const override {
+        out << *storeLocation << " = " << *storeValue;
     }
 
     bool operator==(const Ll& other) const override{
         if (&other == this) {
             return true;
         }
-        if (auto otherOp = dynamic_cast<const LlAssignStmtDeref*>(&other)) {
+        if (auto otherOp = dyn_cast<LlAssignStmtDeref>(&other)) {
             return *storeLocation == *otherOp->storeLocation &&
                    *storeValue == *otherOp->storeValue;
         }
@@ -392,12 +589,11 @@ private:
     std::string* operator_;
 
 public:
+    static bool classof(const Ll* ll) { return ll->getKind() == LlKind::AssignStmtUnaryOp; }
+
     LlAssignStmtUnaryOp(LlLocation* storeLocation, LlComponent* operand, std::string* operator_)
-        : LlAssignStmt(storeLocation), operand(operand), operator_(operator_) {}
-    ~LlAssignStmtUnaryOp() override {
-        delete operand;
-        delete operator_;
-    }
+        : LlAssignStmt(storeLocation), operand(operand), operator_(LlPool::adopt(operator_)) { kind = LlKind::AssignStmtUnaryOp; }
+    ~LlAssignStmtUnaryOp() override = default;
 
     LlComponent* getOperand() {
         return this->operand;
@@ -407,15 +603,15 @@ public:
         return this->operator_;
     }
 
-    std::string toString() const override{
-        return this->storeLocation->toString() + " = " + *(operator_) + " " + operand->toString();
+    void print(std::ostream& out) const override {
+        out << *this->storeLocation << " = " << *(operator_) << " " << *operand;
     }
 
     bool operator==(const Ll& other) const override{
         if (&other == this) {
             return true;
         }
-        if (auto otherOp = dynamic_cast<const LlAssignStmtUnaryOp*>(&other)) {
+        if (auto otherOp = dyn_cast<LlAssignStmtUnaryOp>(&other)) {
             return *storeLocation == *otherOp->storeLocation &&
                    *operand == *otherOp->operand &&
                    *operator_ == *otherOp->operator_;
@@ -429,16 +625,16 @@ public:
 
 class LlJump : public LlStatement {
 protected:
-    std::string* jumpToLabel;
+    LlLabel jumpToLabel;
     bool conditionalJump;
 
 public:
-    LlJump(std::string* jumpToLabel) : jumpToLabel(jumpToLabel) {this->isJumpInst = true; this->conditionalJump = false;}
-    ~LlJump() override {
-        delete jumpToLabel;
-    }
+    static bool classof(const Ll* ll) { return ll->getKind() >= LlKind::Jump && ll->getKind() <= LlKind::Switch; }
 
-    std::string* getJumpToLabel() {
+    LlJump(LlLabel jumpToLabel) : jumpToLabel(jumpToLabel) {kind = LlKind::Jump; this->isJumpInst = true; this->conditionalJump = false;}
+    ~LlJump() override = default;
+
+    LlLabel getJumpToLabel() const {
         return jumpToLabel;
     }
 
@@ -446,20 +642,20 @@ public:
         return this->conditionalJump;
     }
 
-    std::string toString() const override{
-        return "goto " + *(this->jumpToLabel);
+    void print(std::ostream& out) const override {
+        out << "goto " << this->jumpToLabel;
     }
     bool operator==(const Ll& other) const override{
         if (&other == this) {
             return true;
         }
-        if (auto otherJump = dynamic_cast<const LlJump*>(&other)) {
-            return *jumpToLabel == *otherJump->jumpToLabel;
+        if (auto otherJump = dyn_cast<LlJump>(&other)) {
+            return jumpToLabel == otherJump->jumpToLabel;
         }
         return false;
     }
     virtual std::size_t hashCode() const override{
-        return std::hash<std::string>()(*jumpToLabel);
+        return jumpToLabel.hash();
     }
 };
 
@@ -469,83 +665,158 @@ private:
     LlComponent* condition;
 
 public:
-    LlJumpConditional(std::string* jumpToLabel, LlComponent* condition)
-        : LlJump(jumpToLabel), condition(condition) {this->conditionalJump = true;}
+    static bool classof(const Ll* ll) { return ll->getKind() == LlKind::JumpConditional; }
 
-    ~LlJumpConditional() override {
-        delete condition;
-    }
+    LlJumpConditional(LlLabel jumpToLabel, LlComponent* condition)
+        : LlJump(jumpToLabel), condition(condition) {kind = LlKind::JumpConditional; this->conditionalJump = true;}
+
+    ~LlJumpConditional() override = default;
 
     LlComponent* getCondition() {
         return this->condition;
     }
 
-    std::string toString() const override{
-        return "ifZ " + condition->toString() + " goto " + *(this->jumpToLabel);
+    void print(std::ostream& out) const override {
+        out << "ifZ " << *condition << " goto " << this->jumpToLabel;
     }
 
     bool operator==(const Ll& other) const override{
         if (&other == this) {
             return true;
         }
-        if (auto otherJump = dynamic_cast<const LlJumpConditional*>(&other)) {
-            return *jumpToLabel == *otherJump->jumpToLabel &&
+        if (auto otherJump = dyn_cast<LlJumpConditional>(&other)) {
+            return jumpToLabel == otherJump->jumpToLabel &&
                    *condition == *otherJump->condition;
         }
         return false;
     }
     std::size_t hashCode() const override {
-        return std::hash<std::string>()(*jumpToLabel) * condition->hashCode();
+        return jumpToLabel.hash() * condition->hashCode();
     }
 };
 
 // goto Label always executed when reached used for loops and break
 class LlJumpUnconditional : public LlJump {
 public:
-    LlJumpUnconditional(std::string* jumpToLabel) : LlJump(jumpToLabel) {this->conditionalJump = false;}
+    static bool classof(const Ll* ll) { return ll->getKind() == LlKind::JumpUnconditional; }
+
+    LlJumpUnconditional(LlLabel jumpToLabel) : LlJump(jumpToLabel) {kind = LlKind::JumpUnconditional; this->conditionalJump = false;}
 
     ~LlJumpUnconditional() override {}
 
-    std::string toString() const override{
-        return "goto " + *(this->jumpToLabel);
+    void print(std::ostream& out) const override {
+        out << "goto " << this->jumpToLabel;
     }
 
     bool operator==(const Ll& other) const override{
         if (&other == this) {
             return true;
         }
-        if (auto otherJump = dynamic_cast<const LlJumpUnconditional*>(&other)) {
-            return *jumpToLabel == *otherJump->jumpToLabel;
+        if (auto otherJump = dyn_cast<LlJumpUnconditional>(&other)) {
+            return jumpToLabel == otherJump->jumpToLabel;
         }
         return false;
     }
     std::size_t hashCode() const override {
-        return std::hash<std::string>()(*jumpToLabel);
+        return jumpToLabel.hash();
     }
 };
 
+// switch Value [c1: Label1, c2: Label2, ...] else Default: one jump to the label of
+// the case equal to the value, or to the default label (the jump target of the
+// base) if there is none. The cases are kept sorted by value.
+class LlSwitch : public LlJump {
+private:
+    LlComponent* value;
+    std::vector<std::pair<int, LlLabel>> cases;
+
+public:
+    static bool classof(const Ll* ll) { return ll->getKind() == LlKind::Switch; }
+
+    LlSwitch(LlComponent* value, std::vector<std::pair<int, LlLabel>> cases, LlLabel defaultLabel)
+        : LlJump(defaultLabel), value(value), cases(std::move(cases)) {
+        kind = LlKind::Switch;
+        this->conditionalJump = false;
+        std::sort(this->cases.begin(), this->cases.end(),
+                  [](const std::pair<int, LlLabel>& a, const std::pair<int, LlLabel>& b) { return a.first < b.first; });
+    }
+
+    ~LlSwitch() override = default;
+
+    LlComponent* getValue() {
+        return this->value;
+    }
+
+    const std::vector<std::pair<int, LlLabel>>& getCases() const {
+        return this->cases;
+    }
+
+    LlLabel getDefaultLabel() const {
+        return this->jumpToLabel;
+    }
+
+    void print(std::ostream& out) const override {
+        out << "switch " << *value << " [";
+        for (size_t i = 0; i < cases.size(); i++) {
+            out << (i ? ", " : "") << cases[i].first << ": " << cases[i].second;
+        }
+        out << "] else " << this->jumpToLabel;
+    }
+
+    bool operator==(const Ll& other) const override{
+        if (&other == this) {
+            return true;
+        }
+        if (auto otherSwitch = dyn_cast<LlSwitch>(&other)) {
+            return jumpToLabel == otherSwitch->jumpToLabel && cases == otherSwitch->cases &&
+                   *value == *otherSwitch->value;
+        }
+        return false;
+    }
+    std::size_t hashCode() const override {
+        std::size_t hash = jumpToLabel.hash() * value->hashCode();
+        for (const auto& entry : cases) {
+            hash = hash * 31 + entry.second.hash();
+        }
+        return hash;
+    }
+};
+
+/// call visit with every label a jump can go to: the case labels of a switch, then its target
+template <typename Visit>
+void for_each_jump_target(const LlJump* jump, Visit&& visit) {
+    if (auto* switchStmt = dyn_cast<LlSwitch>(jump)) {
+        for (const auto& entry : switchStmt->getCases()) {
+            visit(entry.second);
+        }
+    }
+    visit(jump->getJumpToLabel());
+}
+
 
 class LlLiteralBool : public LlLiteral {
 private:
     bool boolValue;
 
 public:
-    LlLiteralBool(bool boolValue) : boolValue(boolValue) {}
+    static bool classof(const Ll* ll) { return ll->getKind() == LlKind::LiteralBool; }
+
+    LlLiteralBool(bool boolValue) : boolValue(boolValue) { kind = LlKind::LiteralBool; }
     ~LlLiteralBool() override {}
 
     bool getBoolValue() {
         return this->boolValue;
     }
 
-    std::string toString() const override{
-        return this->boolValue ? "true" : "false";
+    void print(std::ostream& out) const override {
+        out << (this->boolValue ? "true" : "false");
     }
 
     bool operator==(const Ll& other) const override{
         if (&other == this) {
             return true;
         }
-        if (auto otherBool = dynamic_cast<const LlLiteralBool*>(&other)) {
+        if (auto otherBool = dyn_cast<LlLiteralBool>(&other)) {
             return this->boolValue == otherBool->boolValue;
         }
         return false;
@@ -561,22 +832,24 @@ private:
     int intValue;
 
 public:
-    LlLiteralInt(long intValue) : intValue(intValue) {}
+    static bool classof(const Ll* ll) { return ll->getKind() == LlKind::LiteralInt; }
+
+    LlLiteralInt(long intValue) : intValue(intValue) { kind = LlKind::LiteralInt; }
     ~LlLiteralInt() override {}
 
     int getValue() {
         return this->intValue;
     }
 
-    std::string toString()  const override{
-        return std::to_string(this->intValue);
+    void print(std::ostream& out) const override {
+        out << this->intValue;
     }
 
     bool operator==(const Ll& other) const override{
         if (&other == this) {
             return true;
         }
-        if (auto otherInt = dynamic_cast<const LlLiteralInt*>(&other)) {
+        if (auto otherInt = dyn_cast<LlLiteralInt>(&other)) {
             return this->intValue == otherInt->intValue;
         }
         return false;
@@ -591,22 +864,24 @@ private:
     char charValue;
 
 public:
-    LlLiteralChar(char charValue) : charValue(charValue) {}
+    static bool classof(const Ll* ll) { return ll->getKind() == LlKind::LiteralChar; }
+
+    LlLiteralChar(char charValue) : charValue(charValue) { kind = LlKind::LiteralChar; }
     ~LlLiteralChar() override {}
 
     char getValue() {
         return this->charValue;
     }
 
-    std::string toString() const override{
-        return std::string(1, this->charValue);
+    void print(std::ostream& out) const override {
+        out << this->charValue;
     }
 
     bool operator==(const Ll& other) const override{
         if (&other == this) {
             return true;
         }
-        if (auto otherChar = dynamic_cast<const LlLiteralChar*>(&other)) {
+        if (auto otherChar = dyn_cast<LlLiteralChar>(&other)) {
             return this->charValue == otherChar->charValue;
         }
         return false;
@@ -620,24 +895,24 @@ class LlLiteralString : public LlLiteral {
 private:
     std::string* stringValue;
 public:
-    LlLiteralString(std::string* stringValue) : stringValue(stringValue) {}
-    ~LlLiteralString() override {
-        delete stringValue;
-    }
+    static bool classof(const Ll* ll) { return ll->getKind() == LlKind::LiteralString; }
+
+    LlLiteralString(std::string* stringValue) : stringValue(LlPool::adopt(stringValue)) { kind = LlKind::LiteralString; }
+    ~LlLiteralString() override = default;
 
     std::string* getValue() {
         return this->stringValue;
     }
 
-    std::string toString() const override{
-        return *(this->stringValue);
+    void print(std::ostream& out) const override {
+        out << *(this->stringValue);
     }
 
     bool operator==(const Ll& other) const override{
         if (&other == this) {
             return true;
         }
-        if (auto otherLlString = dynamic_cast<const LlLiteralString*>(&other)) {
+        if (auto otherLlString = dyn_cast<LlLiteralString>(&other)) {
             return *otherLlString->stringValue == *this->stringValue;
         }
         return false;
@@ -652,31 +927,32 @@ private:
     LlComponent* elementIndex;
 
 public:
-    LlLocationArray(std::string* varName, LlComponent* elementIndex) : LlLocation(varName), elementIndex(elementIndex) {}
-    ~LlLocationArray() override {
-        delete elementIndex;
-    }
+    static bool classof(const Ll* ll) { return ll->getKind() == LlKind::LocationArray; }
+
+    LlLocationArray(std::string* varName, LlComponent* elementIndex) : LlLocation(varName), elementIndex(elementIndex) { kind = LlKind::LocationArray; }
+    ~LlLocationArray() override = default;
 
     LlComponent* getElementIndex() {
         return this->elementIndex;
     }
 
-    std::string toString() const override{
-        return *(this->getVarName()) + "[" + elementIndex->toString() + "] ";
+    void print(std::ostream& out) const override {
+        printName(out);
+        out << "[" << *elementIndex << "] ";
     }
 
     bool operator==(const Ll& other) const override{
         if (&other == this) {
             return true;
         }
-        if (auto otherArray = dynamic_cast<const LlLocationArray*>(&other)) {
-            return *otherArray->getVarName() == *this->getVarName() &&
+        if (auto otherArray = dyn_cast<LlLocationArray>(&other)) {
+            return sameName(*otherArray) &&
                    *otherArray->elementIndex == *this->elementIndex;
         }
         return false;
     }
     std::size_t hashCode() const override{
-        return std::hash<std::string>()(*getVarName()) * elementIndex->hashCode();
+        return nameHash() * elementIndex->hashCode();
     }
 
     std::string getArrayHead(std::string arrayLocation) {
@@ -687,31 +963,34 @@ public:
 
 class LlLocationVar : public LlLocation {
 public:
-    LlLocationVar(std::string* varName) : LlLocation(varName) {}
+    static bool classof(const Ll* ll) { return ll->getKind() == LlKind::LocationVar; }
+
+    LlLocationVar(std::string* varName) : LlLocation(varName) { kind = LlKind::LocationVar; }
+    explicit LlLocationVar(SymbolId symbol) : LlLocation(symbol) { kind = LlKind::LocationVar; }
+    explicit LlLocationVar(LlTemp temp) : LlLocation(temp) { kind = LlKind::LocationVar; }
     ~LlLocationVar() override {}
 
 
-    std::string toString() const override{
-        return *(this->getVarName());
+    void print(std::ostream& out) const override {
+        LlLocation::print(out);
     }
 
     bool operator==(const Ll& other) const override{
         if (&other == this) {
             return true;
         }
-        if (auto otherVar = dynamic_cast<const LlLocationVar*>(&other)) {
-            return *otherVar->getVarName() == *this->getVarName();
+        if (auto otherVar = dyn_cast<LlLocationVar>(&other)) {
+            return sameName(*otherVar);
         }
         return false;
     }
 
     std::size_t hashCode() const override{
-        std::hash<std::string> hasher;
-        return hasher(*(this->getVarName()));
+        return nameHash();
     }
 
     bool isStringLoc() {
-        return this->getVarName()->find("str") != std::string::npos;
+        return isTemp() ? getTemp().isString() : this->getVarName()->find("str") != std::string::npos;
     }
 };
 
@@ -722,14 +1001,11 @@ private:
     std::vector<LlComponent*> argsList;
 
 public:
+    static bool classof(const Ll* ll) { return ll->getKind() == LlKind::MethodCallStmt; }
+
     LlMethodCallStmt(const std::string methodName, std::vector<LlComponent*> argsList, LlLocation* returnLocation)
-        : methodName(methodName), argsList(argsList), returnLocation(returnLocation) {}
-    ~LlMethodCallStmt() override {
-        delete returnLocation;
-        for (LlComponent* arg : argsList) {
-            delete arg;
-        }
-    }
+        : methodName(methodName), argsList(argsList), returnLocation(returnLocation) { kind = LlKind::MethodCallStmt; }
+    ~LlMethodCallStmt() override = default;
 
     std::string getMethodName() {
         return this->methodName;
@@ -743,19 +1019,19 @@ public:
         return this->argsList;  // Return a copy of the vector
     }
 
-    std::string toString() const override{
-        std::string argsString = "";
+    void print(std::ostream& out) const override {
+        out << *this->returnLocation << " = " << this->methodName << "(";
         for(auto &arg : argsList){
-            argsString +=  arg->toString() +",";
+            out << *arg << ",";
         }
-        return this->returnLocation->toString() + " = " + this->methodName + "(" + argsString +")" ;
+        out << ")";
     }
 
     bool operator==(const Ll& other) const override{
         if (&other == this) {
             return true;
         }
-        if (auto otherMethod = dynamic_cast<const LlMethodCallStmt*>(&other)) {
+        if (auto otherMethod = dyn_cast<LlMethodCallStmt>(&other)) {
             if (methodName != otherMethod->methodName || !(*returnLocation == *otherMethod->returnLocation) || argsList.size() != otherMethod->argsList.size()) {
                 return false;
             }
@@ -783,11 +1059,13 @@ private:
     std::string parallelMethodName;
 
 public:
-    LlParallelMethodStmt(std::string methodName) : parallelMethodName(methodName) {}
+    static bool classof(const Ll* ll) { return ll->getKind() == LlKind::ParallelMethodStmt; }
+
+    LlParallelMethodStmt(std::string methodName) : parallelMethodName(methodName) { kind = LlKind::ParallelMethodStmt; }
     ~LlParallelMethodStmt() override {}
 
-    std::string toString() const override {
-        return "create_and_run_threads(" + this->parallelMethodName + ")";
+    void print(std::ostream& out) const override {
+        out << "create_and_run_threads(" << this->parallelMethodName << ")";
     }
 };
 
@@ -797,27 +1075,28 @@ private:
     LlComponent* returnValue;
 
 public:
-    LlReturn(LlComponent* returnValue) : returnValue(returnValue) {}
-    ~LlReturn() override {
-        delete returnValue;
-    }
+    static bool classof(const Ll* ll) { return ll->getKind() == LlKind::Return; }
+
+    LlReturn(LlComponent* returnValue) : returnValue(returnValue) { kind = LlKind::Return; }
+    ~LlReturn() override = default;
 
     LlComponent* getReturnValue() {
         return this->returnValue;
     }
 
-    std::string toString() const override{
+    void print(std::ostream& out) const override {
         if (this->returnValue == nullptr) {
-            return "return ";
+            out << "return ";
+            return;
         }
-        return "return " + this->returnValue->toString();
+        out << "return " << *this->returnValue;
     }
 
     bool operator==(const Ll& other) const override{
         if (&other == this) {
             return true;
         }
-        if (auto otherReturn = dynamic_cast<const LlReturn*>(&other)) {
+        if (auto otherReturn = dyn_cast<LlReturn>(&other)) {
             if (returnValue == nullptr) {
                 return otherReturn->returnValue == nullptr;
             }
@@ -856,12 +1135,12 @@ private:
     const std::string* aliasName;
 
 public:
+    static bool classof(const Ll* ll) { return ll->getKind() == LlKind::LocationTypeAlias; }
+
     LlLocationTypeAlias(std::string* aliasName)
-        : LlLocation(aliasName), aliasName(aliasName) {}
+        : LlLocation(aliasName), aliasName(aliasName) { kind = LlKind::LocationTypeAlias; }
 
-    ~LlLocationTypeAlias() override {
-        delete aliasName;
-    }
+    ~LlLocationTypeAlias() override = default;
 
     // Override getVarName to return aliasName directly
     const std::string* getAliasTypeName() const {
@@ -869,8 +1148,8 @@ public:
     }
 
     // Override toString for clarity
-    std::string toString() const override {
-        return "TypeAlias: " + *aliasName;
+    void print(std::ostream& out) const override {
+        out << "TypeAlias: " << *aliasName;
     }
 };
 
@@ -881,12 +1160,12 @@ private:
     int offset;
 
 public:
+    static bool classof(const Ll* ll) { return ll->getKind() == LlKind::LocationStruct; }
+
     LlLocationStruct(LlLocation* baseLocation, const std::string& fieldName, int offset)
-        : LlLocation(baseLocation->getVarName()), baseLocation(baseLocation), fieldName(fieldName), offset(offset) {}
+        : LlLocation(baseLocation), baseLocation(baseLocation), fieldName(fieldName), offset(offset) { kind = LlKind::LocationStruct; }
 
-    ~LlLocationStruct() override {
-        delete baseLocation;
-    }
+    ~LlLocationStruct() override = default;
 
     LlLocation* getBaseLocation() const {
         return baseLocation;
@@ -900,12 +1179,12 @@ public:
         return offset;
     }
 
-    std::string toString() const override {
-        return baseLocation->toString() + "->" + fieldName;
+    void print(std::ostream& out) const override {
+        out << *baseLocation << "->" << fieldName;
     }
 
     bool operator==(const Ll& other) const override {
-        if (auto* otherField = dynamic_cast<const LlLocationStruct*>(&other)) {
+        if (auto* otherField = dyn_cast<LlLocationStruct>(&other)) {
             return *baseLocation == *(otherField->baseLocation) && fieldName == otherField->fieldName;
         }
         return false;
@@ -2,41 +2,151 @@
 #define LL_BUILDER_H
 
 #include <unordered_map>
+#include <utility>
 #include <string>
 #include <vector>
 #include <stack>
 #include <sstream>
 #include <iomanip>
+#include <cstdint>
+#include <algorithm>
 #include "Ll.h"
 
-// Generated Ll Ir for a single scope
+// Generated Ll Ir for a single scope. Statements are kept in insertion order in
+// one vector, their labels in a parallel one; labelIndex maps a label's key()
+// back to its position, for jump targets.
+// With setBuildBlocks the builder also records the basic blocks as statements
+// are appended: a block ends at a jump and the next one starts after it, at a
+// label a jump was emitted to, or at a leader the lowering marks (a loop
+// header that is jumped back to). CFGBuilder then takes the blocks as they are.
 class LlBuilder {
 private:
+    static constexpr uint32_t NoStatement = ~0u;
+
     std::string name;
-    std::unordered_map<std::string, LlStatement*> statementTable;
-    std::vector<std::string> insertionOrder;
-    int labelCounter = 0;
-    int tempCounter = 0;
+    std::vector<LlStatement*> statements;
+    std::vector<LlLabel> insertionOrder;
+    std::vector<uint32_t> labelIndex;
+    std::unordered_map<SymbolId, uint32_t> namedIndex;
+    uint32_t labelCounter = 0;
+    uint32_t tempCounter = 0;
     std::deque<LlLocationVar*> params;
     bool arrLeftSide = false;
-    std::stack<std::string> currentBlockLabel;
-    std::stack<std::string> loopExitStack; // Stack to store the exit label of the loop
+    std::stack<LlLabel> currentBlockLabel;
+    std::stack<LlLabel> loopExitStack; // Stack to store the exit label of the loop
     std::string currentLoopCondition;
     Ll* pocket = nullptr;
 
+    bool twoWaySwitches = false;
+    bool buildBlocks = false;
+    bool blocksValid = true;                // false once a jump goes back into the middle of a block
+    bool afterJump = false;
+    std::vector<uint32_t> blockStarts;      // position of each block's first statement
+    std::vector<std::pair<uint32_t, uint32_t>> blockJumps;  // (block, a block its last jump can go to)
+    std::vector<bool> blockFallsThrough;    // false if a block ends in an unconditional jump
+    std::unordered_map<LlLabel, std::vector<uint32_t>, LlLabel::Hash> pendingJumps;  // blocks jumping to labels not placed yet
+
+    void recordJump(uint32_t block, LlLabel target) {
+        size_t targetIndex = indexOf(target);
+        if (targetIndex != npos) {
+            auto start = std::lower_bound(blockStarts.begin(), blockStarts.end(), static_cast<uint32_t>(targetIndex));
+            if (start != blockStarts.end() && *start == targetIndex) {
+                blockJumps.emplace_back(block, static_cast<uint32_t>(start - blockStarts.begin()));
+            } else {
+                blocksValid = false;
+            }
+        } else if (target.isValid()) {
+            pendingJumps[target].push_back(block);
+        }
+    }
+
+    // open a block at the statement just appended if it is a leader, and note
+    // where the current block goes if the statement is a jump
+    void recordBlock(LlLabel label, LlStatement* statement, bool leader) {
+        uint32_t index = static_cast<uint32_t>(statements.size() - 1);
+        auto pending = pendingJumps.empty() ? pendingJumps.end() : pendingJumps.find(label);
+        if (index == 0 || afterJump || leader || pending != pendingJumps.end()) {
+            blockStarts.push_back(index);
+            blockFallsThrough.push_back(true);
+        }
+        uint32_t block = static_cast<uint32_t>(blockStarts.size() - 1);
+        if (pending != pendingJumps.end()) {
+            for (uint32_t from : pending->second) {
+                blockJumps.emplace_back(from, block);
+            }
+            pendingJumps.erase(pending);
+        }
+
+        afterJump = statement->isJump();
+        if (!afterJump) {
+            return;
+        }
+        LlJump* jump = cast<LlJump>(statement);
+        blockFallsThrough[block] = jump->isConditionalJump();
+        for_each_jump_target(jump, [&](LlLabel target) { recordJump(block, target); });
+    }
+
+    void append(LlLabel label, LlStatement* statement, bool leader = false) {
+        if (label.isNamed()) {
+            namedIndex[label.symbol()] = static_cast<uint32_t>(statements.size());
+            insertionOrder.push_back(label);
+            statements.push_back(statement);
+            if (buildBlocks) {
+                recordBlock(label, statement, leader);
+            }
+            return;
+        }
+        size_t key = label.key();
+        if (key >= labelIndex.size()) {
+            labelIndex.resize(std::max(key + 1, labelIndex.size() * 2), NoStatement);
+        }
+        labelIndex[key] = static_cast<uint32_t>(statements.size());
+        insertionOrder.push_back(label);
+        statements.push_back(statement);
+        if (buildBlocks) {
+            recordBlock(label, statement, leader);
+        }
+    }
+
 public:
     LlBuilder(std::string name) : name(name) {}
-    ~LlBuilder() {
-        for(auto& pair : statementTable){
-            delete pair.second;
+    // statements and params belong to the LlPool that was current when they were created
+    ~LlBuilder() = default;
+
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+    /// the labels of the statements, in insertion order
+    const std::vector<LlLabel>& getInsertionOrder() const {
+        return this->insertionOrder;
+    }
+
+    /// the statements in insertion order, statement i has label getInsertionOrder()[i]
+    const std::vector<LlStatement*>& getStatements() const {
+        return this->statements;
+    }
+
+    size_t size() const {
+        return statements.size();
+    }
+
+    /// @return the position of the statement with this label, npos if there is none
+    size_t indexOf(LlLabel label) const {
+        if (label.isNamed()) {
+            auto it = namedIndex.find(label.symbol());
+            return it != namedIndex.end() ? it->second : npos;
         }
-        for(auto& param : params){
-            delete param;
+        size_t key = label.key();
+        if (!label.isValid() || key >= labelIndex.size() || labelIndex[key] == NoStatement) {
+            return npos;
         }
+        // a case label shares its slot with no other label, but check its value too
+        return insertionOrder[labelIndex[key]] == label ? labelIndex[key] : npos;
     }
 
-    std::vector<std::string> getInsertionOrder(){
-        return this->insertionOrder;
+    /// @return the statement with this label, nullptr if there is none
+    LlStatement* getStatement(LlLabel label) const {
+        size_t index = indexOf(label);
+        return index != npos ? statements[index] : nullptr;
     }
 
     std::string getName() {
@@ -47,46 +157,86 @@ public:
         params.push_front(param);
     }
 
-    void setStatementTable(std::unordered_map<std::string, LlStatement*> statementTable) {
-        this->statementTable = statementTable;
-    }
-
     void appendStatement(LlStatement* statement){
-        std::string label = this->generateLabel();
-        insertionOrder.push_back(label);
-        statementTable[label] = statement;
+        append(this->generateLabel(), statement);
     }
 
-    void appendStatement(std::string label, LlStatement* statement){
-        if(statementTable.find(label) != statementTable.end()){
+    void appendStatement(LlLabel label, LlStatement* statement, bool leader = false){
+        if(indexOf(label) != npos){
             std::cerr << "Duplicate label key . Please use the label generator! " << std::endl;
             std::cerr << "Key :" << label << std::endl;
             std::cerr << "Statement : " << statement->toString() << std::endl;
             std::cerr << "StackSize " << labelCounter << std::endl;
         }
         else{
-            insertionOrder.push_back(label);
-            statementTable[label] = statement;
+            append(label, statement, leader);
+        }
+    }
+
+    /// append a statement that starts a basic block even though no jump to it
+    /// has been emitted yet, such as a loop header that the loop jumps back to
+    void appendLeader(LlLabel label, LlStatement* statement){
+        appendStatement(label, statement, true);
+    }
+
+    /// lower switch statements to a balanced tree of conditional jumps instead of
+    /// one LlSwitch, for consumers that only handle two-way branches
+    void setTwoWaySwitches(bool twoWay) {
+        twoWaySwitches = twoWay;
+    }
+
+    bool hasTwoWaySwitches() const {
+        return twoWaySwitches;
+    }
+
+    /// record basic blocks while statements are appended (see the class comment);
+    /// only takes effect on an empty builder
+    void setBuildBlocks(bool build) {
+        buildBlocks = build && statements.empty();
+    }
+
+    /// @return whether blocks were recorded and every jump lands on the start of one
+    bool hasBlocks() const {
+        return buildBlocks && blocksValid;
+    }
+
+    /// the position of the first statement of each recorded block, ascending
+    const std::vector<uint32_t>& getBlockStarts() const {
+        return blockStarts;
+    }
+
+    /// the jumps between recorded blocks, as (block, block it jumps to); a jump to a
+    /// label that was never appended has none
+    const std::vector<std::pair<uint32_t, uint32_t>>& getBlockJumps() const {
+        return blockJumps;
+    }
+
+    /// @return whether recorded block i can continue with block i + 1
+    bool fallsThrough(size_t block) const {
+        return blockFallsThrough[block];
+    }
+
+    /// append another builder's statements, shared with it, under fresh labels;
+    /// only for code without jumps, such as the globals of a header
+    void appendStatements(const LlBuilder& other) {
+        statements.reserve(statements.size() + other.statements.size());
+        for (LlStatement* statement : other.statements) {
+            appendStatement(statement);
         }
     }
 
     // Tied to the the builder, representing the specific block of instructions
-    std::string generateLabel(){
-       return "L" + std::to_string(labelCounter++);
+    // The labels of a compound statement are derived from it with LlLabel::as
+    LlLabel generateLabel(){
+       return LlLabel(LlLabelKind::Plain, labelCounter++);
     }
 
     LlLocationVar* generateTemp(){
-        std::string* t =  new std::string();
-        t->append("#_t");
-        t->append(std::to_string(tempCounter++));
-        return new LlLocationVar(t);
+        return new LlLocationVar(LlTemp(tempCounter++, false));
     }
 
     LlLocationVar* generateStrTemp(){
-        std::string* t =  new std::string();
-        t->append("#str_t");
-        t->append(std::to_string(tempCounter++));
-        return new LlLocationVar(t);
+        return new LlLocationVar(LlTemp(tempCounter++, true));
     }
 
     void putInPocket(Ll* o){
@@ -101,26 +251,23 @@ public:
         return this->pocket;
     }
 
-    std::unordered_map<std::string, LlStatement*> getStatementTable() {
-        return statementTable;
-    }
-
     void getOutOfBlock(){
         currentBlockLabel.pop();
     }
 
-    std::string getCurrentBlock(){
+    /// @return the label of the innermost loop, invalid outside of loops
+    LlLabel getCurrentBlock(){
         if(currentBlockLabel.size() > 0){
             return currentBlockLabel.top();
         }
-        return "";
+        return LlLabel();
     }
 
-    void getInBlock(std::string loopLabel){
+    void getInBlock(LlLabel loopLabel){
         currentBlockLabel.push(loopLabel);
     }
 
-    void getInBlock(std::string loopLabel, std::string loopCondition){
+    void getInBlock(LlLabel loopLabel, std::string loopCondition){
         currentBlockLabel.push(loopLabel);
         this->currentLoopCondition = loopCondition;
     }
@@ -129,31 +276,36 @@ public:
         return this->currentLoopCondition;
     }
 
-    void pushLoopExit(std::string exitLabel){
+    void pushLoopExit(LlLabel exitLabel){
         loopExitStack.push(exitLabel);
     }
 
-    std::string getCurrentLoopExit(){
+    /// @return the label a break jumps to, invalid outside of loops and switches
+    LlLabel getCurrentLoopExit(){
         if(!loopExitStack.empty()){
             return loopExitStack.top();
         }
-        return "";
+        return LlLabel();
     }
 
     void popLoopExit(){
         loopExitStack.pop();
     }
 
-    std::string toString() {
-        std::stringstream st;
+    // write the statements in insertion order, one "label : statement" line each
+    void print(std::ostream& st) const {
         const int labelWidth = 15;
 
         st << "IR for Builder: " << this->name << "\n";
 
-        for (const auto& label : insertionOrder) {
-            std::string statement = statementTable[label]->toString();
-            st << std::right << std::setw(labelWidth) << label << " : " << statement << "\n";
+        for (size_t i = 0; i < statements.size(); i++) {
+            st << std::right << std::setw(labelWidth) << insertionOrder[i] << " : " << *statements[i] << "\n";
         }
+    }
+
+    std::string toString() const {
+        std::stringstream st;
+        print(st);
         return st.str();
     }
 };
@@ -32,12 +32,19 @@ public:
         return symbolTables;
     }
 
-    std::string toString() {
-        std::stringstream str;
+    // write every builder and its symbol table, one builder at a time
+    void print(std::ostream& str) {
         for (int i = 0; i < builders.size(); i++) {
-            str << builders[i]->toString() << std::endl;
-            str << symbolTables[i]->toString() << std::endl;
+            builders[i]->print(str);
+            str << std::endl;
+            symbolTables[i]->print(str);
+            str << std::endl;
         }
+    }
+
+    std::string toString() {
+        std::stringstream str;
+        print(str);
         return str.str();
     }
 };
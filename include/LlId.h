@@ -0,0 +1,159 @@
+// Typed integer ids for the labels and temporaries an LlBuilder generates
+
+#ifndef LL_ID_H
+#define LL_ID_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <ostream>
+#include "Interner.h"
+
+// What a label was generated for; it picks the prefix of the rendered name
+enum class LlLabelKind : uint8_t {
+    Plain,          // L3
+    IfEnd,          // if.end.L3
+    IfElse,         // if.else.L3
+    ForCond,        // for.cond.L3
+    ForBody,
+    ForInc,
+    ForEnd,
+    WhileCond,      // while.cond.L3
+    WhileBody,
+    WhileEnd,
+    SwitchEnd,      // switch.end.L3
+    Case,           // case.<value>.L3
+    Default,        // default.L3
+    Named,          // an interned name such as the function's, see LlLabel::named
+};
+
+// A statement label: the kind in the top bits and the builder's label number
+// below, plus the value of a case label. The labels of one if/for/while
+// statement share a number and differ in kind, so (number, slot) is unique
+// within a builder and indexes a flat table. The name is only rendered when
+// the label is printed. A named label carries the SymbolId of its name instead
+// and is indexed by the builder on the side.
+class LlLabel {
+private:
+    static constexpr unsigned NumberBits = 27;
+    static constexpr uint32_t NumberMask = (1u << NumberBits) - 1;
+    static constexpr uint32_t Invalid = ~0u;
+
+    uint32_t bits = Invalid;
+    int32_t value = 0;
+
+public:
+    /// labels of one statement sharing a number, at most the four of a for loop
+    static constexpr unsigned SlotsPerNumber = 4;
+
+    LlLabel() = default;
+    LlLabel(LlLabelKind kind, uint32_t number, int32_t value = 0)
+        : bits(static_cast<uint32_t>(kind) << NumberBits | (number & NumberMask)), value(value) {}
+
+    bool isValid() const { return bits != Invalid; }
+    LlLabelKind kind() const { return static_cast<LlLabelKind>(bits >> NumberBits); }
+    uint32_t number() const { return bits & NumberMask; }
+    int32_t caseValue() const { return value; }
+
+    /// a label that prints as name, e.g. the function name on a function's first statement
+    static LlLabel named(std::string_view name) {
+        return LlLabel(LlLabelKind::Named, 0, static_cast<int32_t>(intern(name)));
+    }
+
+    bool isNamed() const { return isValid() && kind() == LlLabelKind::Named; }
+    SymbolId symbol() const { return static_cast<SymbolId>(value); }
+
+    /// the label of the same statement for another part of it, e.g. its "if.end."
+    LlLabel as(LlLabelKind kind, int32_t value = 0) const { return LlLabel(kind, number(), value); }
+
+    /// position among the labels sharing the number
+    unsigned slot() const {
+        switch (kind()) {
+            case LlLabelKind::IfElse:
+            case LlLabelKind::ForBody:
+            case LlLabelKind::WhileBody:
+                return 1;
+            case LlLabelKind::ForInc:
+            case LlLabelKind::WhileEnd:
+                return 2;
+            case LlLabelKind::ForEnd:
+                return 3;
+            default:
+                return 0;
+        }
+    }
+
+    /// dense key for tables indexed by label, below SlotsPerNumber * (highest number + 1)
+    size_t key() const { return static_cast<size_t>(number()) * SlotsPerNumber + slot(); }
+
+    /// write the name into buffer, which needs room for 48 characters; not for named labels
+    /// @return its length
+    size_t render(char* buffer) const {
+        static const char* const prefixes[] = {"", "if.end.", "if.else.", "for.cond.", "for.body.", "for.inc.", "for.end.",
+                                               "while.cond.", "while.body.", "while.end.", "switch.end.", "case.", "default."};
+        unsigned index = static_cast<unsigned>(kind());
+        const char* prefix = index < sizeof(prefixes) / sizeof(prefixes[0]) ? prefixes[index] : "";
+        int length = kind() == LlLabelKind::Case
+                         ? std::snprintf(buffer, 48, "%s%d.L%u", prefix, static_cast<int>(value), static_cast<unsigned>(number()))
+                         : std::snprintf(buffer, 48, "%sL%u", prefix, static_cast<unsigned>(number()));
+        return length > 0 ? static_cast<size_t>(length) : 0;
+    }
+
+    std::string toString() const {
+        if (isNamed()) {
+            return symbol_name(symbol());
+        }
+        char buffer[48];
+        return std::string(buffer, render(buffer));
+    }
+
+    bool operator==(const LlLabel& that) const { return bits == that.bits && value == that.value; }
+    bool operator!=(const LlLabel& that) const { return !(*this == that); }
+    size_t hash() const { return bits ^ static_cast<size_t>(value) << 5; }
+
+    struct Hash {
+        size_t operator()(const LlLabel& label) const { return label.hash(); }
+    };
+};
+
+// written as one item, so a field width applies to the whole name
+inline std::ostream& operator<<(std::ostream& out, const LlLabel& label) {
+    if (label.isNamed()) {
+        return out << symbol_name(label.symbol());
+    }
+    char buffer[48];
+    return out << std::string_view(buffer, label.render(buffer));
+}
+
+// A compiler temporary: bit 31 marks a temp, bit 30 a string temp, the builder's
+// temp number is below. Rendered as #_t<n> or #str_t<n>.
+class LlTemp {
+private:
+    static constexpr uint32_t TempBit = 1u << 31;
+    static constexpr uint32_t StringBit = 1u << 30;
+    static constexpr uint32_t NumberMask = StringBit - 1;
+
+    uint32_t bits = 0;
+
+public:
+    LlTemp() = default;
+    LlTemp(uint32_t number, bool string) : bits(TempBit | (string ? StringBit : 0) | (number & NumberMask)) {}
+
+    bool isValid() const { return bits & TempBit; }
+    bool isString() const { return bits & StringBit; }
+    uint32_t number() const { return bits & NumberMask; }
+
+    std::string toString() const {
+        return (isString() ? "#str_t" : "#_t") + std::to_string(number());
+    }
+
+    bool operator==(const LlTemp& that) const { return bits == that.bits; }
+    size_t hash() const { return bits; }
+};
+
+inline std::ostream& operator<<(std::ostream& out, const LlTemp& temp) {
+    return out << (temp.isString() ? "#str_t" : "#_t") << temp.number();
+}
+
+#endif
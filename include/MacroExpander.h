@@ -0,0 +1,132 @@
+// Object-like and function-like #define expansion over token spans (--expand-macros)
+
+#ifndef MACRO_EXPANDER_H
+#define MACRO_EXPANDER_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <functional>
+#include <unordered_map>
+#include <cstdint>
+
+// One preprocessing token: a span of the text it was lexed from
+struct MacroToken {
+    std::string_view text;
+    bool spaceBefore = false;
+    bool lineStart = false;     // first token on its line, only tracked for source text
+    int param = -1;             // in a macro body: the parameter it names, __VA_ARGS__ is the last one
+};
+
+// Splits text into tokens; comments, whitespace and backslash-newlines only set spaceBefore
+class MacroLexer {
+private:
+    std::string_view text;
+    size_t pos = 0;
+
+public:
+    explicit MacroLexer(std::string_view text) : text(text) {}
+
+    /// @return false at the end of the text
+    bool next(MacroToken& token);
+    size_t position() const { return pos; }
+    void seek(size_t position) { pos = position; }
+};
+
+// A #define; the body tokens are spans of its own copy of the replacement text
+struct MacroDefinition {
+    std::string name;
+    bool functionLike = false;
+    bool variadic = false;
+    std::vector<std::string> params;
+    std::string body;
+    std::vector<MacroToken> tokens;
+
+    /// parse the tokens of a directive after "define"
+    /// @return nullptr if there is no macro name
+    static std::shared_ptr<const MacroDefinition> parse(std::string_view directive);
+};
+
+// The macros defined at one point of a file. Keys are views of the definitions'
+// own names, so an entry is replaced through define_macro, never by assignment.
+typedef std::unordered_map<std::string_view, std::shared_ptr<const MacroDefinition>> MacroTable;
+
+inline void define_macro(MacroTable& table, const std::shared_ptr<const MacroDefinition>& macro) {
+    table.erase(macro->name);
+    table.emplace(macro->name, macro);
+}
+
+// Expands macro uses in C source text. Directives are left in place and
+// followed in order: #define and #undef update the table, #include merges
+// the macros of a header (if a resolver is given). Conditionals are not
+// evaluated, every branch is expanded with the macros defined so far.
+// Text without macro uses is copied unchanged, and a use spanning several
+// lines is followed by the same number of newlines, so rows stay put.
+//
+// Each use in the source is memoized by the macro table it was expanded with
+// (a fingerprint of every definition so far), the macro and a hash of its
+// argument tokens, so units sharing headers also share their expansions.
+// One expander is not thread-safe; the Driver keeps one per worker.
+class MacroExpander {
+public:
+    /// the macros a header ends up defining, nullptr if it is not found
+    typedef std::function<const MacroTable*(std::string_view name, bool system)> IncludeResolver;
+
+private:
+    struct MemoKey {
+        uint64_t table;
+        uint64_t macro;
+        uint64_t args;
+        bool operator==(const MemoKey& that) const { return table == that.table && macro == that.macro && args == that.args; }
+    };
+    struct MemoKeyHash {
+        size_t operator()(const MemoKey& key) const { return key.table ^ (key.macro * 31) ^ (key.args * 1099511628211ULL); }
+    };
+    struct MemoEntry {
+        std::string use;        // the name and arguments as written, checked on a hit
+        std::string expansion;
+    };
+    static constexpr size_t MaxMemoEntries = 1 << 16;
+
+    // A token during expansion: the macros it came out of may not expand it again
+    struct Token {
+        std::string_view text;
+        bool spaceBefore = false;
+        std::vector<const MacroDefinition*> hideSet;
+
+        bool hides(const MacroDefinition* macro) const;
+    };
+
+    MacroTable table;
+    uint64_t fingerprint = 0;
+    std::unordered_map<MemoKey, MemoEntry, MemoKeyHash> memo;
+    std::deque<std::string> scratch;    // text of pasted and stringized tokens
+    size_t expansions = 0;
+    size_t memoHits = 0;
+
+    void directive(std::string_view text, const IncludeResolver& resolver);
+    const MacroDefinition* find(std::string_view name) const;
+
+    void expand(std::deque<Token>& pending, std::vector<Token>& output, const std::function<bool(Token&)>& pull);
+    bool collectArgs(std::deque<Token>& pending, const std::function<bool(Token&)>& pull, const MacroDefinition* macro,
+                     std::vector<std::vector<Token>>& args, Token& closing);
+    std::vector<Token> substitute(const MacroDefinition* macro, const std::vector<std::vector<Token>>& args,
+                                  const std::vector<const MacroDefinition*>& hideSet);
+    std::string_view stringize(const std::vector<Token>& arg);
+    std::string_view paste(std::string_view left, std::string_view right);
+
+public:
+    /// copy source to expanded with every macro use replaced
+    /// @return false (and expanded untouched) if nothing needed expanding
+    bool expandSource(std::string_view source, std::string& expanded, const IncludeResolver& resolver = nullptr);
+
+    /// apply the #define and #undef lines of text to a table, without expanding anything
+    static void collectDefinitions(std::string_view text, MacroTable& table);
+
+    size_t getExpansions() const { return expansions; }
+    size_t getMemoHits() const { return memoHits; }
+};
+
+#endif
@@ -0,0 +1,88 @@
+// Buffered destination for the textual report and the DOT artifacts (--output)
+
+#ifndef OUTPUT_SINK_H
+#define OUTPUT_SINK_H
+
+#include <string>
+#include <vector>
+#include <ostream>
+#include <streambuf>
+
+// A streambuf writing to a file descriptor through one large buffer.
+// A write that does not fit is sent together with the buffered bytes in a
+// single writev, so large blocks are never copied into the buffer.
+class SinkBuffer : public std::streambuf {
+private:
+    int fd = -1;
+    bool ownsFd = false;
+    bool failed = false;
+    std::vector<char> buffer;
+
+    bool writeOut(const char* extra, size_t extraSize);
+
+protected:
+    int_type overflow(int_type ch) override;
+    std::streamsize xsputn(const char* s, std::streamsize n) override;
+    int sync() override;
+
+public:
+    explicit SinkBuffer(size_t capacity = 1 << 20);
+    ~SinkBuffer();
+
+    SinkBuffer(const SinkBuffer&) = delete;
+    SinkBuffer& operator=(const SinkBuffer&) = delete;
+
+    /// flush and close the current descriptor (if owned) and continue on a new one
+    void attach(int fd, bool ownsFd);
+
+    /// @return false if any write since the last attach failed
+    bool close();
+    bool flush() { return writeOut(nullptr, 0); }
+
+    int getFd() const { return fd; }
+};
+
+// Where one run's output goes, chosen by --output:
+//   "-"                      everything on stdout
+//   a directory or "dir/"    out.txt for the report, one file per artifact
+//   anything else            everything in that one file
+// In the single-stream modes artifacts follow each other in one buffered
+// stream, each introduced by a "// ==== <name>" line. Producers write
+// straight into the stream, nothing is assembled in memory first.
+class OutputSink {
+private:
+    std::string directory;      // empty in the single-stream modes
+    SinkBuffer textBuffer;
+    SinkBuffer artifactBuffer;  // only used in directory mode
+    std::ostream textStream;
+    std::ostream artifactStream;
+    bool artifactOpen = false;
+    bool failed = false;
+
+    OutputSink();
+
+public:
+    /// @return nullptr (after reporting why) if the target cannot be opened
+    static OutputSink* open(const std::string& target);
+    ~OutputSink();
+
+    OutputSink(const OutputSink&) = delete;
+    OutputSink& operator=(const OutputSink&) = delete;
+
+    /// the textual report (IR dumps, dominator info, ...)
+    std::ostream& text() { return textStream; }
+
+    /// start an artifact such as "cfg1.dot" and return the stream to write it to
+    std::ostream& beginArtifact(const std::string& name);
+    void endArtifact();
+
+    /// descriptor of the artifact just begun, flushed, for writers that need one (tree-sitter's DOT printer)
+    /// @return -1 if the artifact's file could not be opened
+    int artifactFd();
+
+    /// flush everything
+    /// @return false if any write failed
+    bool close();
+};
+
+#endif
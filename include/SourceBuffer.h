@@ -0,0 +1,54 @@
+// Read-only view of a translation unit's source text
+
+#ifndef SOURCE_BUFFER_H
+#define SOURCE_BUFFER_H
+
+#include <string>
+#include <string_view>
+#include <cstdint>
+
+// Holds the source of one file for the lifetime of the analysis.
+// Files are memory-mapped read-only, so the text is never copied onto the heap
+// (pipes, which cannot be mapped, are read into the buffer);
+// node text handed out by the ASTBuilder is a string_view into this buffer.
+class SourceBuffer {
+private:
+    const char* text;
+    size_t length;
+    void* mapping;          // non-null when the text lives in an mmap'ed region
+    std::string owned;      // backing storage for buffers built from a string
+
+    SourceBuffer() : text(""), length(0), mapping(nullptr) {}
+
+public:
+    /// wrap an in-memory source, e.g. an edited editor buffer
+    explicit SourceBuffer(std::string source);
+    ~SourceBuffer();
+
+    SourceBuffer(const SourceBuffer&) = delete;
+    SourceBuffer& operator=(const SourceBuffer&) = delete;
+
+    /// map a file read-only, or read it if it is not a regular file; nullptr if it cannot be opened
+    static SourceBuffer* mapFile(const std::string& filename);
+
+    /// view text owned by someone else, who must keep it alive and unchanged
+    static SourceBuffer* borrow(std::string_view source) {
+        SourceBuffer* buffer = new SourceBuffer();
+        buffer->text = source.data();
+        buffer->length = source.size();
+        return buffer;
+    }
+
+    const char* data() const { return text; }
+    uint32_t size() const { return static_cast<uint32_t>(length); }
+
+    std::string_view view() const {
+        return std::string_view(text, length);
+    }
+
+    std::string_view slice(uint32_t start, uint32_t end) const {
+        return std::string_view(text + start, end - start);
+    }
+};
+
+#endif
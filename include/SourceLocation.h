@@ -0,0 +1,32 @@
+// Where an Ir node starts and ends in its source file
+
+#ifndef SOURCE_LOCATION_H
+#define SOURCE_LOCATION_H
+
+#include <cstdint>
+#include <tree_sitter/api.h>
+
+// Copied out of the TSNode when the node is built, so that the syntax tree can
+// be deleted as soon as the AST exists. Rows and columns are 0-based, like
+// tree-sitter's points; the columns count bytes.
+struct SourceLocation {
+    uint32_t startByte = 0;
+    uint32_t endByte = 0;
+    uint32_t row = 0;
+    uint32_t column = 0;
+
+    SourceLocation() = default;
+
+    SourceLocation(const TSNode& node) {
+        if (ts_node_is_null(node)) {
+            return;
+        }
+        TSPoint start = ts_node_start_point(node);
+        startByte = ts_node_start_byte(node);
+        endByte = ts_node_end_byte(node);
+        row = start.row;
+        column = start.column;
+    }
+};
+
+#endif
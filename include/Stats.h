@@ -0,0 +1,82 @@
+// Per-phase resource statistics (--stats)
+
+#ifndef STATS_H
+#define STATS_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+/// allocations made by the calling thread since it started (counted by the global operator new)
+uint64_t thread_allocation_count();
+uint64_t thread_allocated_bytes();
+
+/// peak resident set size of the whole process so far, in KiB
+long peak_rss_kb();
+
+// Resources spent in one phase. Wall time, CPU time and allocations are
+// summed over every time the phase ran; CPU time and allocations are
+// per thread, so batch workers do not see each other's work.
+struct PhaseStats {
+    std::string name;
+    double wallMs = 0;
+    double cpuMs = 0;
+    uint64_t allocations = 0;
+    uint64_t allocatedBytes = 0;
+    long peakRssKb = 0;      // process peak RSS when the phase last finished
+
+    std::string toJson() const;
+};
+
+// Measures the enclosing scope into a PhaseStats; does nothing for nullptr,
+// so callers can pass a phase only when statistics were requested.
+class PhaseTimer {
+private:
+    PhaseStats* stats;
+    double wallStart;
+    double cpuStart;
+    uint64_t allocationsStart;
+    uint64_t bytesStart;
+
+public:
+    explicit PhaseTimer(PhaseStats* stats);
+    ~PhaseTimer();
+
+    PhaseTimer(const PhaseTimer&) = delete;
+    PhaseTimer& operator=(const PhaseTimer&) = delete;
+};
+
+struct FunctionStats {
+    std::string name;
+    std::vector<PhaseStats> phases;
+    size_t statements = 0;
+    size_t blocks = 0;
+    size_t phis = 0;
+    std::string degraded;    // "cfg-only" or "skipped" when over its budget, see Budget.h
+
+    /// the named phase, created on first use
+    PhaseStats* phase(const std::string& phaseName);
+    std::string toJson() const;
+};
+
+struct FileStats {
+    std::string filename;
+    std::vector<PhaseStats> phases;
+    std::vector<FunctionStats> functions;
+    size_t cstNodes = 0;
+    size_t statements = 0;
+    size_t blocks = 0;
+    size_t phis = 0;
+    std::string degraded;    // "parse-timeout" when the file was not analyzed at all
+
+    /// the named phase, created on first use
+    PhaseStats* phase(const std::string& phaseName);
+    std::string toJson() const;
+};
+
+/// write {"peakRssKb": ..., "files": [...]} to path ("-" for stdout)
+/// @return false if the file could not be written
+bool write_stats_report(const std::string& path, const std::vector<FileStats>& files);
+
+#endif
@@ -4,18 +4,21 @@
 #include <unordered_map>
 #include <string>
 #include <vector>
+#include <string_view>
 #include "Ll.h"
+#include "Interner.h"
 
 //     m : int               // Variable (not a type)
 //     A : struct {...}      // Type alias
 
 class IrType;
+// Names are interned on the way in, lookups hash and compare 32-bit ids
 class SymbolTable {
 private:
     std::string methodName;
     // std::unordered_map<std::string, LlComponent*> varTable;
-    std::unordered_map<std::string, IrType*> typeDefTable;
-    std::unordered_map<std::string, IrType*> varTable;
+    std::unordered_map<SymbolId, IrType*> typeDefTable;
+    std::unordered_map<SymbolId, IrType*> varTable;
     SymbolTable* parentTable;
 
 public:
@@ -25,11 +28,15 @@ public:
     ~SymbolTable() {
     }
 
-    void putOnVarTable(std::string key, IrType* value){
+    void putOnVarTable(SymbolId key, IrType* value){
         this->varTable[key] = value;
     }
 
-    IrType* getFromVarTable(std::string key){
+    void putOnVarTable(std::string_view key, IrType* value){
+        putOnVarTable(intern(key), value);
+    }
+
+    IrType* getFromVarTable(SymbolId key){
         auto it = this->varTable.find(key);
         if(it != this->varTable.end()){
             return it->second;
@@ -41,12 +48,20 @@ public:
         return nullptr;
     }
 
+    IrType* getFromVarTable(std::string_view key){
+        return getFromVarTable(intern(key));
+    }
+
     // TypeDef handling
-    void putOnTypeDefTable(const std::string& alias, IrType* actualType) {
+    void putOnTypeDefTable(SymbolId alias, IrType* actualType) {
         this->typeDefTable[alias] = actualType;
     }
 
-    IrType* getFromTypeDefTable(const std::string& alias) {
+    void putOnTypeDefTable(std::string_view alias, IrType* actualType) {
+        putOnTypeDefTable(intern(alias), actualType);
+    }
+
+    IrType* getFromTypeDefTable(SymbolId alias) {
         auto it = this->typeDefTable.find(alias);
         if (it != this->typeDefTable.end()) {
             return it->second;
@@ -56,8 +71,23 @@ public:
         }
         return nullptr;
     }
+
+    IrType* getFromTypeDefTable(std::string_view alias) {
+        return getFromTypeDefTable(intern(alias));
+    }
     
-    std::string toString();
+    /// copy another table's own typedefs and variables, the types are shared with it
+    void importFrom(const SymbolTable& other) {
+        for (const auto& entry : other.typeDefTable) {
+            this->typeDefTable[entry.first] = entry.second;
+        }
+        for (const auto& entry : other.varTable) {
+            this->varTable[entry.first] = entry.second;
+        }
+    }
+
+    void print(std::ostream& str) const;
+    std::string toString() const;
 
     std::string getMethodName() {
         return this->methodName;
@@ -0,0 +1,137 @@
+// Chrome trace-event output (--trace), viewable in Perfetto or chrome://tracing
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <cstdint>
+#include "Json.h"
+
+// Collects complete ("X") events into one buffer per thread, so recording
+// never takes a lock; the buffers are merged when the trace is written.
+// Everything is off until enable() is called: a disabled TraceScope costs
+// one predictable branch and never touches its arguments.
+class Trace {
+private:
+    struct Event {
+        const char* name;
+        std::string detail;
+        int64_t startUs;
+        int64_t durationUs;
+    };
+
+    struct ThreadBuffer {
+        uint32_t tid;
+        std::string threadName;
+        std::vector<Event> events;
+    };
+
+    static inline bool enabled = false;
+    static inline std::mutex buffersMutex;
+    static inline std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+    static inline const std::chrono::steady_clock::time_point origin = std::chrono::steady_clock::now();
+
+    // buffers outlive their threads, worker spans are still there after join()
+    static ThreadBuffer& threadBuffer() {
+        static thread_local ThreadBuffer* buffer = nullptr;
+        if (buffer == nullptr) {
+            std::lock_guard<std::mutex> lock(buffersMutex);
+            buffers.emplace_back(new ThreadBuffer());
+            buffer = buffers.back().get();
+            buffer->tid = static_cast<uint32_t>(buffers.size());
+        }
+        return *buffer;
+    }
+
+public:
+    static bool isEnabled() {
+        return __builtin_expect(enabled, false);
+    }
+
+    /// start recording; call before any worker threads are started
+    static void enable() {
+        enabled = true;
+    }
+
+    static int64_t nowUs() {
+        return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - origin).count();
+    }
+
+    /// @param name must be a string literal (or otherwise outlive the trace)
+    static void record(const char* name, std::string detail, int64_t startUs, int64_t durationUs) {
+        threadBuffer().events.push_back({name, std::move(detail), startUs, durationUs});
+    }
+
+    /// label the calling thread's track in the timeline
+    static void setThreadName(const std::string& name) {
+        if (isEnabled()) {
+            threadBuffer().threadName = name;
+        }
+    }
+
+    /// write every recorded event as Chrome trace-event JSON; call after worker threads joined
+    /// @return false if the file could not be written
+    static bool write(const std::string& path) {
+        std::ofstream out(path);
+        if (!out.is_open()) {
+            std::cerr << "Error: cannot write trace to " << path << std::endl;
+            return false;
+        }
+        std::lock_guard<std::mutex> lock(buffersMutex);
+        out << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [";
+        bool first = true;
+        for (const auto& buffer : buffers) {
+            if (!buffer->threadName.empty()) {
+                out << (first ? "\n" : ",\n") << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << buffer->tid
+                    << ", \"args\": {\"name\": \"" << json_escape(buffer->threadName) << "\"}}";
+                first = false;
+            }
+            for (const Event& event : buffer->events) {
+                out << (first ? "\n" : ",\n") << "{\"name\": \"" << json_escape(event.name) << "\", \"cat\": \"svf\", \"ph\": \"X\", \"pid\": 1, \"tid\": "
+                    << buffer->tid << ", \"ts\": " << event.startUs << ", \"dur\": " << event.durationUs;
+                if (!event.detail.empty()) {
+                    out << ", \"args\": {\"detail\": \"" << json_escape(event.detail) << "\"}";
+                }
+                out << "}";
+                first = false;
+            }
+        }
+        out << "\n]}" << std::endl;
+        return true;
+    }
+};
+
+// Records the enclosing scope as one span when tracing is enabled.
+// The detail (a file or function name) is only copied when tracing is on.
+class TraceScope {
+private:
+    const char* name;
+    std::string detail;
+    int64_t startUs;
+    bool active;
+
+public:
+    explicit TraceScope(const char* name, const std::string& detail = std::string()) : name(name), active(Trace::isEnabled()) {
+        if (active) {
+            this->detail = detail;
+            startUs = Trace::nowUs();
+        }
+    }
+
+    ~TraceScope() {
+        if (active) {
+            Trace::record(name, std::move(detail), startUs, Trace::nowUs() - startUs);
+        }
+    }
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+};
+
+#endif
@@ -1,12 +1,20 @@
 #ifndef UTILS_H
 #define UTILS_H
 #include <argparse/argparse.hpp>
+#include <tree_sitter/api.h>
+#include <fstream>
+#include <sstream>
+#include <fcntl.h>
+#include <unistd.h>
+#include "SourceBuffer.h"
 
 // Function to parse command line arguments using argparse
-void parse_command_line(argparse::ArgumentParser& program, int argc, char *argv[]) {
+inline void parse_command_line(argparse::ArgumentParser& program, int argc, char *argv[]) {
 
   program.add_argument("filename")
-    .help("The name of the file to read");
+    .help("The name of the file to read")
+    .nargs(argparse::nargs_pattern::optional)
+    .default_value(std::string(""));
 
   program.add_argument("-V", "--verbose")
   .help("increase output verbosity")
@@ -26,7 +34,7 @@ void parse_command_line(argparse::ArgumentParser& program, int argc, char *argv[
   program.add_argument("-o", "--output")
   .default_value(std::string("-"))
   .required()
-  .help("specify the output file.");
+  .help("where the report and DOT artifacts go: '-' for stdout, a single file, or a directory (one file per artifact).");
 
   program.add_argument("-cfg", "--cfg")
   .help("output files for control flow graphs.")
@@ -38,6 +46,78 @@ void parse_command_line(argparse::ArgumentParser& program, int argc, char *argv[
   .default_value(false)
   .implicit_value(true);
 
+  program.add_argument("--batch")
+  .help("analyze every file listed in the given file (one path per line, or a compile_commands.json).");
+
+  program.add_argument("-j", "--jobs")
+  .help("number of worker threads for --batch, 0 uses all hardware threads.")
+  .default_value(0u)
+  .scan<'u', unsigned>();
+
+  program.add_argument("--ast-threads")
+  .help("build the ASTs of a file's function definitions on this many threads, 0 uses all hardware threads.")
+  .default_value(1u)
+  .scan<'u', unsigned>();
+
+  program.add_argument("-I", "--include-dir")
+  .help("resolve #include against this directory, repeatable; every header is parsed once per process and its declarations join the globals.")
+  .append();
+
+  program.add_argument("--expand-macros")
+  .help("expand object-like and function-like #define macros before parsing; with -I the macros of included headers are used too.")
+  .default_value(false)
+  .implicit_value(true);
+
+  program.add_argument("--functions")
+  .help("comma-separated function names: only their definitions are built, lowered and analyzed, the globals and prototypes are kept.");
+
+  program.add_argument("--cache-dir")
+  .help("reuse lowered IR, CFG and SSA results of unchanged functions stored in this directory.");
+
+  program.add_argument("--stream")
+  .help("lower, build and emit one function at a time, freeing each before the next, so memory stays bounded by the largest function.")
+  .default_value(false)
+  .implicit_value(true);
+
+  program.add_argument("--leader-blocks")
+  .help("find the basic blocks with a leader pass over the lowered IR instead of recording them while lowering, to compare the two.")
+  .default_value(false)
+  .implicit_value(true);
+
+  program.add_argument("--no-teardown")
+  .help("exit without freeing the AST and IR; the output is complete, only the cleanup is skipped.")
+  .default_value(false)
+  .implicit_value(true);
+
+  program.add_argument("--parse-timeout-ms")
+  .help("give up on a file whose parse takes longer than this many milliseconds, 0 for no limit.")
+  .default_value(0u)
+  .scan<'u', unsigned>();
+
+  program.add_argument("--function-timeout-ms")
+  .help("per-function budget for lowering, CFG and SSA; a function over it is emitted without SSA, or without CFG and SSA.")
+  .default_value(0u)
+  .scan<'u', unsigned>();
+
+  program.add_argument("--function-memory-mb")
+  .help("per-function allocation budget for lowering, CFG and SSA, degraded like --function-timeout-ms.")
+  .default_value(0u)
+  .scan<'u', unsigned>();
+
+  program.add_argument("--stats")
+  .help("write per-phase and per-function time, allocation and peak-RSS statistics as JSON to this file ('-' for stdout).");
+
+  program.add_argument("--trace")
+  .help("write a Chrome trace-event timeline of the run to this file (open it in Perfetto).");
+
+  program.add_argument("--server")
+  .help("keep running and answer JSON requests, one per line on stdin.")
+  .default_value(false)
+  .implicit_value(true);
+
+  program.add_argument("--socket")
+  .help("serve the --server protocol on the given Unix domain socket instead of stdin.");
+
   try {
     program.parse_args(argc, argv);
   }
@@ -51,7 +131,7 @@ void parse_command_line(argparse::ArgumentParser& program, int argc, char *argv[
 }
 
 // write cst to file
-void write_cst_to_file(const char *filename, TSTree *tree) {
+inline void write_cst_to_file(const char *filename, TSTree *tree) {
 
   // Open the file and get the file descriptor
     int file_descriptor = open(filename, O_WRONLY | O_CREAT, 0644);
@@ -65,15 +145,8 @@ void write_cst_to_file(const char *filename, TSTree *tree) {
   close(file_descriptor);
 }
 
-// read cpp file function
-std::string* read_file(const std::string &filename) {
-  std::ifstream file(filename);
-  if (!file.is_open()) {
-    std::cerr << "Failed to open file: " << filename << std::endl;
-    return nullptr;
-  }
-  std::stringstream buffer;
-  buffer << file.rdbuf();
-  return new std::string(buffer.str());
+// map a C file read-only; the caller owns the returned buffer
+inline SourceBuffer* read_file(const std::string &filename) {
+  return SourceBuffer::mapFile(filename);
 }
 #endif
\ No newline at end of file
@@ -2,17 +2,42 @@
 #include <iostream>
 #include <map>
 #include <cstring>
+#include <charconv>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <unordered_map>
 #include "ASTBuilder.h"
-#include "main.h"
+#include "Trace.h"
 
-std::string ASTBuilder::getNodeText(const TSNode &node) {
+std::string_view ASTBuilder::getNodeText(const TSNode &node) {
     unsigned start = ts_node_start_byte(node);
     unsigned end = ts_node_end_byte(node);
-    return source_code->substr(start, end - start); // Return by value
+    return source_code->slice(start, end);
+}
+
+std::string_view function_definition_name(const TSNode& definition, const SourceBuffer& source) {
+    // int *(f)(void) nests the name in pointer, parenthesized and function declarators
+    TSNode node = ts_node_child_by_field_name(definition, "declarator", 10);
+    while (!ts_node_is_null(node) && std::strcmp(ts_node_type(node), "identifier") != 0) {
+        if (std::strcmp(ts_node_type(node), "parenthesized_declarator") == 0) {
+            node = ts_node_named_child(node, 0);
+        } else {
+            node = ts_node_child_by_field_name(node, "declarator", 10);
+        }
+    }
+    if (ts_node_is_null(node)) {
+        return std::string_view();
+    }
+    return source.slice(ts_node_start_byte(node), ts_node_end_byte(node));
+}
+
+bool ASTBuilder::wantsFunction(const TSNode& definition) {
+    return !filterFunctions || functionFilter.count(std::string(function_definition_name(definition, *source_code)));
 }
 
 void ASTBuilder::debugStackState() const {
-    std::cout << "Stack state:\n";
+    *traceOut << "Stack state:\n";
     std::stack<Ir*> tempStack = this->ast_stack;
 
     while (!tempStack.empty()) {
@@ -20,15 +45,15 @@ void ASTBuilder::debugStackState() const {
         tempStack.pop();
 
         if (node) {
-            std::cout << "- " << typeid(*node).name() <<
+            *traceOut << "- " << typeid(*node).name() <<
             " -value " << node->toString() << "\n";
         }
     }
-    std::cout << "End of stack.\n";
+    *traceOut << "End of stack.\n";
 }
 
 void ASTBuilder::exitPrimitiveType(const TSNode & cst_node) {
-    std::string node_text = getNodeText(cst_node);
+    std::string_view node_text = getNodeText(cst_node);
     Ir* node =nullptr;
 
     if (node_text == "int") {
@@ -56,8 +81,7 @@ void ASTBuilder::exitPrimitiveType(const TSNode & cst_node) {
 }
 
 void ASTBuilder::exitIdentifier(const TSNode & cst_node) {
-    std::string node_text = getNodeText(cst_node);
-    Ir* node = new IrIdent(node_text, cst_node);
+    Ir* node = new IrIdent(getNodeText(cst_node), cst_node);
     this->ast_stack.push(node);
 }
 
@@ -67,7 +91,7 @@ void ASTBuilder::exitParameter(const TSNode &cst_node) {
         IrDeclDeclarator* declarator = nullptr;
 
         // optional(field('declarator', choice($._declarator,$._abstract_declarator))
-        if (!this->ast_stack.empty() && dynamic_cast<IrDeclDeclarator*>(this->ast_stack.top())) {
+        if (!this->ast_stack.empty() && isa<IrDeclDeclarator>(this->ast_stack.top())) {
             declarator = popFromStack<IrDeclDeclarator>(cst_node);
         }
 
@@ -85,12 +109,12 @@ void ASTBuilder::exitParameter(const TSNode &cst_node) {
 void ASTBuilder::exitParamList(const TSNode & cst_node){
 
     IrParamList* paramList = new IrParamList(cst_node);
-    IrParamDecl* paramDecl = dynamic_cast<IrParamDecl*>(this->ast_stack.top());
+    IrParamDecl* paramDecl = dyn_cast<IrParamDecl>(this->ast_stack.top());
 
     while (paramDecl) {
         this->ast_stack.pop();
         paramList->addToParamsList(paramDecl);
-        paramDecl = dynamic_cast<IrParamDecl*>(this->ast_stack.top());
+        paramDecl = dyn_cast<IrParamDecl>(this->ast_stack.top());
     }
 
     this->ast_stack.push(paramList);
@@ -102,8 +126,8 @@ void ASTBuilder::exitFunctionDeclarator(const TSNode &cst_node) {
         IrParamList* paramList = nullptr;
 
         // Pop the parameter list
-        if (!this->ast_stack.empty() && dynamic_cast<IrParamList*>(this->ast_stack.top())) {
-            paramList = dynamic_cast<IrParamList*>(this->ast_stack.top());
+        if (!this->ast_stack.empty() && isa<IrParamList>(this->ast_stack.top())) {
+            paramList = cast<IrParamList>(this->ast_stack.top());
             this->ast_stack.pop();
         } else {
             paramList = new IrParamList(cst_node); // Empty param list
@@ -114,7 +138,7 @@ void ASTBuilder::exitFunctionDeclarator(const TSNode &cst_node) {
 
         if (!this->ast_stack.empty()) {
             Ir* node = this->ast_stack.top();
-            if (IrIdent* ident = dynamic_cast<IrIdent*>(node)) {
+            if (IrIdent* ident = dyn_cast<IrIdent>(node)) {
                 // IrIdent is a valid IrDeclarator
                 this->ast_stack.pop();
                 declarator = ident;
@@ -162,16 +186,16 @@ void ASTBuilder::exitBinaryExpr(const TSNode & cst_node){
         std::cerr << "Error: Not enough elements on the stack for binary expression" << std::endl;
     }
 
-    IrExpr* rightOperand = dynamic_cast<IrExpr*>(this->ast_stack.top());
+    IrExpr* rightOperand = dyn_cast<IrExpr>(this->ast_stack.top());
     this->ast_stack.pop();
 
-    IrExpr* leftOperand = dynamic_cast<IrExpr*>(this->ast_stack.top());
+    IrExpr* leftOperand = dyn_cast<IrExpr>(this->ast_stack.top());
     this->ast_stack.pop();
 
     // Get the operation
     // get the second child of the cst_node
     TSNode second_child = ts_node_child(cst_node, 1);
-    std::string operation = getNodeText(second_child);
+    std::string operation(getNodeText(second_child));
 
     if (leftOperand && rightOperand) {
         node = new IrBinaryExpr(operation, leftOperand, rightOperand, cst_node);
@@ -188,7 +212,7 @@ void ASTBuilder:: exitReturnStatement(const TSNode & cst_node){
         std::cerr << "Error: Not enough elements on the stack for return statement" << std::endl;
     }
 
-    IrExpr* result = dynamic_cast<IrExpr*>(this->ast_stack.top());
+    IrExpr* result = dyn_cast<IrExpr>(this->ast_stack.top());
 
     if (result) {
         this->ast_stack.pop();
@@ -216,7 +240,7 @@ void ASTBuilder::exitCompoundStatement(const TSNode &cst_node) {
         }
 
         // Pop statement from the stack and add to the compound statement
-        IrStatement* stmt = dynamic_cast<IrStatement*>(this->ast_stack.top());
+        IrStatement* stmt = dyn_cast<IrStatement>(this->ast_stack.top());
 
         if (stmt) {
             this->ast_stack.pop();
@@ -229,13 +253,15 @@ void ASTBuilder::exitCompoundStatement(const TSNode &cst_node) {
 }
 
 void ASTBuilder::exitLiteralNumber(const TSNode & cst_node){
-    std::string node_text = getNodeText(cst_node);
-    IrLiteralNumber* node = new IrLiteralNumber(std::stoi(node_text), cst_node);
+    std::string_view node_text = getNodeText(cst_node);
+    long value = 0;
+    std::from_chars(node_text.data(), node_text.data() + node_text.size(), value);
+    IrLiteralNumber* node = new IrLiteralNumber(value, cst_node);
     this->ast_stack.push(node);
 }
 
 void ASTBuilder::exitLiteralChar(const TSNode & cst_node){
-    std::string node_text = getNodeText(cst_node);
+    std::string_view node_text = getNodeText(cst_node);
     IrLiteralChar* node = new IrLiteralChar(node_text[0], cst_node);
     this->ast_stack.push(node);
 }
@@ -246,7 +272,7 @@ void ASTBuilder::exitArgList(const TSNode & cst_node){
     uint32_t arg_count = ts_node_named_child_count(cst_node);
 
     for (uint32_t i = 0; i < arg_count; i++) {
-        IrExpr* arg = dynamic_cast<IrExpr*>(this->ast_stack.top());
+        IrExpr* arg = dyn_cast<IrExpr>(this->ast_stack.top());
         this->ast_stack.pop();
         argList->addToArgsList(arg);
     }
@@ -261,10 +287,10 @@ void ASTBuilder::exitCallExpr(const TSNode & cst_node){
         std::cerr << "Error: Not enough elements on the stack for call expression" << std::endl;
     }
 
-    IrArgList* argList = dynamic_cast<IrArgList*>(this->ast_stack.top());
+    IrArgList* argList = dyn_cast<IrArgList>(this->ast_stack.top());
     this->ast_stack.pop();
 
-    IrIdent* functionName = dynamic_cast<IrIdent*>(this->ast_stack.top());
+    IrIdent* functionName = dyn_cast<IrIdent>(this->ast_stack.top());
     this->ast_stack.pop();
 
     if (functionName && argList) {
@@ -278,7 +304,7 @@ void ASTBuilder::exitCallExpr(const TSNode & cst_node){
 void ASTBuilder::exitAssignExpr(const TSNode &cst_node) {
     try {
         TSNode operator_node = ts_node_child(cst_node, 1);  // Operator is the second child
-        std::string opText = getNodeText(operator_node);  // Retrieve operator ('=', '+=', etc.)
+        std::string opText(getNodeText(operator_node));  // Retrieve operator ('=', '+=', etc.)
 
         IrExpr* rhs = this->popFromStack<IrExpr>(cst_node);
         IrExpr* lhs = this->popFromStack<IrExpr>(cst_node);
@@ -297,7 +323,7 @@ void ASTBuilder::exitExprStmt(const TSNode & cst_node){
         std::cerr << "Error: Not enough elements on the stack for expression statement" << std::endl;
     }
 
-    IrExpr* expr = dynamic_cast<IrExpr*>(this->ast_stack.top());
+    IrExpr* expr = dyn_cast<IrExpr>(this->ast_stack.top());
     this->ast_stack.pop();
 
     if (expr) {
@@ -316,7 +342,7 @@ void ASTBuilder::exitTransUnit(const TSNode &cst_node) {
         this->ast_stack.pop();
 
         // If the node is IrMultiDecl, "release" its sub-declarations
-        if (auto* multiDecl = dynamic_cast<IrMultiDecl*>(node)) {
+        if (auto* multiDecl = dyn_cast<IrMultiDecl>(node)) {
 
             // This returns a non-const std::deque<IrDecl*>
             auto allDecls = multiDecl->releaseDeclarations();
@@ -325,26 +351,23 @@ void ASTBuilder::exitTransUnit(const TSNode &cst_node) {
                 IrDecl* singleDecl = allDecls.front();
                 allDecls.pop_front();
 
-                if (auto decl = dynamic_cast<IrDecl*>(singleDecl)) {
+                if (auto decl = dyn_cast<IrDecl>(singleDecl)) {
                     transUnitNode->addTopLevelNodeFront(decl);
                 } else {
                     std::cerr << "Warning: Unrecognized node inside IrMultiDecl.\n";
-                    delete singleDecl;
                 }
             }
-            delete multiDecl;
         }
-        else if (dynamic_cast<IrDecl*>(node) ||
-                 dynamic_cast<IrFunctionDef*>(node) ||
-                 dynamic_cast<IrPreprocInclude*>(node) ||
-                 dynamic_cast<IrTypeDef*>(node) ||
-                 dynamic_cast<IrPreprocDef*>(node) ||
-                 dynamic_cast<IrExprStmt*>(node))
+        else if (isa<IrDecl>(node) ||
+                 isa<IrFunctionDef>(node) ||
+                 isa<IrPreprocInclude>(node) ||
+                 isa<IrTypeDef>(node) ||
+                 isa<IrPreprocDef>(node) ||
+                 isa<IrExprStmt>(node))
         {
             transUnitNode->addTopLevelNodeFront(node);
         } else {
             std::cerr << "Warning: Skipping unrecognized node." << std::endl;
-            delete node;
         }
     }
     this->ast_stack.push(transUnitNode);
@@ -352,12 +375,12 @@ void ASTBuilder::exitTransUnit(const TSNode &cst_node) {
 
 
 void ASTBuilder::exitStringContent(const TSNode &cst_node) {
-    std::string content = getNodeText(cst_node);
+    std::string_view content = getNodeText(cst_node);
     if (content.empty()) {
         std::cerr << "Error: Unable to retrieve string content" << std::endl;
         return;
     }
-    Ir* node = new IrLiteralStringContent(content, cst_node);
+    Ir* node = new IrLiteralStringContent(std::string(content), cst_node);
     this->ast_stack.push(node);
 }
 
@@ -373,7 +396,7 @@ void ASTBuilder::exitLiteralString(const TSNode & cst_node){
         std::cerr << "Error: Not enough elements on the stack for string literal" << std::endl;
     }
 
-    IrLiteralStringContent* content = dynamic_cast<IrLiteralStringContent*>(this->ast_stack.top());
+    IrLiteralStringContent* content = dyn_cast<IrLiteralStringContent>(this->ast_stack.top());
 
     if (content) {
         this->ast_stack.pop();
@@ -387,11 +410,23 @@ void ASTBuilder::exitLiteralString(const TSNode & cst_node){
 void ASTBuilder::exitPreprocInclude(const TSNode &cst_node) {
     Ir* node = nullptr;
 
+    // <header> is a system_lib_string, which has no AST node of its own
+    TSNode pathNode = ts_node_child_by_field_name(cst_node, "path", 4);
+    if (!ts_node_is_null(pathNode) && std::strcmp(ts_node_type(pathNode), "system_lib_string") == 0) {
+        std::string_view pathText = getNodeText(pathNode);
+        if (pathText.size() >= 2) {
+            pathText = pathText.substr(1, pathText.size() - 2);
+        }
+        node = new IrPreprocInclude(std::string(pathText), cst_node);
+        this->ast_stack.push(node);
+        return;
+    }
+
     if (this->ast_stack.size() < 1) {
         std::cerr << "Error: Not enough elements on the stack for preprocessor include" << std::endl;
     }
 
-    IrLiteralString* path = dynamic_cast<IrLiteralString*>(this->ast_stack.top());
+    IrLiteralString* path = dyn_cast<IrLiteralString>(this->ast_stack.top());
 
     if (path) {
         this->ast_stack.pop();
@@ -403,10 +438,10 @@ void ASTBuilder::exitPreprocInclude(const TSNode &cst_node) {
 }
 
 void ASTBuilder::exitStorageClassSpecifier(const TSNode & cst_node) {
-    std::string specifierText = getNodeText(cst_node);
+    std::string_view specifierText = getNodeText(cst_node);
 
     if (!specifierText.empty()) {
-        Ir* node = new IrStorageClassSpecifier(specifierText, cst_node);
+        Ir* node = new IrStorageClassSpecifier(std::string(specifierText), cst_node);
         this->ast_stack.push(node);
     } else {
         std::cerr << "Error: Unable to retrieve storage class specifier text" << std::endl;
@@ -422,7 +457,7 @@ void ASTBuilder::exitArrayDeclarator(const TSNode &cst_node) {
         arraylevel -= 1;
         if (arraylevel == 0) {
             deque<IrLiteral*> dims;
-            while (dynamic_cast<IrLiteral*>(this->ast_stack.top()) ) {
+            while (isa<IrLiteral>(this->ast_stack.top())) {
                 IrLiteral* literal = this->popFromStack<IrLiteral>(cst_node);
                 dims.push_front(literal);
             }
@@ -442,7 +477,7 @@ void ASTBuilder::exitPointerDeclarator(const TSNode &cst_node) {
     try {
         IrDeclDeclarator* baseDeclarator = popFromStack<IrDeclDeclarator>(cst_node);
 
-        IrType* baseType = dynamic_cast<IrType*>(ast_stack.top());
+        IrType* baseType = dyn_cast<IrType>(ast_stack.top());
         ast_stack.pop();
 
         IrPointerType* pointerType = new IrPointerType(baseType, cst_node);
@@ -458,20 +493,19 @@ void ASTBuilder::exitSubscriptExpression(const TSNode &cst_node) {
     IrExpr* baseExpr = nullptr;
 
     // Pop the index expression (mandatory)
-    if (!this->ast_stack.empty() && dynamic_cast<IrExpr*>(this->ast_stack.top())) {
-        indexExpr = dynamic_cast<IrExpr*>(this->ast_stack.top());
+    if (!this->ast_stack.empty() && isa<IrExpr>(this->ast_stack.top())) {
+        indexExpr = cast<IrExpr>(this->ast_stack.top());
         this->ast_stack.pop();
     } else {
         std::cerr << "Error: Missing or invalid index expression in subscript_expression" << std::endl;
         return;
     }
 
-    if (!this->ast_stack.empty() && dynamic_cast<IrExpr*>(this->ast_stack.top())) {
-        baseExpr = dynamic_cast<IrExpr*>(this->ast_stack.top());
+    if (!this->ast_stack.empty() && isa<IrExpr>(this->ast_stack.top())) {
+        baseExpr = cast<IrExpr>(this->ast_stack.top());
         this->ast_stack.pop();
     } else {
         std::cerr << "Error: Missing or invalid base expression in subscript_expression" << std::endl;
-        delete indexExpr;
         return;
     }
 
@@ -485,8 +519,8 @@ void ASTBuilder::exitDeclaration(const TSNode &cst_node) {
         std::deque<IrInitDeclarator*> initDecls;
         std::deque<IrDeclDeclarator*> simpleDecls;
         while (!this->ast_stack.empty()) {
-            IrInitDeclarator* initDecl = dynamic_cast<IrInitDeclarator*>(this->ast_stack.top());
-            IrDeclDeclarator* simpleDecl = dynamic_cast<IrDeclDeclarator*>(this->ast_stack.top());
+            IrInitDeclarator* initDecl = dyn_cast<IrInitDeclarator>(this->ast_stack.top());
+            IrDeclDeclarator* simpleDecl = dyn_cast<IrDeclDeclarator>(this->ast_stack.top());
 
             if (initDecl) {
                 this->ast_stack.pop();
@@ -508,7 +542,7 @@ void ASTBuilder::exitDeclaration(const TSNode &cst_node) {
         // 3) Optionally pop storage class specifier (e.g. static)
         IrStorageClassSpecifier* specifier = nullptr;
         if (!this->ast_stack.empty()) {
-            specifier = dynamic_cast<IrStorageClassSpecifier*>(this->ast_stack.top());
+            specifier = dyn_cast<IrStorageClassSpecifier>(this->ast_stack.top());
             if (specifier) {
                 this->ast_stack.pop();
             }
@@ -582,7 +616,7 @@ void ASTBuilder::exitAbstractPointerDeclarator(const TSNode &cst_node) {
 
         // Check for an optional base declarator on the stack
         if (!this->ast_stack.empty()) {
-            baseDeclarator = dynamic_cast<IrDeclDeclarator*>(this->ast_stack.top());
+            baseDeclarator = dyn_cast<IrDeclDeclarator>(this->ast_stack.top());
             if (baseDeclarator) {
                 this->ast_stack.pop();
             }
@@ -600,7 +634,7 @@ void ASTBuilder::exitFieldDeclaration(const TSNode &cst_node) {
         // Handle optional bitfield clause for future if we need it
         // field declarator
         IrDeclDeclarator* declarator = nullptr;
-        if (!this->ast_stack.empty() && dynamic_cast<IrDeclDeclarator*>(this->ast_stack.top())) {
+        if (!this->ast_stack.empty() && isa<IrDeclDeclarator>(this->ast_stack.top())) {
             declarator = popFromStack<IrDeclDeclarator>(cst_node);
         }
         // type specifier
@@ -618,7 +652,7 @@ void ASTBuilder::exitFieldDeclarationList(const TSNode &cst_node) {
         IrFieldDeclList* fieldDeclList = new IrFieldDeclList(cst_node);
 
         while (!this->ast_stack.empty()) {
-            IrFieldDecl* fieldDecl = dynamic_cast<IrFieldDecl*>(this->ast_stack.top());
+            IrFieldDecl* fieldDecl = dyn_cast<IrFieldDecl>(this->ast_stack.top());
             if (!fieldDecl) break;
             this->ast_stack.pop();
             fieldDeclList->addField(fieldDecl);
@@ -633,14 +667,14 @@ void ASTBuilder::exitFieldDeclarationList(const TSNode &cst_node) {
 void ASTBuilder::exitStructSpecifier(const TSNode& cst_node) {
     try {
         IrFieldDeclList* fieldDeclList = nullptr;
-        if (!this->ast_stack.empty() && dynamic_cast<IrFieldDeclList*>(this->ast_stack.top())) {
+        if (!this->ast_stack.empty() && isa<IrFieldDeclList>(this->ast_stack.top())) {
             fieldDeclList = popFromStack<IrFieldDeclList>(cst_node);
         } else {
             fieldDeclList = new IrFieldDeclList(cst_node); // Create an empty field declaration list
         }
 
         IrIdent* name = nullptr;
-        if (!this->ast_stack.empty() && dynamic_cast<IrIdent*>(this->ast_stack.top())) {
+        if (!this->ast_stack.empty() && isa<IrIdent>(this->ast_stack.top())) {
             name = popFromStack<IrIdent>(cst_node);
         }
 
@@ -667,7 +701,7 @@ void ASTBuilder:: exitTypeDefinition(const TSNode &cst_node) {
 
 void ASTBuilder::exitTypeIdentifier(const TSNode &cst_node) {
     try {
-        std::string node_text = getNodeText(cst_node);
+        std::string node_text(getNodeText(cst_node));
         IrTypeIdent* typeIdenifier = new IrTypeIdent(node_text, cst_node);
         this->ast_stack.push(typeIdenifier);
     } catch (const std::exception &e) {
@@ -680,7 +714,7 @@ void ASTBuilder::exitFieldExpression(const TSNode & cst_node) {
     IrIdent* fieldName = this->popFromStack<IrIdent>(cst_node);
 
     TSNode operator_node = ts_node_child(cst_node, 1); // second child is the op node
-    std::string opText = getNodeText(operator_node);
+    std::string_view opText = getNodeText(operator_node);
     bool isArrow = (opText == "->");
 
     IrExpr* baseExpr = this->popFromStack<IrExpr>(cst_node);
@@ -695,7 +729,7 @@ void ASTBuilder::exitPointerExpression(const TSNode &cst_node) {
     IrExpr* argument = this->popFromStack<IrExpr>(cst_node);
 
     TSNode operator_node = ts_node_child(cst_node, 0);
-    std::string opText = getNodeText(operator_node);
+    std::string_view opText = getNodeText(operator_node);
 
     bool isAddressOf = (opText == "&");
     bool isDereference = (opText == "*");
@@ -705,8 +739,7 @@ void ASTBuilder::exitPointerExpression(const TSNode &cst_node) {
 }
 
 void ASTBuilder::exitPreprocArg(const TSNode &cst_node) {
-    std::string node_text = getNodeText(cst_node);
-    Ir* node = new IrPreprocArg(node_text, cst_node);
+    Ir* node = new IrPreprocArg(std::string(getNodeText(cst_node)), cst_node);
     this->ast_stack.push(node);
 }
 
@@ -716,7 +749,7 @@ void ASTBuilder::exitPreprocDef(const TSNode &cst_node) {
 
         // 1. Pop preproc_arg (value) if it exists
         if (!this->ast_stack.empty()) {
-            if (IrPreprocArg* arg = dynamic_cast<IrPreprocArg*>(this->ast_stack.top())) {
+            if (IrPreprocArg* arg = dyn_cast<IrPreprocArg>(this->ast_stack.top())) {
                 this->ast_stack.pop();
                 value = arg;  // Store the argument directly
             }
@@ -744,7 +777,7 @@ void ASTBuilder::exitUnaryExpr(const TSNode &cst_node) {
     try {
         IrExpr* expr = this->popFromStack<IrExpr>(cst_node);
         TSNode operatorNode = ts_node_child(cst_node, 0);
-        std::string op = getNodeText(operatorNode);
+        std::string op(getNodeText(operatorNode));
 
         IrUnaryExpr* unaryExpr = new IrUnaryExpr(op, expr, cst_node);
         this->ast_stack.push(unaryExpr);
@@ -792,14 +825,14 @@ void ASTBuilder::exitForStatement(const TSNode &cst_node) {
         // Check if 'update' exists by inspecting CST children directly
         TSNode updateNode = ts_node_child_by_field_name(cst_node, "update", 6);
         if (!ts_node_is_null(updateNode)) {
-            update = dynamic_cast<IrExpr*>(this->ast_stack.top());
+            update = dyn_cast<IrExpr>(this->ast_stack.top());
             if (update) this->ast_stack.pop();
         }
 
         // Check if 'condition' exists
         TSNode conditionNode = ts_node_child_by_field_name(cst_node, "condition", 9);
         if (!ts_node_is_null(conditionNode)) {
-            condition = dynamic_cast<IrExpr*>(this->ast_stack.top());
+            condition = dyn_cast<IrExpr>(this->ast_stack.top());
             if (condition) this->ast_stack.pop();
         }
 
@@ -818,7 +851,7 @@ void ASTBuilder::exitInitList(const TSNode &cst_node) {
 
         uint32_t child_count = ts_node_named_child_count(cst_node);
         for (uint32_t i = 0; i < child_count; i++) {
-            IrExpr* expr = dynamic_cast<IrExpr*>(this->ast_stack.top());
+            IrExpr* expr = dyn_cast<IrExpr>(this->ast_stack.top());
             if (expr) {
                 this->ast_stack.pop();
                 initList->addElement(expr);
@@ -841,16 +874,16 @@ void ASTBuilder::exitCaseStatement(const TSNode &cst_node) {
         std::deque<IrStatement*> caseBody; // Store all statements inside the case
 
         // body: non_case_statement, declaration, (CURRENTLY NOT IMPLEMENTED type_definition)
-        while (!ast_stack.empty() && dynamic_cast<IrStatement*>(ast_stack.top()) &&
-            !dynamic_cast<IrCaseStmt*>(ast_stack.top())) {
+        while (!ast_stack.empty() && isa<IrStatement>(ast_stack.top()) &&
+            !isa<IrCaseStmt>(ast_stack.top())) {
             caseBody.push_front(popFromStack<IrStatement>(cst_node));
         }
 
         // Check if it's a default case
         IrExpr* caseValue = nullptr;
-        std::string caseType = getNodeText(cst_node);
-        // std::string::npos: special constant that means "not found"
-        if (caseType.find("default") == std::string::npos) {
+        std::string_view caseType = getNodeText(cst_node);
+        // std::string_view::npos: special constant that means "not found"
+        if (caseType.find("default") == std::string_view::npos) {
             caseValue = popFromStack<IrExpr>(cst_node);
         }
 
@@ -899,196 +932,287 @@ void ASTBuilder::exitWhileStatement(const TSNode &cst_node) {
 }
 
 
+namespace {
+
+struct SymbolHandler {
+    const char* name;
+    CstDispatch::Handler handler;
+    uint8_t flags;
+};
+
+// every named node the AST is built from, by its name in the tree-sitter-c grammar
+const SymbolHandler symbol_handlers[] = {
+    {"identifier", &ASTBuilder::exitIdentifier, 0},
+    {"field_identifier", &ASTBuilder::exitIdentifier, 0},
+    {"type_identifier", &ASTBuilder::exitTypeIdentifier, 0},
+    {"primitive_type", &ASTBuilder::exitPrimitiveType, 0},
+    {"parameter_declaration", &ASTBuilder::exitParameter, 0},
+    {"parameter_list", &ASTBuilder::exitParamList, 0},
+    {"function_declarator", &ASTBuilder::exitFunctionDeclarator, 0},
+    {"binary_expression", &ASTBuilder::exitBinaryExpr, 0},
+    {"number_literal", &ASTBuilder::exitLiteralNumber, 0},
+    {"character", &ASTBuilder::exitLiteralChar, 0},
+    {"char_literal", &ASTBuilder::ignoreNode, 0},
+    {"return_statement", &ASTBuilder::exitReturnStatement, 0},
+    {"compound_statement", &ASTBuilder::exitCompoundStatement, 0},
+    {"function_definition", &ASTBuilder::exitFunctionDefinition, CstDispatch::FunctionDefinition},
+    {"argument_list", &ASTBuilder::exitArgList, 0},
+    {"call_expression", &ASTBuilder::exitCallExpr, 0},
+    {"assignment_expression", &ASTBuilder::exitAssignExpr, 0},
+    {"expression_statement", &ASTBuilder::exitExprStmt, 0},
+    {"comment", &ASTBuilder::ignoreNode, 0},
+    {"string_content", &ASTBuilder::exitStringContent, 0},
+    {"string_literal", &ASTBuilder::exitLiteralString, 0},
+    {"preproc_include", &ASTBuilder::exitPreprocInclude, 0},
+    {"storage_class_specifier", &ASTBuilder::exitStorageClassSpecifier, 0},
+    {"array_declarator", &ASTBuilder::exitArrayDeclarator, CstDispatch::OpensArray},
+    {"subscript_expression", &ASTBuilder::exitSubscriptExpression, CstDispatch::OpensArray | CstDispatch::ClosesArray},
+    {"declaration", &ASTBuilder::exitDeclaration, 0},
+    {"init_declarator", &ASTBuilder::exitInitDeclarator, 0},
+    {"abstract_pointer_declarator", &ASTBuilder::exitAbstractPointerDeclarator, 0},
+    {"pointer_declarator", &ASTBuilder::exitPointerDeclarator, 0},
+    {"field_declaration", &ASTBuilder::exitFieldDeclaration, 0},
+    {"field_declaration_list", &ASTBuilder::exitFieldDeclarationList, 0},
+    {"struct_specifier", &ASTBuilder::exitStructSpecifier, 0},
+    {"type_definition", &ASTBuilder::exitTypeDefinition, 0},
+    {"translation_unit", &ASTBuilder::exitTransUnit, CstDispatch::TranslationUnit},
+    {"field_expression", &ASTBuilder::exitFieldExpression, 0},
+    {"pointer_expression", &ASTBuilder::exitPointerExpression, 0},
+    {"preproc_arg", &ASTBuilder::exitPreprocArg, 0},
+    {"preproc_def", &ASTBuilder::exitPreprocDef, 0},
+    {"parenthesized_expression", &ASTBuilder::exitParenthesizedExpr, 0},
+    {"unary_expression", &ASTBuilder::exitUnaryExpr, 0},
+    {"if_statement", &ASTBuilder::exitIfStatement, 0},
+    {"else_clause", &ASTBuilder::exitElseClause, 0},
+    {"for_statement", &ASTBuilder::exitForStatement, 0},
+    {"initializer_list", &ASTBuilder::exitInitList, 0},
+    {"while_statement", &ASTBuilder::exitWhileStatement, 0},
+    {"break_statement", &ASTBuilder::exitBreakStatement, 0},
+    {"case_statement", &ASTBuilder::exitCaseStatement, 0},
+    {"switch_statement", &ASTBuilder::exitSwitchStatement, 0},
+};
+
+}
+
+// A name can stand for several symbols (aliases, hidden duplicates), so the table is
+// filled by walking every symbol of the language rather than one lookup per name.
+CstDispatch::CstDispatch(const TSLanguage* language) {
+    uint32_t symbolCount = ts_language_symbol_count(language);
+    handlers.assign(symbolCount, nullptr);
+    symbolFlags.assign(symbolCount, 0);
+
+    std::unordered_map<std::string_view, const SymbolHandler*> byName;
+    for (const SymbolHandler& entry : symbol_handlers) {
+        byName[entry.name] = &entry;
+        if (ts_language_symbol_for_name(language, entry.name, std::strlen(entry.name), true) == 0) {
+            throw std::runtime_error(std::string("Error: the tree-sitter grammar has no named symbol '") + entry.name +
+                                     "', ASTBuilder and the grammar are out of sync");
+        }
+    }
+    for (TSSymbol symbol = 0; symbol < symbolCount; symbol++) {
+        if (ts_language_symbol_type(language, symbol) != TSSymbolTypeRegular) {
+            continue;
+        }
+        auto it = byName.find(ts_language_symbol_name(language, symbol));
+        if (it != byName.end()) {
+            handlers[symbol] = it->second->handler;
+            symbolFlags[symbol] = it->second->flags;
+        }
+    }
+}
+
+const CstDispatch& CstDispatch::forLanguage(const TSLanguage* language) {
+    static std::mutex tablesMutex;
+    static std::map<const TSLanguage*, std::unique_ptr<CstDispatch>> tables;
+    std::lock_guard<std::mutex> lock(tablesMutex);
+    std::unique_ptr<CstDispatch>& table = tables[language];
+    if (!table) {
+        table.reset(new CstDispatch(language));
+    }
+    return *table;
+}
+
 // Function to create an AST node from a CST node
 void ASTBuilder::exit_cst_node(const TSNode & cst_node) {
-    const char* type = ts_node_type(cst_node);
     TSSymbol symbol_type = ts_node_symbol(cst_node);
 
-    if (program["--verbose"] == true){
-        if (ts_node_is_named(cst_node))
-        std::cout << "Exiting CST node: "<< "Named, " << ts_language_symbol_name(this->language, symbol_type) << ", symbol_type id:"<< std::to_string(symbol_type) << std::endl;
-        else
-        std::cout << "Exiting CST node: " << "Not Named, " << ts_language_symbol_name(this->language, symbol_type) << ", symbol_type id:"<< std::to_string(symbol_type) << std::endl;
+    if (verbose) {
+        *traceOut << "Exiting CST node: " << ts_language_symbol_name(this->language, symbol_type) << ", symbol_type id:" << symbol_type << std::endl;
     }
 
-    switch (symbol_type)
-    {
-        case 1: // Identifier
-        case 360: // field_identifier, map field_identifier to exitIdentifier
-            exitIdentifier(cst_node);
-            break;
-        case 362: // type_identifier
-            exitTypeIdentifier(cst_node);
-            break;
-        case 93: // primitive_type
-            exitPrimitiveType(cst_node);
-            break;
-        case 260: // parameter_declaration
-            exitParameter(cst_node);
-            break;
-        case 258: // parameter_list
-            exitParamList(cst_node);
-            break;
-        case 230: // function_declarator
-            exitFunctionDeclarator(cst_node);
-            break;
-        case 290: // binary_expression
-            exitBinaryExpr(cst_node);
-            break;
-        case 141: // literal_number
-            exitLiteralNumber(cst_node);
-            break;
-        case 147: // character
-            exitLiteralChar(cst_node);
-            break;
-        case 318: // char_literal
-            break;
-        case 275: // return_statement
-            exitReturnStatement(cst_node);
-            break;
-        case 241: // compound_statement
-            exitCompoundStatement(cst_node);
-            break;
-        case 196: // function_definition
-            exitFunctionDefinition(cst_node);
-            break;
-        case 309: // arg_list
-            exitArgList(cst_node);
-            break;
-        case 299: // call_expr
-            exitCallExpr(cst_node);
-            break;
-        case 287: // assign_expr
-            exitAssignExpr(cst_node);
-            break;
-        case 266: //expression_statement
-            exitExprStmt(cst_node);
-            break;
-        case 160: // comment
-            break;
-        case 153: // string_content
-            exitStringContent(cst_node);
-            break;
-        case 320: // string_literal
-            exitLiteralString(cst_node);
-            break;
-        case 164: // preproc_include
-            exitPreprocInclude(cst_node);
-            break;
-        case 242: // storage_class_specifier
-            exitStorageClassSpecifier(cst_node);
-            break;
-        case 236: // array_declarator
-            exitArrayDeclarator(cst_node);
-            break;
-        case 298: // subscript_expression
-            exitSubscriptExpression(cst_node);
-            arraylevel -= 1;
-            break;
-        case 198: // declaration
-            exitDeclaration(cst_node);
-            break;
-        case 240: // init_declarator already handled in declaration
-            exitInitDeclarator(cst_node);
-            break;
-        case 229: // abstract_pointer_declarator
-            exitAbstractPointerDeclarator(cst_node);
-            break;
-        case 226: // pointer_declarator
-            exitPointerDeclarator(cst_node);
-            break;
-        case 253: // field_declaration
-            exitFieldDeclaration(cst_node);
-            break;
-        case 251: // field_declaration_list
-            exitFieldDeclarationList(cst_node);
-            break;
-        case 249: // struct_specifier
-            exitStructSpecifier(cst_node);
-            break;
-        case 199: // type_definition
-            exitTypeDefinition(cst_node);
-            break;
-        case 161: // translation_unit
-            exitTransUnit(cst_node);
-            break;
-        case 310: // field_expression
-            exitFieldExpression(cst_node);
-            break;
-        case 288: // pointer_expression
-            exitPointerExpression(cst_node);
-            break;
-        case 18: // preproc_arg
-            exitPreprocArg(cst_node);
-            break;
-        case 165: // preproc_def
-            exitPreprocDef(cst_node);
-            break;
-        case 312: // parenthesized_expression
-            exitParenthesizedExpr(cst_node);
-            break;
-        case 289: // unary_expression
-            exitUnaryExpr(cst_node);
-            break;
-        case 267: // if_statement
-            exitIfStatement(cst_node);
-            break;
-        case 268: // else_clause
-            exitElseClause(cst_node);
-            break;
-        case 273: // for_statement
-            exitForStatement(cst_node);
-            break;
-        case 313: // initializer_list
-            exitInitList(cst_node);
-            break;
-        case 271: // while_statement
-            exitWhileStatement(cst_node);
-            break;
-        case 276: // break_statement
-            exitBreakStatement(cst_node);
-            break;
-        case 270: // case_statement
-            exitCaseStatement(cst_node);
-            break;
-        case 269: // switch_statement
-            exitSwitchStatement(cst_node);
-            break;
-        default:
-            std::cerr << "Error: Unhandled CST node type: " ;
-            std::cerr << ts_language_symbol_name(this->language, symbol_type) << ", symbol_type id:" << std::to_string(symbol_type) << std::endl;
-            break;
+    CstDispatch::Handler handler = dispatch.handler(symbol_type);
+    if (handler == nullptr) {
+        std::cerr << "Error: Unhandled CST node type: " ;
+        std::cerr << ts_language_symbol_name(this->language, symbol_type) << ", symbol_type id:" << std::to_string(symbol_type) << std::endl;
+        return;
+    }
+    (this->*handler)(cst_node);
+    if (dispatch.flags(symbol_type) & CstDispatch::ClosesArray) {
+        arraylevel -= 1;
     }
-    return;
 }
 
 void ASTBuilder::enter_cst_node(const TSNode & cst_node){
-     TSSymbol symbol_type = ts_node_symbol(cst_node);
-     if (symbol_type == 236){
-         arraylevel += 1;
-     }
-     else if (symbol_type == 298){
-         arraylevel += 1;
-     }
-
+    if (dispatch.flags(ts_node_symbol(cst_node)) & CstDispatch::OpensArray) {
+        arraylevel += 1;
+    }
 }
 
-void ASTBuilder::traverse_tree(const TSNode & node) {
-
+bool ASTBuilder::visit_cst_node(const TSNode & node) {
+    // anonymous nodes are punctuation and keywords, the AST is built from named ones
+    if (!ts_node_is_named(node)) {
+        return false;
+    }
+    if (dispatch.flags(ts_node_symbol(node)) & CstDispatch::FunctionDefinition) {
+        if (skipFunctions || !wantsFunction(node)) {
+            return false;
+        }
+        if (nextPrebuilt < prebuiltNodes.size() && ts_node_eq(node, prebuiltNodes[nextPrebuilt])) {
+            Ir* function = prebuilt[nextPrebuilt++];
+            if (function != nullptr) {
+                this->ast_stack.push(function);
+            }
+            return false;
+        }
+    }
+    visitedNodes++;
     enter_cst_node(node);
+    return true;
+}
 
-    uint32_t named_child_count = ts_node_named_child_count(node);
-    for (uint32_t i = 0; i < named_child_count; i++) {
-        TSNode child = ts_node_named_child(node, i);
-        traverse_tree(child);
+// Each function_definition directly below the translation unit is a self-contained
+// subtree, so the functions are built by a pool of workers, each with its own builder
+// (and so its own stack) and its own IrArena, which the caller's arena absorbs at the
+// end. tree-sitter trees must not be shared between threads, every extra worker reads
+// its own ts_tree_copy, taken on the calling thread before the workers start. The walk that follows builds the globals and pushes each
+// prebuilt function where its subtree is, so the unit comes out in source order.
+void ASTBuilder::buildFunctions(const TSNode& unit) {
+    // one cursor pass over the children, ts_node_child(unit, i) would rescan the siblings before i
+    std::vector<uint32_t> childIndexes;
+    TSTreeCursor cursor = ts_tree_cursor_new(unit);
+    if (ts_tree_cursor_goto_first_child(&cursor)) {
+        uint32_t i = 0;
+        do {
+            TSNode child = ts_tree_cursor_current_node(&cursor);
+            if ((dispatch.flags(ts_node_symbol(child)) & CstDispatch::FunctionDefinition) && wantsFunction(child)) {
+                childIndexes.push_back(i);
+                prebuiltNodes.push_back(child);
+            }
+            i++;
+        } while (ts_tree_cursor_goto_next_sibling(&cursor));
+    }
+    ts_tree_cursor_delete(&cursor);
+    prebuilt.assign(prebuiltNodes.size(), nullptr);
+
+    unsigned workers = threads != 0 ? threads : std::max(1u, std::thread::hardware_concurrency());
+    workers = static_cast<unsigned>(std::min<size_t>(workers, prebuiltNodes.size()));
+    if (workers < 2) {
+        // not worth a thread, the walk builds them as usual
+        prebuiltNodes.clear();
+        prebuilt.clear();
+        return;
     }
 
-    exit_cst_node(node);
+    std::atomic<size_t> next(0);
+    std::atomic<size_t> visited(0);
+
+    // a function that fails to build is left out of the unit, as the walk would leave it
+    // the functions a worker takes come in source order, so a cursor over its own tree
+    // only ever moves forward to the next one
+    auto work = [&](TSNode workerUnit) {
+        TSTreeCursor childCursor = ts_tree_cursor_new(workerUnit);
+        ts_tree_cursor_goto_first_child(&childCursor);
+        uint32_t position = 0;
+        size_t i;
+        while ((i = next++) < prebuiltNodes.size()) {
+            while (position < childIndexes[i] && ts_tree_cursor_goto_next_sibling(&childCursor)) {
+                position++;
+            }
+            TSNode definition = ts_tree_cursor_current_node(&childCursor);
+            TraceScope scope("build function", Trace::isEnabled() ? std::string(function_definition_name(definition, *source_code)) : std::string());
+            try {
+                ASTBuilder builder(SourceBuffer::borrow(source_code->view()), language);
+                prebuilt[i] = builder.build(definition);
+                visited += builder.getVisitedNodes();
+            } catch (const std::exception& e) {
+                std::cerr << "Error: cannot build function definition: " << e.what() << std::endl;
+            }
+        }
+        ts_tree_cursor_delete(&childCursor);
+    };
+
+    // without a current arena the nodes come from the heap on every thread
+    IrArena* target = IrArena::active();
+    std::vector<std::unique_ptr<IrArena>> arenas(workers - 1);
+    std::vector<TSTree*> copies(workers - 1);
+    for (TSTree*& copy : copies) {
+        copy = ts_tree_copy(unit.tree);
+    }
+    std::vector<std::thread> pool;
+    for (unsigned w = 1; w < workers; w++) {
+        IrArena* arena = nullptr;
+        if (target != nullptr) {
+            arenas[w - 1].reset(new IrArena());
+            arena = arenas[w - 1].get();
+        }
+        pool.emplace_back([&work, copy = copies[w - 1], arena, w] {
+            Trace::setThreadName("ast worker " + std::to_string(w));
+            if (arena != nullptr) {
+                IrArena::Scope arenaScope(*arena);
+                work(ts_tree_root_node(copy));
+            } else {
+                work(ts_tree_root_node(copy));
+            }
+        });
+    }
+    work(unit);
+    for (std::thread& thread : pool) {
+        thread.join();
+    }
+    for (TSTree* copy : copies) {
+        ts_tree_delete(copy);
+    }
+    for (std::unique_ptr<IrArena>& arena : arenas) {
+        if (arena) {
+            target->absorb(*arena);
+        }
+    }
+    visitedNodes += visited;
 }
 
-    // uint32_t child_count = ts_node_child_count(node);
-    // for (uint32_t i = 0; i < child_count; i++) {
-    //     TSNode child = ts_node_child(node, i);
-    //     traverse_tree(child);
-    // }
+// Depth-first walk on a TSTreeCursor: moving to the first child, the next sibling or the
+// parent is O(1), where ts_node_named_child(node, i) rescans the siblings before i, and
+// the walk needs no native stack however deep the tree is. Children are only entered
+// below visited nodes, so every node on the way back up gets its exit callback.
+void ASTBuilder::traverse_tree(const TSNode & node) {
+    TSTreeCursor cursor = ts_tree_cursor_new(node);
+    bool visited = visit_cst_node(node);
+    uint32_t depth = 0;
+
+    while (true) {
+        if (visited && ts_tree_cursor_goto_first_child(&cursor)) {
+            depth++;
+            visited = visit_cst_node(ts_tree_cursor_current_node(&cursor));
+            continue;
+        }
+        // the current node is done, leave it and every ancestor that has no next sibling
+        while (true) {
+            if (visited) {
+                TSNode current = ts_tree_cursor_current_node(&cursor);
+                exit_cst_node(current);
+            }
+            if (depth == 0) {
+                ts_tree_cursor_delete(&cursor);
+                return;
+            }
+            if (ts_tree_cursor_goto_next_sibling(&cursor)) {
+                visited = visit_cst_node(ts_tree_cursor_current_node(&cursor));
+                break;
+            }
+            ts_tree_cursor_goto_parent(&cursor);
+            depth--;
+            visited = true;
+        }
+    }
+}
 
@@ -0,0 +1,276 @@
+#include <iostream>
+#include <sstream>
+#include <cstring>
+#include <cmath>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "AnalysisServer.h"
+#include "Json.h"
+#include "utils.h"
+#include "Trace.h"
+
+// echo the request id back verbatim when it is a string or a number
+static std::string render_id(const JsonValue* id) {
+    if (id == nullptr) {
+        return "null";
+    }
+    if (id->isString()) {
+        return "\"" + json_escape(id->asString()) + "\"";
+    }
+    if (id->getType() == JsonValue::Type::Number) {
+        double number = id->asNumber();
+        if (std::floor(number) == number) {
+            return std::to_string(static_cast<long long>(number));
+        }
+        return std::to_string(number);
+    }
+    return "null";
+}
+
+static std::string error_response(const std::string& id, const std::string& message) {
+    return "{\"id\": " + id + ", \"ok\": false, \"error\": \"" + json_escape(message) + "\"}";
+}
+
+const AnalysisServer::CachedFile* AnalysisServer::lookup(const std::string& filename, bool& cached, std::string& error) {
+    struct stat st;
+    if (stat(filename.c_str(), &st) == -1) {
+        error = "cannot stat " + filename + ": " + std::strerror(errno);
+        return nullptr;
+    }
+
+    auto it = cache.find(filename);
+    if (it != cache.end() && it->second.size == st.st_size &&
+        it->second.mtime.tv_sec == st.st_mtim.tv_sec && it->second.mtime.tv_nsec == st.st_mtim.tv_nsec) {
+        cached = true;
+        return &it->second;
+    }
+
+    SourceBuffer* source = read_file(filename);
+    if (source == nullptr) {
+        cache.erase(filename);
+        error = "cannot read " + filename;
+        return nullptr;
+    }
+    std::string text(source->view());
+    delete source;
+
+    // the parser throws on code it cannot build an AST for; drop the half-built entry
+    try {
+        return analyze(filename, st, std::move(text), cached, error);
+    } catch (const std::exception& e) {
+        cache.erase(filename);
+        error = "failed to analyze " + filename + ": " + e.what();
+        return nullptr;
+    }
+}
+
+const AnalysisServer::CachedFile* AnalysisServer::analyze(const std::string& filename, const struct stat& st, std::string text,
+                                                           bool& cached, std::string& error) {
+    CachedFile& entry = cache[filename];
+    entry.size = st.st_size;
+    entry.mtime = st.st_mtim;
+    bool ok;
+    if (!entry.session) {
+        entry.session.reset(new IncrementalSession());
+        // IR and the plain CFG have to be rendered before SSA renames the statements
+        CachedFile* file = &entry;
+        entry.session->setCfgHook([file](size_t index, const IncrementalSession::Function& function) {
+            if (file->functions.size() <= index) {
+                file->functions.resize(index + 1);
+            }
+            FunctionArtifacts& artifacts = file->functions[index];
+            artifacts.name = function.name;
+            std::ostringstream ir;
+            function.builder->print(ir);
+            function.symbolTable->print(ir);
+            artifacts.ir = ir.str();
+            artifacts.cfgDot = function.cfg->generateDotFile();
+        });
+        ok = entry.session->open(std::move(text));
+    } else {
+        ok = entry.session->update(text);
+    }
+    if (!ok) {
+        cache.erase(filename);
+        error = "failed to analyze " + filename;
+        return nullptr;
+    }
+
+    const std::vector<IncrementalSession::Function>& functions = entry.session->getFunctions();
+    entry.functions.resize(functions.size());
+    for (size_t index : entry.session->getRebuilt()) {
+        entry.functions[index].ssaDot = functions[index].cfg->generateDotFile();
+    }
+    cached = false;
+    return &entry;
+}
+
+std::string AnalysisServer::handleRequest(const std::string& line) {
+    TraceScope scope("request");
+    JsonValue request;
+    try {
+        request = JsonParser(line).parse();
+    } catch (const std::exception& e) {
+        return error_response("null", e.what());
+    }
+    std::string id = render_id(request.get("id"));
+    // one bad request must not take the server down
+    try {
+        return handle(request, id);
+    } catch (const std::exception& e) {
+        return error_response(id, e.what());
+    }
+}
+
+std::string AnalysisServer::handle(const JsonValue& request, const std::string& id) {
+    if (!request.isObject()) {
+        return error_response(id, "request must be a JSON object");
+    }
+
+    std::string op = request.getString("op", "analyze");
+    std::string filename = request.getString("file");
+
+    if (op == "shutdown") {
+        running = false;
+        return "{\"id\": " + id + ", \"ok\": true}";
+    }
+    if (op == "drop") {
+        cache.erase(filename);
+        return "{\"id\": " + id + ", \"ok\": true}";
+    }
+    if (op != "analyze") {
+        return error_response(id, "unknown op: " + op);
+    }
+    if (filename.empty()) {
+        return error_response(id, "missing \"file\"");
+    }
+
+    bool wantIr = true, wantCfg = true, wantSsa = true;
+    if (const JsonValue* artifacts = request.get("artifacts")) {
+        wantIr = wantCfg = wantSsa = false;
+        for (const JsonValue& artifact : artifacts->asArray()) {
+            wantIr |= artifact.asString() == "ir";
+            wantCfg |= artifact.asString() == "cfg";
+            wantSsa |= artifact.asString() == "ssa";
+        }
+    }
+    std::string function = request.getString("function");
+
+    bool cached = false;
+    std::string error;
+    const CachedFile* entry = lookup(filename, cached, error);
+    if (entry == nullptr) {
+        return error_response(id, error);
+    }
+
+    std::ostringstream response;
+    response << "{\"id\": " << id << ", \"ok\": true, \"file\": \"" << json_escape(filename)
+             << "\", \"cached\": " << (cached ? "true" : "false") << ", \"functions\": [";
+    bool first = true;
+    for (const FunctionArtifacts& artifacts : entry->functions) {
+        if (!function.empty() && artifacts.name != function) {
+            continue;
+        }
+        response << (first ? "" : ", ") << "{\"name\": \"" << json_escape(artifacts.name) << "\"";
+        if (wantIr) {
+            response << ", \"ir\": \"" << json_escape(artifacts.ir) << "\"";
+        }
+        if (wantCfg) {
+            response << ", \"cfg\": \"" << json_escape(artifacts.cfgDot) << "\"";
+        }
+        if (wantSsa) {
+            response << ", \"ssa\": \"" << json_escape(artifacts.ssaDot) << "\"";
+        }
+        response << "}";
+        first = false;
+    }
+    response << "]}";
+
+    if (first && !function.empty()) {
+        return error_response(id, "no function named " + function + " in " + filename);
+    }
+    return response.str();
+}
+
+void AnalysisServer::serve(std::istream& in, std::ostream& out) {
+    std::string line;
+    while (running && std::getline(in, line)) {
+        if (line.find_first_not_of(" \t\r") == std::string::npos) {
+            continue;
+        }
+        out << handleRequest(line) << std::endl;
+    }
+}
+
+static bool write_all(int fd, const std::string& data) {
+    size_t written = 0;
+    while (written < data.size()) {
+        ssize_t n = write(fd, data.data() + written, data.size() - written);
+        if (n <= 0) {
+            if (n == -1 && errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        written += n;
+    }
+    return true;
+}
+
+int AnalysisServer::serveSocket(const std::string& socketPath) {
+    sockaddr_un address = {};
+    if (socketPath.size() >= sizeof(address.sun_path)) {
+        std::cerr << "Error: socket path too long: " << socketPath << std::endl;
+        return 1;
+    }
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, socketPath.c_str(), sizeof(address.sun_path) - 1);
+
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener == -1) {
+        std::cerr << "Error: cannot create socket: " << std::strerror(errno) << std::endl;
+        return 1;
+    }
+    unlink(socketPath.c_str());
+    if (bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == -1 || listen(listener, 8) == -1) {
+        std::cerr << "Error: cannot listen on " << socketPath << ": " << std::strerror(errno) << std::endl;
+        close(listener);
+        return 1;
+    }
+
+    while (running) {
+        int connection = accept(listener, nullptr, nullptr);
+        if (connection == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+
+        std::string pending;
+        char chunk[64 * 1024];
+        ssize_t n;
+        while (running && (n = read(connection, chunk, sizeof(chunk))) > 0) {
+            pending.append(chunk, n);
+            size_t start = 0, newline;
+            while (running && (newline = pending.find('\n', start)) != std::string::npos) {
+                std::string line = pending.substr(start, newline - start);
+                start = newline + 1;
+                if (line.find_first_not_of(" \t\r") == std::string::npos) {
+                    continue;
+                }
+                if (!write_all(connection, handleRequest(line) + "\n")) {
+                    break;
+                }
+            }
+            pending.erase(0, start);
+        }
+        close(connection);
+    }
+
+    close(listener);
+    unlink(socketPath.c_str());
+    return 0;
+}
@@ -0,0 +1,112 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cerrno>
+#include <cstring>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <functional>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "ArtifactCache.h"
+
+// bump when the layout of an entry or the rendering of any section changes
+static const char* CACHE_MAGIC = "svf-cache 4";
+
+ArtifactCache::ArtifactCache(const std::string& directory) : directory(directory) {
+    // create every missing component, like mkdir -p
+    for (size_t slash = directory.find('/', 1); ; slash = directory.find('/', slash + 1)) {
+        std::string prefix = directory.substr(0, slash);
+        if (mkdir(prefix.c_str(), 0755) == -1 && errno != EEXIST) {
+            std::cerr << "Warning: cannot create cache directory " << prefix << ": " << std::strerror(errno) << std::endl;
+            break;
+        }
+        if (slash == std::string::npos) {
+            break;
+        }
+    }
+}
+
+uint64_t ArtifactCache::hash(std::string_view text, uint64_t seed) {
+    uint64_t h = seed;
+    for (unsigned char c : text) {
+        h ^= c;
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+std::string ArtifactCache::toHex(uint64_t key) {
+    char buffer[17];
+    std::snprintf(buffer, sizeof(buffer), "%016llx", static_cast<unsigned long long>(key));
+    return buffer;
+}
+
+bool ArtifactCache::fromHex(const std::string& hex, uint64_t& key) {
+    if (hex.size() != 16) {
+        return false;
+    }
+    char* end = nullptr;
+    key = std::strtoull(hex.c_str(), &end, 16);
+    return end == hex.c_str() + hex.size();
+}
+
+std::string ArtifactCache::pathFor(uint64_t key, const char* kind) const {
+    return directory + "/" + toHex(key) + "." + kind;
+}
+
+// Layout: the magic line, then per section "<name> <size>\n<size bytes>\n"
+bool ArtifactCache::load(uint64_t key, const char* kind, CacheEntry& entry) const {
+    std::ifstream in(pathFor(key, kind), std::ios::binary);
+    if (!in.is_open()) {
+        return false;
+    }
+    std::string line;
+    if (!std::getline(in, line) || line != CACHE_MAGIC) {
+        return false;
+    }
+
+    entry.clear();
+    std::string name;
+    size_t size;
+    while (in >> name >> size) {
+        in.get(); // the newline after the size
+        std::string& text = entry[name];
+        text.resize(size);
+        if (!in.read(&text[0], size) || in.get() != '\n') {
+            entry.clear();
+            return false;
+        }
+    }
+    return in.eof();
+}
+
+void ArtifactCache::store(uint64_t key, const char* kind, const CacheEntry& entry) const {
+    std::string path = pathFor(key, kind);
+    // unique per process and thread, rename() then publishes the entry atomically
+    std::ostringstream tmpPath;
+    tmpPath << path << ".tmp" << getpid() << "-" << std::hash<std::thread::id>()(std::this_thread::get_id());
+
+    {
+        std::ofstream out(tmpPath.str(), std::ios::binary | std::ios::trunc);
+        if (!out.is_open()) {
+            std::cerr << "Warning: cannot write cache entry " << tmpPath.str() << std::endl;
+            return;
+        }
+        out << CACHE_MAGIC << "\n";
+        for (const auto& section : entry) {
+            out << section.first << " " << section.second.size() << "\n" << section.second << "\n";
+        }
+        if (!out) {
+            std::cerr << "Warning: cannot write cache entry " << tmpPath.str() << std::endl;
+            out.close();
+            unlink(tmpPath.str().c_str());
+            return;
+        }
+    }
+    if (std::rename(tmpPath.str().c_str(), path.c_str()) != 0) {
+        std::cerr << "Warning: cannot publish cache entry " << path << ": " << std::strerror(errno) << std::endl;
+        unlink(tmpPath.str().c_str());
+    }
+}
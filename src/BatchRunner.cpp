@@ -0,0 +1,141 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <unordered_set>
+#include <filesystem>
+#include <memory>
+#include "BatchRunner.h"
+#include "Trace.h"
+#include "OutputSink.h"
+#include "Json.h"
+
+namespace fs = std::filesystem;
+
+// compile_commands.json: [{"directory": ..., "file": ..., "command"|"arguments": ...}, ...]
+static std::vector<std::string> load_compile_database(const std::string& text) {
+    std::vector<std::string> files;
+    JsonValue database = JsonParser(text).parse();
+    if (!database.isArray()) {
+        throw std::runtime_error("compile database must be a JSON array");
+    }
+
+    std::unordered_set<std::string> seen;
+    for (const JsonValue& entry : database.asArray()) {
+        std::string file = entry.getString("file");
+        if (file.empty()) {
+            continue;
+        }
+        fs::path path(file);
+        if (path.is_relative()) {
+            path = fs::path(entry.getString("directory")) / path;
+        }
+        std::string normalized = path.lexically_normal().string();
+        // the same TU may be listed once per build configuration
+        if (seen.insert(normalized).second) {
+            files.push_back(normalized);
+        }
+    }
+    return files;
+}
+
+std::vector<std::string> load_batch_inputs(const std::string& listPath) {
+    std::ifstream file(listPath);
+    if (!file.is_open()) {
+        std::cerr << "Failed to open batch list: " << listPath << std::endl;
+        return {};
+    }
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+
+    if (fs::path(listPath).extension() == ".json") {
+        try {
+            return load_compile_database(buffer.str());
+        } catch (const std::runtime_error& e) {
+            std::cerr << "Error in compile database " << listPath << ": " << e.what() << std::endl;
+            return {};
+        }
+    }
+
+    std::vector<std::string> files;
+    std::string line;
+    while (std::getline(buffer, line)) {
+        size_t start = line.find_first_not_of(" \t\r");
+        if (start == std::string::npos || line[start] == '#') {
+            continue;
+        }
+        size_t end = line.find_last_not_of(" \t\r");
+        files.push_back(line.substr(start, end - start + 1));
+    }
+    return files;
+}
+
+BatchRunner::BatchRunner(const DriverOptions& options, unsigned jobs, const std::string& outputDir)
+    : options(options), jobs(jobs), outputDir(outputDir) {
+    if (this->jobs == 0) {
+        this->jobs = std::max(1u, std::thread::hardware_concurrency());
+    }
+}
+
+// <outputDir>/<index>-<stem>. keeps TUs with the same base name apart
+std::string BatchRunner::outputFileFor(size_t index, const std::string& filename) const {
+    std::string stem = fs::path(filename).stem().string();
+    return (fs::path(outputDir) / (std::to_string(index) + "-" + stem + ".out.txt")).string();
+}
+
+int BatchRunner::run(const std::vector<std::string>& files, std::vector<FileStats>* stats) {
+    std::error_code ec;
+    fs::create_directories(outputDir, ec);
+    if (ec) {
+        std::cerr << "Failed to create output directory " << outputDir << ": " << ec.message() << std::endl;
+        return static_cast<int>(files.size());
+    }
+
+    if (stats) {
+        // one slot per file, so workers never touch the same element
+        stats->assign(files.size(), FileStats());
+    }
+
+    std::atomic<size_t> next{0};
+    std::atomic<int> failures{0};
+    std::mutex logMutex;
+
+    auto worker = [&](unsigned workerIndex) {
+        Trace::setThreadName("worker " + std::to_string(workerIndex));
+        Driver driver(options);
+        for (size_t i = next++; i < files.size(); i = next++) {
+            // report and DOT artifacts of one TU share a single buffered file
+            std::unique_ptr<OutputSink> sink(OutputSink::open(outputFileFor(i, files[i])));
+            int status = 1;
+            std::string reason;
+            // an exception escaping the thread would end the whole batch, so it fails only this file
+            try {
+                status = sink ? driver.analyzeFile(files[i], *sink, stats ? &(*stats)[i] : nullptr) : 1;
+            } catch (const std::exception& e) {
+                reason = e.what();
+            }
+            if (sink && !sink->close()) {
+                status = 1;
+            }
+            if (status != 0) {
+                failures++;
+                std::lock_guard<std::mutex> lock(logMutex);
+                std::cerr << "Error: failed to analyze " << files[i] << (reason.empty() ? "" : ": " + reason) << std::endl;
+            }
+        }
+    };
+
+    unsigned workerCount = std::min<size_t>(jobs, std::max<size_t>(files.size(), 1));
+    std::vector<std::thread> workers;
+    workers.reserve(workerCount);
+    for (unsigned i = 0; i < workerCount; i++) {
+        workers.emplace_back(worker, i);
+    }
+    for (std::thread& t : workers) {
+        t.join();
+    }
+
+    return failures;
+}
@@ -0,0 +1,993 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
+#include <filesystem>
+#include <fcntl.h>
+#include <unistd.h>
+#include "Driver.h"
+#include "utils.h"
+#include "ASTBuilder.h"
+#include "CFG.h"
+#include "ArtifactCache.h"
+#include "Stats.h"
+#include "Trace.h"
+#include "OutputSink.h"
+#include "Budget.h"
+
+// Include the C parser header
+extern "C" const TSLanguage *tree_sitter_c();
+
+Driver::Driver(const DriverOptions& options) : options(options) {
+    // Create a new parser
+    parser = ts_parser_new();
+    // Get the language from the parser
+    language = tree_sitter_c();
+    ts_parser_set_language(parser, language);
+    if (options.parseTimeoutMs > 0) {
+        ts_parser_set_timeout_micros(parser, options.parseTimeoutMs * 1000);
+    }
+}
+
+Driver::~Driver() {
+    ts_parser_delete(parser);
+    delete cache;
+}
+
+// the named file-level phase, or nullptr when no statistics were requested
+static PhaseStats* file_phase(FileStats* stats, const char* name) {
+    return stats ? stats->phase(name) : nullptr;
+}
+
+// builder 0 holds the globals and has no per-function entry
+static PhaseStats* function_phase(FileStats* stats, size_t builderIndex, const char* name) {
+    if (stats == nullptr || builderIndex == 0) {
+        return nullptr;
+    }
+    return stats->functions[builderIndex - 1].phase(name);
+}
+
+// the concrete syntax tree as a dot graph, unless its artifact cannot be opened
+static void write_cst(OutputSink& sink, TSTree* tree, FileStats* stats) {
+    PhaseTimer timer(file_phase(stats, "output"));
+    TraceScope scope("output");
+    sink.beginArtifact("cst.dot");
+    int fd = sink.artifactFd();
+    if (fd != -1) {
+        ts_tree_print_dot_graph(tree, fd);
+    }
+    sink.endArtifact();
+}
+
+static size_t count_phis(CFG* cfg) {
+    size_t phis = 0;
+    for (BasicBlock* block : cfg->getBlocksList()) {
+        for (LlStatement* stmt : block->getLlStatements()) {
+            if (isa<LlPhiStatement>(stmt)) {
+                phis++;
+            }
+        }
+    }
+    return phis;
+}
+
+// note a function that ran over its budget in the report and the statistics
+static void degrade(std::ostream& out, const std::string& name, Degradation degradation, FunctionStats* stats) {
+    const char* dropped = degradation == Degradation::Skipped ? "CFG and SSA" : "SSA";
+    std::cerr << "Warning: " << name << " ran over its analysis budget, " << dropped << " skipped" << std::endl;
+    out << "\n// " << name << ": over its analysis budget, " << dropped << " skipped" << std::endl;
+    if (stats) {
+        stats->degraded = degradation_name(degradation);
+    }
+}
+
+// a --functions name that does not name any function definition of the file
+static void report_missing_functions(const std::vector<std::string>& requested, const std::vector<std::string>& found) {
+    for (const std::string& name : requested) {
+        if (std::find(found.begin(), found.end(), name) == found.end()) {
+            std::cerr << "Warning: no definition of function " << name << std::endl;
+        }
+    }
+}
+
+// Same as IrTransUnit::getLlBuilder, timing each function separately and charging it to its budget
+static LlBuildersList* lower_unit(IrTransUnit* unit, const std::vector<const HeaderUnit*>& headers, FileStats* stats,
+                                  std::vector<FunctionBudget>& budgets, const BudgetLimits& limits, bool recordBlocks) {
+    PhaseTimer timer(file_phase(stats, "lower"));
+    TraceScope scope("lower");
+    LlBuildersList* llBuildersList = new LlBuildersList();
+
+    LlBuilder* builderGlobal = new LlBuilder("globalBuilder");
+    SymbolTable* symbolTableGlobal = new SymbolTable("global");
+    import_headers(headers, *builderGlobal, *symbolTableGlobal);
+    unit->lowerGlobals(*builderGlobal, *symbolTableGlobal);
+    llBuildersList->addBuilder(builderGlobal);
+    llBuildersList->addSymbolTable(symbolTableGlobal);
+    budgets.emplace_back(limits);
+
+    for (IrFunctionDef* func : unit->getFunctionList()) {
+        std::string name = stats || Trace::isEnabled() ? func->getFunctionDecl()->getName() : std::string();
+        if (stats) {
+            stats->functions.emplace_back();
+            stats->functions.back().name = name;
+        }
+        PhaseTimer functionTimer(stats ? stats->functions.back().phase("lower") : nullptr);
+        TraceScope functionScope("lower function", name);
+        budgets.emplace_back(limits);
+        FunctionBudget::Charge charge(budgets.back());
+        LlBuilder* builder = new LlBuilder(func->getFunctionName());
+        SymbolTable* symbolTable = new SymbolTable(func->getFunctionName(), symbolTableGlobal);
+        unit->lowerFunction(func, *builder, *symbolTable, recordBlocks);
+        llBuildersList->addBuilder(builder);
+        llBuildersList->addSymbolTable(symbolTable);
+    }
+    return llBuildersList;
+}
+
+int Driver::analyzeFile(const std::string& filename, OutputSink& sink, FileStats* stats) {
+    TraceScope scope("analyze file", filename);
+    if (stats) {
+        stats->filename = filename;
+    }
+    sourceDir = std::filesystem::path(filename).parent_path().string();
+
+    // Map the C file; the parser and the AST builder read it in place
+    SourceBuffer *source_code;
+    {
+        PhaseTimer timer(file_phase(stats, "read"));
+        TraceScope scope("read");
+        source_code = read_file(filename);
+    }
+    if (source_code == nullptr) {
+        return 1;
+    }
+    if (options.expandMacros) {
+        source_code = expandMacros(source_code, stats);
+    }
+
+    if (options.stream) {
+        return analyzeStreaming(source_code, sink, stats);
+    }
+    // the verbose AST dumps need the AST itself, so they always take the full path
+    if (!options.cacheDir.empty() && !options.verbose) {
+        if (cache == nullptr) {
+            cache = new ArtifactCache(options.cacheDir);
+        }
+        return analyzeCached(source_code, sink, stats);
+    }
+    return analyzeSource(source_code, sink, stats);
+}
+
+std::vector<const HeaderUnit*> Driver::loadHeaders(const std::vector<IncludeDirective>& includes, FileStats* stats) {
+    if (options.includePaths.empty() || includes.empty()) {
+        return {};
+    }
+    PhaseTimer timer(file_phase(stats, "headers"));
+    TraceScope scope("headers");
+    return HeaderCache::global().loadIncludes(includes, sourceDir, options.includePaths);
+}
+
+SourceBuffer* Driver::expandMacros(SourceBuffer* source_code, FileStats* stats) {
+    PhaseTimer timer(file_phase(stats, "macros"));
+    TraceScope scope("expand macros");
+    // with -I, #include brings in the macros of the header
+    MacroExpander::IncludeResolver resolver;
+    if (!options.includePaths.empty()) {
+        resolver = [this](std::string_view name, bool system) -> const MacroTable* {
+            std::string path = HeaderCache::resolve(name, system, sourceDir, options.includePaths);
+            const HeaderUnit* header = path.empty() ? nullptr : HeaderCache::global().load(path, options.includePaths);
+            return header ? &header->macros : nullptr;
+        };
+    }
+    std::string expanded;
+    if (!macroExpander.expandSource(source_code->view(), expanded, resolver)) {
+        return source_code;
+    }
+    delete source_code;
+    return new SourceBuffer(std::move(expanded));
+}
+
+TSTree* Driver::parse(SourceBuffer* source_code, FileStats* stats) {
+    PhaseTimer timer(file_phase(stats, "parse"));
+    TraceScope scope("parse");
+    TSTree* tree = ts_parser_parse_string(parser, nullptr, source_code->data(), source_code->size());
+    if (tree == nullptr) {
+        // the parser keeps the half-finished parse to resume it, the next file starts afresh
+        ts_parser_reset(parser);
+        std::cerr << "Error: parsing took longer than " << options.parseTimeoutMs << " ms, file skipped" << std::endl;
+        if (stats) {
+            stats->degraded = "parse-timeout";
+        }
+    }
+    return tree;
+}
+
+int Driver::analyzeSource(SourceBuffer* source_code, OutputSink& sink, FileStats* stats) {
+    std::ostream& out = sink.text();
+    TSTree *tree = parse(source_code, stats);
+    if (tree == nullptr) {
+        // the ASTBuilder that would have taken the buffer over is never made
+        delete source_code;
+        return 1;
+    }
+
+    if (options.outputCst) {
+        write_cst(sink, tree, stats);
+    }
+
+    // Get the root node of the syntax tree
+    TSNode root_node = ts_tree_root_node(tree);
+
+    // every AST node of the unit, freed in one go when the analysis is done
+    IrArena arena;
+    IrArena::Scope arenaScope(arena);
+    ASTBuilder ast_builder(source_code, language, options.verbose);
+    ast_builder.setTraceStream(out);
+    ast_builder.setThreads(options.astThreads);
+    if (!options.functions.empty()) {
+        ast_builder.setFunctionFilter(options.functions);
+    }
+    Ir* ast_root;
+    {
+        PhaseTimer timer(file_phase(stats, "ast"));
+        TraceScope scope("ast");
+        ast_root = ast_builder.build(root_node);
+    }
+    if (stats) {
+        stats->cstNodes += ast_builder.getVisitedNodes();
+    }
+    // the AST keeps its own source locations, the syntax tree is not needed past this point
+    ts_tree_delete(tree);
+    if (ast_root == nullptr) {
+        return 1;
+    }
+
+    if (options.verbose) {
+        out << "\n======= AST:\n";
+        ast_root->printTree(out, 0);
+        out << std::endl;
+        out << "\n======= AST toString():\n" << *ast_root << std::endl;
+    }
+    IrTransUnit* unit = dyn_cast<IrTransUnit>(ast_root);
+    if (unit && !options.functions.empty()) {
+        std::vector<std::string> found;
+        for (IrFunctionDef* func : unit->getFunctionList()) {
+            found.push_back(func->getFunctionDecl()->getName());
+        }
+        report_missing_functions(options.functions, found);
+    }
+
+    // lowered once, the IR dump and the CFGs share the builders
+    LlPool pool;
+    LlPool::Scope poolScope(pool);
+    LlBuildersList* llBuildersList = nullptr;
+    std::vector<FunctionBudget> budgets;   // one per builder
+    if (options.intermedial || options.cfg) {
+        std::vector<const HeaderUnit*> headers = loadHeaders(include_directives(unit), stats);
+        llBuildersList = lower_unit(unit, headers, stats, budgets, options.functionBudget, options.recordBlocks);
+    }
+
+    if (options.intermedial) {
+        PhaseTimer timer(file_phase(stats, "output"));
+        TraceScope scope("output");
+        out << "\n=======IR:\n" << std::endl;
+        llBuildersList->print(out);
+        out << std::endl;
+    }
+
+    // a function over its budget gets no CFG (nullptr) or keeps its CFG without SSA
+    vector<CFG*> cfgs;
+    std::vector<bool> ssaDone;
+    if (options.cfg) {
+        CFGBuilder cfgBuilder;
+        std::vector<LlBuilder*> builders = llBuildersList->getBuilders();
+        {
+            PhaseTimer timer(file_phase(stats, "cfg"));
+            TraceScope scope("cfg");
+            for (size_t i = 0; i < builders.size(); i++) {
+                if (i > 0 && budgets[i].exceeded()) {
+                    degrade(out, builders[i]->getName(), Degradation::Skipped, stats ? &stats->functions[i - 1] : nullptr);
+                    cfgs.push_back(nullptr);
+                    continue;
+                }
+                PhaseTimer functionTimer(function_phase(stats, i, "cfg"));
+                TraceScope functionScope("build cfg", Trace::isEnabled() ? builders[i]->getName() : std::string());
+                FunctionBudget::Charge charge(budgets[i]);
+                cfgs.push_back(cfgBuilder.buildCFG(*builders[i]));
+            }
+        }
+
+        PhaseTimer timer(file_phase(stats, "output"));
+        TraceScope scope("output");
+        for (size_t i = 0; i < cfgs.size(); i++) {
+            if (cfgs[i]) {
+                cfgs[i]->writeDot(sink.beginArtifact("cfg" + to_string(i) + ".dot"));
+                sink.endArtifact();
+            }
+        }
+    }
+
+    if (options.ssa && !cfgs.empty()) {
+        SSAGenerator ssaGenerator(out);
+        std::vector<LlBuilder*> builders = llBuildersList->getBuilders();
+        ssaDone.assign(cfgs.size(), false);
+        {
+            PhaseTimer timer(file_phase(stats, "ssa"));
+            TraceScope scope("ssa");
+            for (size_t i = 1; i < cfgs.size(); i++) {
+                if (cfgs[i] == nullptr) {
+                    continue;
+                }
+                if (!budgets[i].exceeded()) {
+                    PhaseTimer functionTimer(function_phase(stats, i, "ssa"));
+                    TraceScope functionScope("convert to ssa", Trace::isEnabled() ? builders[i]->getName() : std::string());
+                    FunctionBudget::Charge charge(budgets[i]);
+                    ssaGenerator.setDeadline(budgets[i].deadline());
+                    ssaDone[i] = ssaGenerator.convertToSSA(cfgs[i]);
+                }
+                if (!ssaDone[i]) {
+                    degrade(out, builders[i]->getName(), Degradation::CfgOnly, stats ? &stats->functions[i - 1] : nullptr);
+                }
+            }
+        }
+
+        PhaseTimer timer(file_phase(stats, "output"));
+        TraceScope scope("output");
+        for (size_t i = 1; i < cfgs.size(); i++) {
+            if (ssaDone[i]) {
+                cfgs[i]->writeDot(sink.beginArtifact("cfg_ssa" + to_string(i) + ".dot"));
+                sink.endArtifact();
+            }
+        }
+    }
+
+    if (stats && llBuildersList) {
+        std::vector<LlBuilder*> builders = llBuildersList->getBuilders();
+        for (size_t i = 0; i < builders.size(); i++) {
+            size_t statements = builders[i]->size();
+            size_t blocks = i < cfgs.size() && cfgs[i] ? cfgs[i]->getBlocksList().size() : 0;
+            size_t phis = i < cfgs.size() && cfgs[i] ? count_phis(cfgs[i]) : 0;
+            stats->statements += statements;
+            stats->blocks += blocks;
+            stats->phis += phis;
+            if (i > 0) {
+                stats->functions[i - 1].statements = statements;
+                stats->functions[i - 1].blocks = blocks;
+                stats->functions[i - 1].phis = phis;
+            }
+        }
+    }
+
+    // Clean up
+    for (CFG* cfg : cfgs) {
+        delete cfg;
+    }
+    if (options.noTeardown) {
+        // the process exits right after, freeing node by node would only cost time
+        arena.abandon();
+        pool.abandon();
+    }
+
+    if (options.verbose) {
+        out << "\n======== Src:" << std::endl;
+        out << source_code->view() << std::endl;
+    }
+
+    return 0;
+}
+
+static bool is_function_definition(const TSNode& node) {
+    return std::strcmp(ts_node_type(node), "function_definition") == 0;
+}
+
+// the function definitions at any depth, so also those inside #if/#ifdef blocks, in
+// source order; one cursor walk that does not enter the definitions themselves
+static std::vector<TSNode> function_definitions(const TSNode& root) {
+    std::vector<TSNode> definitions;
+    TSTreeCursor cursor = ts_tree_cursor_new(root);
+    uint32_t depth = 0;
+    while (true) {
+        TSNode node = ts_tree_cursor_current_node(&cursor);
+        bool definition = depth > 0 && is_function_definition(node);
+        if (definition) {
+            definitions.push_back(node);
+        }
+        if (!definition && ts_tree_cursor_goto_first_child(&cursor)) {
+            depth++;
+            continue;
+        }
+        while (!ts_tree_cursor_goto_next_sibling(&cursor)) {
+            if (depth == 0) {
+                ts_tree_cursor_delete(&cursor);
+                return definitions;
+            }
+            ts_tree_cursor_goto_parent(&cursor);
+            depth--;
+        }
+    }
+}
+
+// whether --functions (if given) asks for this function definition
+static bool is_selected(const DriverOptions& options, const TSNode& definition, const SourceBuffer& source) {
+    if (options.functions.empty()) {
+        return true;
+    }
+    std::string_view name = function_definition_name(definition, source);
+    return std::find(options.functions.begin(), options.functions.end(), name) != options.functions.end();
+}
+
+// an #include read straight off the syntax tree, for when there is no AST yet
+static bool include_directive(const TSNode& node, SourceBuffer* source_code, IncludeDirective& include) {
+    TSNode path = ts_node_child_by_field_name(node, "path", 4);
+    if (std::strcmp(ts_node_type(node), "preproc_include") != 0 || ts_node_is_null(path)) {
+        return false;
+    }
+    std::string_view text = source_code->slice(ts_node_start_byte(path), ts_node_end_byte(path));
+    if (text.size() < 2) {
+        return false;
+    }
+    include.name = std::string(text.substr(1, text.size() - 2));
+    include.system = text.front() == '<';
+    return true;
+}
+
+// "<hash> <path>" per line for every header in the closure, stored with a cached unit
+static std::string header_manifest(const std::vector<const HeaderUnit*>& headers) {
+    std::string manifest;
+    for (const HeaderUnit* header : include_closure(headers)) {
+        manifest += ArtifactCache::toHex(header->hash) + " " + header->path + "\n";
+    }
+    return manifest;
+}
+
+// whether every header listed in a manifest still has the content it was cached with
+static bool headers_unchanged(const std::string& manifest) {
+    std::istringstream lines(manifest);
+    std::string line;
+    while (std::getline(lines, line)) {
+        size_t space = line.find(' ');
+        uint64_t hash;
+        if (space == std::string::npos || !ArtifactCache::fromHex(line.substr(0, space), hash)) {
+            return false;
+        }
+        std::ifstream file(line.substr(space + 1), std::ios::binary);
+        std::stringstream content;
+        content << file.rdbuf();
+        if (!file || ArtifactCache::hash(content.str()) != hash) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Same outputs as analyzeSource, but each function definition is built into an AST,
+// lowered, turned into a CFG, converted to SSA and written out before the next one is
+// looked at; its AST, Ll statements, CFG and symbol table are freed right after. Only
+// the syntax tree and the globals (declarations, typedefs, macros and the global
+// symbol table) stay resident, so memory is bounded by the largest function instead
+// of the whole file. Functions are numbered in source order and their IR, CFG and
+// SSA output is interleaved per function.
+int Driver::analyzeStreaming(SourceBuffer* source_code, OutputSink& sink, FileStats* stats) {
+    std::ostream& out = sink.text();
+    TSTree *tree = parse(source_code, stats);
+    if (tree == nullptr) {
+        delete source_code;
+        return 1;
+    }
+
+    if (options.outputCst) {
+        write_cst(sink, tree, stats);
+    }
+
+    TSNode root_node = ts_tree_root_node(tree);
+
+    // the globals first, function bodies are left for the loop below
+    IrArena globalArena;
+    IrTransUnit* unit;
+    {
+        IrArena::Scope arenaScope(globalArena);
+        PhaseTimer timer(file_phase(stats, "ast"));
+        TraceScope scope("ast");
+        ASTBuilder ast_builder(SourceBuffer::borrow(source_code->view()), language, options.verbose);
+        ast_builder.setTraceStream(out);
+        ast_builder.setSkipFunctions(true);
+        unit = dyn_cast<IrTransUnit>(ast_builder.build(root_node));
+        if (stats) {
+            stats->cstNodes += ast_builder.getVisitedNodes();
+        }
+    }
+    if (unit == nullptr) {
+        ts_tree_delete(tree);
+        return 1;
+    }
+    if (options.verbose) {
+        out << "\n======= AST:\n";
+        unit->printTree(out, 0);
+        out << std::endl;
+    }
+
+    std::vector<const HeaderUnit*> headers = loadHeaders(include_directives(unit), stats);
+    LlPool globalPool;
+    LlBuilder builderGlobal("globalBuilder");
+    SymbolTable symbolTableGlobal("global");
+    {
+        PhaseTimer timer(file_phase(stats, "lower"));
+        TraceScope scope("lower");
+        LlPool::Scope poolScope(globalPool);
+        import_headers(headers, builderGlobal, symbolTableGlobal);
+        unit->lowerGlobals(builderGlobal, symbolTableGlobal);
+    }
+
+    if (options.intermedial) {
+        PhaseTimer timer(file_phase(stats, "output"));
+        TraceScope scope("output");
+        out << "\n=======IR:\n" << std::endl;
+        builderGlobal.print(out);
+        out << std::endl;
+        symbolTableGlobal.print(out);
+        out << std::endl;
+    }
+    if (options.cfg) {
+        LlPool::Scope poolScope(globalPool);
+        CFGBuilder cfgBuilder;
+        CFG* cfg;
+        {
+            PhaseTimer timer(file_phase(stats, "cfg"));
+            TraceScope scope("build cfg", Trace::isEnabled() ? builderGlobal.getName() : std::string());
+            cfg = cfgBuilder.buildCFG(builderGlobal);
+        }
+        PhaseTimer timer(file_phase(stats, "output"));
+        TraceScope scope("output");
+        cfg->writeDot(sink.beginArtifact("cfg0.dot"));
+        sink.endArtifact();
+        if (stats) {
+            stats->blocks += cfg->getBlocksList().size();
+        }
+        delete cfg;
+    }
+    if (stats) {
+        stats->statements += builderGlobal.size();
+    }
+
+    SSAGenerator ssaGenerator(out);
+    size_t index = 0;
+    std::vector<std::string> found;
+    // setSkipFunctions skipped the definitions at every depth, build each of them here
+    for (const TSNode& child : function_definitions(root_node)) {
+        if (!is_selected(options, child, *source_code)) {
+            continue;
+        }
+        // the function's AST, freed at the end of the iteration
+        IrArena arena;
+        IrFunctionDef* func;
+        {
+            PhaseTimer timer(file_phase(stats, "ast"));
+            TraceScope scope("ast");
+            IrArena::Scope arenaScope(arena);
+            ASTBuilder ast_builder(SourceBuffer::borrow(source_code->view()), language, options.verbose);
+            ast_builder.setTraceStream(out);
+            func = dyn_cast<IrFunctionDef>(ast_builder.build(child));
+            if (stats) {
+                stats->cstNodes += ast_builder.getVisitedNodes();
+            }
+        }
+        if (func == nullptr) {
+            // it takes no number, so cfg<N>.dot names the same function as on the other paths
+            std::cerr << "Error: cannot build the AST of the function at row " << ts_node_start_point(child).row + 1
+                      << ", skipping it" << std::endl;
+            continue;
+        }
+        index++;
+        FunctionStats* functionStats = nullptr;
+        if (stats) {
+            stats->functions.emplace_back();
+            functionStats = &stats->functions.back();
+        }
+        std::string name = func->getFunctionDecl()->getName();
+        found.push_back(name);
+        if (functionStats) {
+            functionStats->name = name;
+        }
+        if (options.verbose) {
+            out << "\n======= AST:\n";
+            func->printTree(out, 0);
+            out << std::endl;
+        }
+
+        // everything lowered from this function lives in the pool, freed at the end of the iteration
+        LlPool pool;
+        LlPool::Scope poolScope(pool);
+        LlBuilder builder(func->getFunctionName());
+        SymbolTable symbolTable(func->getFunctionName(), &symbolTableGlobal);
+        FunctionBudget budget(options.functionBudget);
+        {
+            PhaseTimer timer(file_phase(stats, "lower"));
+            PhaseTimer functionTimer(functionStats ? functionStats->phase("lower") : nullptr);
+            TraceScope scope("lower function", name);
+            FunctionBudget::Charge charge(budget);
+            unit->lowerFunction(func, builder, symbolTable, options.recordBlocks);
+        }
+
+        if (options.intermedial) {
+            PhaseTimer timer(file_phase(stats, "output"));
+            TraceScope scope("output");
+            builder.print(out);
+            out << std::endl;
+            symbolTable.print(out);
+            out << std::endl;
+        }
+
+        CFG* cfg = nullptr;
+        if (options.cfg && budget.exceeded()) {
+            degrade(out, builder.getName(), Degradation::Skipped, functionStats);
+        } else if (options.cfg) {
+            CFGBuilder cfgBuilder;
+            {
+                PhaseTimer timer(file_phase(stats, "cfg"));
+                PhaseTimer functionTimer(functionStats ? functionStats->phase("cfg") : nullptr);
+                TraceScope scope("build cfg", name);
+                FunctionBudget::Charge charge(budget);
+                cfg = cfgBuilder.buildCFG(builder);
+            }
+            PhaseTimer timer(file_phase(stats, "output"));
+            TraceScope scope("output");
+            cfg->writeDot(sink.beginArtifact("cfg" + to_string(index) + ".dot"));
+            sink.endArtifact();
+        }
+
+        if (options.ssa && cfg) {
+            bool ssaDone = false;
+            if (!budget.exceeded()) {
+                PhaseTimer timer(file_phase(stats, "ssa"));
+                PhaseTimer functionTimer(functionStats ? functionStats->phase("ssa") : nullptr);
+                TraceScope scope("convert to ssa", name);
+                FunctionBudget::Charge charge(budget);
+                ssaGenerator.setDeadline(budget.deadline());
+                ssaDone = ssaGenerator.convertToSSA(cfg);
+            }
+            if (ssaDone) {
+                PhaseTimer timer(file_phase(stats, "output"));
+                TraceScope scope("output");
+                cfg->writeDot(sink.beginArtifact("cfg_ssa" + to_string(index) + ".dot"));
+                sink.endArtifact();
+            } else {
+                degrade(out, builder.getName(), Degradation::CfgOnly, functionStats);
+            }
+        }
+
+        if (functionStats) {
+            functionStats->statements = builder.size();
+            functionStats->blocks = cfg ? cfg->getBlocksList().size() : 0;
+            functionStats->phis = cfg ? count_phis(cfg) : 0;
+            stats->statements += functionStats->statements;
+            stats->blocks += functionStats->blocks;
+            stats->phis += functionStats->phis;
+        }
+
+        delete cfg;
+    }
+    if (!options.functions.empty()) {
+        report_missing_functions(options.functions, found);
+    }
+
+    if (options.intermedial) {
+        out << std::endl;
+    }
+    if (options.verbose) {
+        out << "\n======== Src:" << std::endl;
+        out << source_code->view() << std::endl;
+    }
+
+    if (options.noTeardown) {
+        globalArena.abandon();
+        globalPool.abandon();
+    }
+    ts_tree_delete(tree);
+    delete source_code;
+    return 0;
+}
+
+// Everything a run can print for one builder, in the same layout as the uncached path.
+// A function over its budget gets a "degraded" entry instead of the parts it skipped.
+static CacheEntry render_builder(LlBuilder& builder, SymbolTable& symbolTable, bool ssa, FunctionBudget& budget) {
+    CacheEntry entry;
+    std::ostringstream ir;
+    builder.print(ir);
+    ir << "\n";
+    symbolTable.print(ir);
+    ir << "\n";
+    entry["ir"] = ir.str();
+    entry["statements"] = to_string(builder.size());
+    if (budget.exceeded()) {
+        entry["name"] = builder.getName();
+        entry["degraded"] = degradation_name(Degradation::Skipped);
+        return entry;
+    }
+
+    CFGBuilder cfgBuilder;
+    CFG* cfg;
+    {
+        FunctionBudget::Charge charge(budget);
+        cfg = cfgBuilder.buildCFG(builder);
+    }
+    entry["cfg"] = cfg->generateDotFile();
+    entry["blocks"] = to_string(cfg->getBlocksList().size());
+    if (ssa) {
+        std::ostringstream log;
+        SSAGenerator ssaGenerator(log);
+        bool ssaDone = false;
+        if (!budget.exceeded()) {
+            FunctionBudget::Charge charge(budget);
+            ssaGenerator.setDeadline(budget.deadline());
+            ssaDone = ssaGenerator.convertToSSA(cfg);
+        }
+        if (ssaDone) {
+            entry["ssalog"] = log.str();
+            entry["ssa"] = cfg->generateDotFile();
+            entry["phis"] = to_string(count_phis(cfg));
+        } else {
+            entry["name"] = builder.getName();
+            entry["degraded"] = degradation_name(Degradation::CfgOnly);
+        }
+    }
+    delete cfg;
+    return entry;
+}
+
+// a count render_builder stored, 0 if the entry has none
+static size_t entry_count(const CacheEntry& entry, const char* key) {
+    auto it = entry.find(key);
+    return it == entry.end() ? 0 : std::strtoul(it->second.c_str(), nullptr, 10);
+}
+
+// the statistics of cached results, whose phases did not run in this process
+static void cached_stats(const CacheEntry& globals, const std::vector<CacheEntry>& functions, FileStats* stats) {
+    stats->statements += entry_count(globals, "statements");
+    for (const CacheEntry& function : functions) {
+        stats->functions.emplace_back();
+        FunctionStats& functionStats = stats->functions.back();
+        auto name = function.find("function");
+        functionStats.name = name == function.end() ? std::string() : name->second;
+        functionStats.statements = entry_count(function, "statements");
+        functionStats.blocks = entry_count(function, "blocks");
+        functionStats.phis = entry_count(function, "phis");
+        auto degraded = function.find("degraded");
+        if (degraded != function.end()) {
+            functionStats.degraded = degraded->second;
+        }
+        stats->statements += functionStats.statements;
+        stats->blocks += functionStats.blocks;
+        stats->phis += functionStats.phis;
+    }
+}
+
+static void write_artifact(OutputSink& sink, const std::string& name, const std::string& text) {
+    sink.beginArtifact(name) << text;
+    sink.endArtifact();
+}
+
+void Driver::emitCached(CacheEntry& globals, std::vector<CacheEntry>& functions, OutputSink& sink) {
+    std::ostream& out = sink.text();
+    if (options.intermedial) {
+        out << "\n=======IR:\n" << std::endl;
+        out << globals["ir"];
+        for (CacheEntry& function : functions) {
+            out << function["ir"];
+        }
+        out << std::endl;
+    }
+
+    if (options.cfg) {
+        write_artifact(sink, "cfg0.dot", globals["cfg"]);
+        for (size_t i = 0; i < functions.size(); i++) {
+            if (functions[i].count("degraded")) {
+                bool skipped = functions[i]["degraded"] == degradation_name(Degradation::Skipped);
+                degrade(out, functions[i]["name"], skipped ? Degradation::Skipped : Degradation::CfgOnly, nullptr);
+            }
+            if (functions[i].count("cfg")) {
+                write_artifact(sink, "cfg" + to_string(i + 1) + ".dot", functions[i]["cfg"]);
+            }
+        }
+
+        if (options.ssa) {
+            for (size_t i = 0; i < functions.size(); i++) {
+                if (functions[i].count("ssa")) {
+                    out << functions[i]["ssalog"];
+                    write_artifact(sink, "cfg_ssa" + to_string(i + 1) + ".dot", functions[i]["ssa"]);
+                }
+            }
+        }
+    }
+}
+
+// Same outputs as analyzeSource, but lowering, CFG and SSA results are looked up in
+// the cache first. Globals are keyed by the text of every top-level declaration
+// that is not a function definition; a function by its own text chained onto that
+// key. An unchanged file is found by its whole-text hash without parsing at all.
+int Driver::analyzeCached(SourceBuffer* source_code, OutputSink& sink, FileStats* stats) {
+    uint64_t fileKey = ArtifactCache::hash(source_code->view());
+    // other -I directories may resolve the same #include to another header,
+    // and another --functions selection lists other functions
+    for (const std::string& dir : options.includePaths) {
+        fileKey = ArtifactCache::hash(dir + "\n", fileKey);
+    }
+    for (const std::string& name : options.functions) {
+        fileKey = ArtifactCache::hash("function " + name + "\n", fileKey);
+    }
+    CacheEntry globals;
+    std::vector<CacheEntry> functions;   // in source order, like the builders
+
+    CacheEntry manifest;
+    bool reused = false;
+    if (!options.outputCst && cache->load(fileKey, "tu", manifest)) {
+        PhaseTimer timer(file_phase(stats, "cache"));
+        TraceScope scope("cache");
+        uint64_t globalKey;
+        // the unit's own text is unchanged, but a header it includes may not be
+        reused = headers_unchanged(manifest["headers"]) &&
+                 ArtifactCache::fromHex(manifest["globals"], globalKey) && cache->load(globalKey, "globals", globals);
+        std::istringstream keys(manifest["functions"]);
+        std::string hex;
+        while (reused && keys >> hex) {
+            uint64_t functionKey;
+            functions.emplace_back();
+            reused = ArtifactCache::fromHex(hex, functionKey) && cache->load(functionKey, "fn", functions.back());
+        }
+    }
+
+    if (!reused) {
+        TSTree *tree = parse(source_code, stats);
+        if (tree == nullptr) {
+            delete source_code;
+            return 1;
+        }
+        if (options.outputCst) {
+            write_cst(sink, tree, stats);
+        }
+        TSNode root_node = ts_tree_root_node(tree);
+
+        std::string globalText;
+        std::vector<TSNode> functionNodes;
+        std::vector<IncludeDirective> includes;
+        // a cursor over the top-level items, ts_node_named_child(root_node, i) would rescan the ones before i
+        TSTreeCursor cursor = ts_tree_cursor_new(root_node);
+        for (bool more = ts_tree_cursor_goto_first_child(&cursor); more; more = ts_tree_cursor_goto_next_sibling(&cursor)) {
+            TSNode child = ts_tree_cursor_current_node(&cursor);
+            if (!ts_node_is_named(child)) {
+                continue;
+            }
+            IncludeDirective include;
+            if (is_function_definition(child)) {
+                if (is_selected(options, child, *source_code)) {
+                    functionNodes.push_back(child);
+                }
+            } else if (std::strcmp(ts_node_type(child), "comment") != 0) {
+                globalText += source_code->slice(ts_node_start_byte(child), ts_node_end_byte(child));
+                globalText += '\n';
+            }
+            if (include_directive(child, source_code, include)) {
+                includes.push_back(include);
+            }
+        }
+        ts_tree_cursor_delete(&cursor);
+        if (!options.functions.empty()) {
+            std::vector<std::string> found;
+            for (const TSNode& node : functionNodes) {
+                found.push_back(std::string(function_definition_name(node, *source_code)));
+            }
+            report_missing_functions(options.functions, found);
+        }
+        // what the headers declare feeds the globals, and through them every function
+        std::vector<const HeaderUnit*> headers = loadHeaders(includes, stats);
+        uint64_t globalKey = hash_headers(headers, ArtifactCache::hash(globalText));
+        std::vector<uint64_t> functionKeys;
+        for (const TSNode& node : functionNodes) {
+            functionKeys.push_back(ArtifactCache::hash(source_code->slice(ts_node_start_byte(node), ts_node_end_byte(node)), globalKey));
+        }
+
+        bool complete;
+        std::vector<bool> hits;
+        {
+            PhaseTimer timer(file_phase(stats, "cache"));
+            TraceScope scope("cache");
+            complete = cache->load(globalKey, "globals", globals);
+            functions.assign(functionNodes.size(), CacheEntry());
+            for (size_t i = 0; i < functionNodes.size(); i++) {
+                hits.push_back(cache->load(functionKeys[i], "fn", functions[i]));
+                complete = complete && hits.back();
+            }
+        }
+
+        if (!complete) {
+            IrArena arena;
+            IrArena::Scope arenaScope(arena);
+            ASTBuilder ast_builder(SourceBuffer::borrow(source_code->view()), language, options.verbose);
+            ast_builder.setTraceStream(sink.text());
+            ast_builder.setThreads(options.astThreads);
+            if (!options.functions.empty()) {
+                ast_builder.setFunctionFilter(options.functions);
+            }
+            IrTransUnit* unit;
+            {
+                PhaseTimer timer(file_phase(stats, "ast"));
+                TraceScope scope("ast");
+                unit = dyn_cast<IrTransUnit>(ast_builder.build(root_node));
+            }
+            if (stats) {
+                stats->cstNodes += ast_builder.getVisitedNodes();
+            }
+            ts_tree_delete(tree);
+            tree = nullptr;
+            if (unit == nullptr || unit->getFunctionList().size() != functionNodes.size()) {
+                // functions cannot be lined up with their text, analyze without the cache
+                return analyzeSource(source_code, sink, stats);
+            }
+
+            // lowering, CFG and SSA of the cache misses
+            PhaseTimer timer(file_phase(stats, "analyze"));
+            TraceScope scope("analyze");
+            LlPool globalPool;
+            LlBuilder builderGlobal("globalBuilder");
+            SymbolTable symbolTableGlobal("global");
+            {
+                LlPool::Scope poolScope(globalPool);
+                import_headers(headers, builderGlobal, symbolTableGlobal);
+                unit->lowerGlobals(builderGlobal, symbolTableGlobal);
+                if (globals.empty()) {
+                    BudgetLimits unlimited;
+                    FunctionBudget budget(unlimited);
+                    globals = render_builder(builderGlobal, symbolTableGlobal, false, budget);
+                    cache->store(globalKey, "globals", globals);
+                }
+            }
+
+            const std::deque<IrFunctionDef*>& functionList = unit->getFunctionList();
+            for (size_t i = 0; i < functionList.size(); i++) {
+                if (hits[i]) {
+                    continue;
+                }
+                IrFunctionDef* func = functionList[i];
+                LlPool pool;
+                LlPool::Scope poolScope(pool);
+                LlBuilder builder(func->getFunctionName());
+                SymbolTable symbolTable(func->getFunctionName(), &symbolTableGlobal);
+                FunctionBudget budget(options.functionBudget);
+                {
+                    FunctionBudget::Charge charge(budget);
+                    unit->lowerFunction(func, builder, symbolTable, options.recordBlocks);
+                }
+                functions[i] = render_builder(builder, symbolTable, true, budget);
+                functions[i]["function"] = func->getFunctionDecl()->getName();
+                // a degraded result says more about this machine's load than about the code
+                if (!functions[i].count("degraded")) {
+                    cache->store(functionKeys[i], "fn", functions[i]);
+                }
+            }
+        }
+        ts_tree_delete(tree);
+
+        std::string keys;
+        for (uint64_t functionKey : functionKeys) {
+            keys += ArtifactCache::toHex(functionKey) + " ";
+        }
+        manifest.clear();
+        manifest["globals"] = ArtifactCache::toHex(globalKey);
+        manifest["functions"] = keys;
+        manifest["headers"] = header_manifest(headers);
+        cache->store(fileKey, "tu", manifest);
+    }
+
+    if (stats) {
+        cached_stats(globals, functions, stats);
+    }
+    {
+        PhaseTimer timer(file_phase(stats, "output"));
+        TraceScope scope("output");
+        emitCached(globals, functions, sink);
+    }
+
+    delete source_code;
+    return 0;
+}
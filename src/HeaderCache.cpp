@@ -0,0 +1,173 @@
+#include <iostream>
+#include <filesystem>
+#include <unordered_set>
+#include "HeaderCache.h"
+#include "ASTBuilder.h"
+#include "ArtifactCache.h"
+#include "Trace.h"
+#include "utils.h"
+
+namespace fs = std::filesystem;
+
+extern "C" const TSLanguage *tree_sitter_c();
+
+std::vector<IncludeDirective> include_directives(const IrTransUnit* unit) {
+    std::vector<IncludeDirective> includes;
+    const std::vector<IrPreprocInclude*>& list = unit->getPreprocIncludeList();
+    for (auto it = list.rbegin(); it != list.rend(); ++it) {
+        includes.push_back({(*it)->getHeaderName(), (*it)->isSystem()});
+    }
+    return includes;
+}
+
+HeaderCache::~HeaderCache() {
+    if (parser) {
+        ts_parser_delete(parser);
+    }
+}
+
+HeaderCache& HeaderCache::global() {
+    static HeaderCache cache;
+    return cache;
+}
+
+std::string HeaderCache::resolve(std::string_view name, bool system, const std::string& includingDir,
+                                 const std::vector<std::string>& searchPaths) {
+    std::error_code ec;
+    fs::path header{std::string(name)};
+    if (header.is_absolute()) {
+        return fs::is_regular_file(header, ec) ? header.lexically_normal().string() : std::string();
+    }
+
+    std::vector<fs::path> candidates;
+    if (!system) {
+        candidates.push_back(fs::path(includingDir) / header);
+    }
+    for (const std::string& dir : searchPaths) {
+        candidates.push_back(fs::path(dir) / header);
+    }
+    for (const fs::path& candidate : candidates) {
+        if (fs::is_regular_file(candidate, ec)) {
+            return candidate.lexically_normal().string();
+        }
+    }
+    return std::string();
+}
+
+const HeaderUnit* HeaderCache::load(const std::string& path, const std::vector<std::string>& searchPaths) {
+    std::lock_guard<std::recursive_mutex> guard(lock);
+    if (loading.count(path)) {
+        std::cerr << "Warning: " << path << " includes itself, the nested #include is skipped" << std::endl;
+        return nullptr;
+    }
+
+    std::unique_ptr<SourceBuffer> source(read_file(path));
+    if (source == nullptr) {
+        return nullptr;
+    }
+    std::pair<std::string, uint64_t> key(path, ArtifactCache::hash(source->view()));
+    auto it = headers.find(key);
+    if (it != headers.end()) {
+        return it->second.get();
+    }
+
+    TraceScope scope("parse header", path);
+    std::unique_ptr<HeaderUnit> header(new HeaderUnit(path));
+    header->hash = key.second;
+    header->source = std::move(source);
+    if (parser == nullptr) {
+        parser = ts_parser_new();
+        ts_parser_set_language(parser, tree_sitter_c());
+    }
+    TSTree* tree = ts_parser_parse_string(parser, nullptr, header->source->data(), header->source->size());
+    {
+        IrArena::Scope arenaScope(header->arena);
+        ASTBuilder astBuilder(SourceBuffer::borrow(header->source->view()), tree_sitter_c());
+        header->unit = dyn_cast<IrTransUnit>(astBuilder.build(ts_tree_root_node(tree)));
+    }
+    ts_tree_delete(tree);
+    if (header->unit == nullptr) {
+        std::cerr << "Error: cannot build the AST of header " << path << std::endl;
+        return nullptr;
+    }
+
+    loading.insert(path);
+    header->includes = loadIncludes(include_directives(header->unit), fs::path(path).parent_path().string(), searchPaths);
+    loading.erase(path);
+
+    // typedefs of the included headers are visible while lowering this one
+    for (const HeaderUnit* include : header->includes) {
+        header->symbolTable.importFrom(include->symbolTable);
+        for (const auto& entry : include->macros) {
+            define_macro(header->macros, entry.second);
+        }
+    }
+    MacroExpander::collectDefinitions(header->source->view(), header->macros);
+    {
+        IrArena::Scope arenaScope(header->arena);
+        LlPool::Scope poolScope(header->pool);
+        header->unit->lowerGlobals(header->builder, header->symbolTable);
+    }
+
+    const HeaderUnit* result = header.get();
+    headers[key] = std::move(header);
+    return result;
+}
+
+std::vector<const HeaderUnit*> HeaderCache::loadIncludes(const std::vector<IncludeDirective>& includes, const std::string& includingDir,
+                                                         const std::vector<std::string>& searchPaths) {
+    std::vector<const HeaderUnit*> headerUnits;
+    for (const IncludeDirective& include : includes) {
+        std::string path = resolve(include.name, include.system, includingDir, searchPaths);
+        if (path.empty()) {
+            if (!include.system) {
+                std::cerr << "Warning: header \"" << include.name << "\" not found" << std::endl;
+            }
+            continue;
+        }
+        if (const HeaderUnit* header = load(path, searchPaths)) {
+            headerUnits.push_back(header);
+        }
+    }
+    return headerUnits;
+}
+
+size_t HeaderCache::size() {
+    std::lock_guard<std::recursive_mutex> guard(lock);
+    return headers.size();
+}
+
+static void collect_headers(const HeaderUnit* header, std::unordered_set<const HeaderUnit*>& seen, std::vector<const HeaderUnit*>& closure) {
+    if (!seen.insert(header).second) {
+        return;
+    }
+    for (const HeaderUnit* include : header->includes) {
+        collect_headers(include, seen, closure);
+    }
+    closure.push_back(header);
+}
+
+std::vector<const HeaderUnit*> include_closure(const std::vector<const HeaderUnit*>& headers) {
+    std::unordered_set<const HeaderUnit*> seen;
+    std::vector<const HeaderUnit*> closure;
+    for (const HeaderUnit* header : headers) {
+        collect_headers(header, seen, closure);
+    }
+    return closure;
+}
+
+void import_headers(const std::vector<const HeaderUnit*>& headers, LlBuilder& builder, SymbolTable& symbolTable) {
+    // global code has no jumps, so the statements can be relabelled for this unit
+    for (const HeaderUnit* header : include_closure(headers)) {
+        builder.appendStatements(header->builder);
+        symbolTable.importFrom(header->symbolTable);
+    }
+}
+
+uint64_t hash_headers(const std::vector<const HeaderUnit*>& headers, uint64_t seed) {
+    for (const HeaderUnit* header : include_closure(headers)) {
+        seed = ArtifactCache::hash(header->path, seed);
+        seed = ArtifactCache::hash(ArtifactCache::toHex(header->hash), seed);
+    }
+    return seed;
+}
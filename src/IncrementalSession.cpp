@@ -0,0 +1,287 @@
+#include <iostream>
+#include <sstream>
+#include <cstring>
+#include <cstdlib>
+#include <utility>
+#include "IncrementalSession.h"
+#include "ASTBuilder.h"
+#include "SourceBuffer.h"
+
+// Include the C parser header
+extern "C" const TSLanguage *tree_sitter_c();
+
+typedef std::vector<std::pair<uint32_t, uint32_t>> ByteRanges;
+
+static bool is_function_definition(const TSNode& node) {
+    return std::strcmp(ts_node_type(node), "function_definition") == 0;
+}
+
+// the named top-level items, in one cursor pass; ts_node_named_child(root, i) would
+// rescan the items before i on every call
+static std::vector<TSNode> top_level_items(const TSNode& root) {
+    std::vector<TSNode> items;
+    TSTreeCursor cursor = ts_tree_cursor_new(root);
+    for (bool more = ts_tree_cursor_goto_first_child(&cursor); more; more = ts_tree_cursor_goto_next_sibling(&cursor)) {
+        TSNode child = ts_tree_cursor_current_node(&cursor);
+        if (ts_node_is_named(child)) {
+            items.push_back(child);
+        }
+    }
+    ts_tree_cursor_delete(&cursor);
+    return items;
+}
+
+// row/column of a byte offset, as tree-sitter counts them
+static TSPoint point_at(const std::string& text, uint32_t byte) {
+    TSPoint point = {0, 0};
+    const char* lineStart = text.data();
+    const char* end = text.data() + byte;
+    while (const char* newline = static_cast<const char*>(std::memchr(lineStart, '\n', end - lineStart))) {
+        point.row++;
+        lineStart = newline + 1;
+    }
+    point.column = static_cast<uint32_t>(end - lineStart);
+    return point;
+}
+
+// empty ranges (pure deletions) count as touching the nodes on both sides
+static bool overlaps(uint32_t start, uint32_t end, const ByteRanges& ranges) {
+    for (const auto& range : ranges) {
+        if (range.first == range.second ? (start <= range.first && range.first <= end)
+                                        : (range.first < end && start < range.second)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+IncrementalSession::IncrementalSession() {
+    parser = ts_parser_new();
+    language = tree_sitter_c();
+    ts_parser_set_language(parser, language);
+}
+
+IncrementalSession::~IncrementalSession() {
+    releaseUnit();
+    if (tree) {
+        ts_tree_delete(tree);
+    }
+    ts_parser_delete(parser);
+}
+
+void IncrementalSession::releaseFunction(Function& function) {
+    delete function.cfg;
+    delete function.symbolTable;
+    delete function.builder;
+    delete function.pool;
+    delete function.arena;
+    function.cfg = nullptr;
+    function.symbolTable = nullptr;
+    function.builder = nullptr;
+    function.pool = nullptr;
+    function.arena = nullptr;
+}
+
+void IncrementalSession::releaseUnit() {
+    for (Function& function : functions) {
+        releaseFunction(function);
+    }
+    functions.clear();
+    delete globalTable;
+    globalTable = nullptr;
+    delete globalBuilder;
+    globalBuilder = nullptr;
+    delete globalPool;
+    globalPool = nullptr;
+    delete unitArena;
+    unitArena = nullptr;
+    unit = nullptr;
+    mapped = false;
+}
+
+void IncrementalSession::finishFunction(size_t index) {
+    Function& function = functions[index];
+    IrFunctionDef* def = function.def;
+    function.name = def->getFunctionDecl()->getName();
+    TraceScope scope("rebuild function", function.name);
+    function.pool = new LlPool();
+    LlPool::Scope poolScope(*function.pool);
+    function.builder = new LlBuilder(def->getFunctionName());
+    function.symbolTable = new SymbolTable(def->getFunctionName(), globalTable);
+    unit->lowerFunction(def, *function.builder, *function.symbolTable);
+
+    CFGBuilder cfgBuilder;
+    function.cfg = cfgBuilder.buildCFG(*function.builder);
+    if (cfgHook) {
+        cfgHook(index, function);
+    }
+
+    // the dominator dumps are only useful on the command line
+    std::ostringstream discard;
+    SSAGenerator ssaGenerator(discard);
+    ssaGenerator.convertToSSA(function.cfg);
+
+    rebuilt.push_back(index);
+}
+
+bool IncrementalSession::rebuildAll() {
+    releaseUnit();
+    rebuilt.clear();
+
+    TSNode root = ts_tree_root_node(tree);
+    unitArena = new IrArena();
+    IrArena::Scope arenaScope(*unitArena);
+    ASTBuilder astBuilder(SourceBuffer::borrow(text), language);
+    unit = dyn_cast<IrTransUnit>(astBuilder.build(root));
+    if (unit == nullptr) {
+        return false;
+    }
+
+    globalPool = new LlPool();
+    LlPool::Scope poolScope(*globalPool);
+    globalBuilder = new LlBuilder("globalBuilder");
+    globalTable = new SymbolTable("global");
+    unit->lowerGlobals(*globalBuilder, *globalTable);
+
+    std::vector<TSNode> functionNodes;
+    for (const TSNode& child : top_level_items(root)) {
+        if (is_function_definition(child)) {
+            functionNodes.push_back(child);
+        }
+    }
+
+    const std::deque<IrFunctionDef*>& functionList = unit->getFunctionList();
+    mapped = functionNodes.size() == functionList.size();
+    functions.resize(functionList.size());
+    for (size_t i = 0; i < functions.size(); i++) {
+        functions[i].def = functionList[i];
+        if (mapped) {
+            functions[i].startByte = ts_node_start_byte(functionNodes[i]);
+            functions[i].endByte = ts_node_end_byte(functionNodes[i]);
+        }
+        finishFunction(i);
+    }
+    return true;
+}
+
+bool IncrementalSession::rebuildFunction(size_t index, const TSNode& node) {
+    IrArena* arena = new IrArena();
+    IrFunctionDef* def;
+    {
+        IrArena::Scope arenaScope(*arena);
+        ASTBuilder astBuilder(SourceBuffer::borrow(text), language);
+        def = dyn_cast<IrFunctionDef>(astBuilder.build(node));
+    }
+    if (def == nullptr) {
+        delete arena;
+        return false;
+    }
+
+    // the old definition goes with its arena, or stays in the unit's until the next full rebuild;
+    // the unit finds it by address, so it is swapped out before its arena is freed
+    Function& function = functions[index];
+    unit->replaceFunction(function.def, def);
+    releaseFunction(function);
+    function.def = def;
+    function.arena = arena;
+    finishFunction(index);
+    return true;
+}
+
+bool IncrementalSession::open(std::string source) {
+    text = std::move(source);
+    if (tree) {
+        ts_tree_delete(tree);
+    }
+    tree = ts_parser_parse_string(parser, nullptr, text.data(), text.size());
+    return rebuildAll();
+}
+
+bool IncrementalSession::applyEdit(uint32_t startByte, uint32_t oldEndByte, const std::string& replacement) {
+    if (tree == nullptr) {
+        std::cerr << "Error: applyEdit called before open" << std::endl;
+        return false;
+    }
+    if (startByte > oldEndByte || oldEndByte > text.size()) {
+        std::cerr << "Error: edit range [" << startByte << ", " << oldEndByte << ") is outside the source" << std::endl;
+        return false;
+    }
+
+    TSInputEdit edit;
+    edit.start_byte = startByte;
+    edit.old_end_byte = oldEndByte;
+    edit.new_end_byte = startByte + static_cast<uint32_t>(replacement.size());
+    edit.start_point = point_at(text, startByte);
+    edit.old_end_point = point_at(text, oldEndByte);
+    text.replace(startByte, oldEndByte - startByte, replacement);
+    edit.new_end_point = point_at(text, edit.new_end_byte);
+
+    ts_tree_edit(tree, &edit);
+    TSTree* newTree = ts_parser_parse_string(parser, tree, text.data(), text.size());
+
+    uint32_t rangeCount = 0;
+    TSRange* ranges = ts_tree_get_changed_ranges(tree, newTree, &rangeCount);
+    ByteRanges changed;
+    for (uint32_t i = 0; i < rangeCount; i++) {
+        changed.emplace_back(ranges[i].start_byte, ranges[i].end_byte);
+    }
+    std::free(ranges);
+    // edits that keep the tree's shape (renaming a variable, changing a constant)
+    // report no changed range, the edited bytes themselves always count
+    changed.emplace_back(edit.start_byte, edit.new_end_byte);
+
+    ts_tree_delete(tree);
+    tree = newTree;
+    rebuilt.clear();
+
+    if (!mapped) {
+        return rebuildAll();
+    }
+
+    TSNode root = ts_tree_root_node(tree);
+    std::vector<TSNode> functionNodes;
+    std::vector<bool> touched;
+    for (const TSNode& child : top_level_items(root)) {
+        bool hit = overlaps(ts_node_start_byte(child), ts_node_end_byte(child), changed);
+        if (is_function_definition(child)) {
+            functionNodes.push_back(child);
+            touched.push_back(hit);
+        } else if (hit && std::strcmp(ts_node_type(child), "comment") != 0) {
+            // globals, typedefs and macros are visible to every function
+            return rebuildAll();
+        }
+    }
+    if (functionNodes.size() != functions.size()) {
+        return rebuildAll();
+    }
+
+    for (size_t i = 0; i < functions.size(); i++) {
+        functions[i].startByte = ts_node_start_byte(functionNodes[i]);
+        functions[i].endByte = ts_node_end_byte(functionNodes[i]);
+        if (touched[i] && !rebuildFunction(i, functionNodes[i])) {
+            return rebuildAll();
+        }
+    }
+    return true;
+}
+
+bool IncrementalSession::update(const std::string& source) {
+    if (tree == nullptr) {
+        return open(source);
+    }
+    size_t limit = std::min(text.size(), source.size());
+    size_t prefix = 0;
+    while (prefix < limit && text[prefix] == source[prefix]) {
+        prefix++;
+    }
+    size_t suffix = 0;
+    while (suffix < limit - prefix && text[text.size() - 1 - suffix] == source[source.size() - 1 - suffix]) {
+        suffix++;
+    }
+
+    if (prefix == text.size() && prefix == source.size()) {
+        rebuilt.clear();
+        return true;
+    }
+    return applyEdit(prefix, text.size() - suffix, source.substr(prefix, source.size() - suffix - prefix));
+}
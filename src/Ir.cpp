@@ -5,26 +5,19 @@
 #include "Ir.h"
 
 
-std::string IrTypeArray::prettyPrint(std::string indentSpace) const {
-    std::string prettyString = indentSpace + "|--type: array\n";
-    prettyString += baseType->prettyPrint(addIndent(indentSpace));
+void IrTypeArray::printTree(std::ostream& out, int depth) const {
+    out << indent(depth) << "|--type: array\n";
+    baseType->printTree(out, depth + 1);
     for (auto* dim : dimension) {
-    prettyString += dim->prettyPrint(addIndent(indentSpace));
+    dim->printTree(out, depth + 1);
     }
-    return prettyString;
 }
 
-std::string IrTypeArray::toString() const{
-    std::string str = baseType->toString();
+void IrTypeArray::print(std::ostream& out) const {
+    out << *baseType;
     for (auto* dim : dimension) {
-        str += "[" + dim->toString() + "]";
+        out << "[" << *dim << "]";
     }
-    return str;
 }
 
-IrTypeArray::~IrTypeArray() {
-    delete baseType;
-    for (auto* dim : dimension) {
-        delete dim;
-    }
-}
\ No newline at end of file
+IrTypeArray::~IrTypeArray() = default;
\ No newline at end of file
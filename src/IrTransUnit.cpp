@@ -8,24 +8,9 @@ LlBuildersList* IrTransUnit::getLlBuilder() {
     LlBuilder* builderGlobal = new LlBuilder(("globalBuilder"));
 
     SymbolTable* symbolTableGlobal = new SymbolTable("global");
-    
-    for(IrTypeDef* typeDef: this->typeDefList){
-        typeDef->generateLlIr(*builderGlobal, *symbolTableGlobal);
-    }
 
-    for(IrExprStmt* exprStmt: this->exprStmtList){
-        exprStmt->generateLlIr(*builderGlobal, *symbolTableGlobal);
-    }
+    lowerGlobals(*builderGlobal, *symbolTableGlobal);
 
-    // JWPersonal Note: we may delete this IrDecl loop as for different types of declarations 
-    // we may need to handle it in different ways later
-    for (IrDecl* decl: this->declerationList) {
-        // Not all declarations are global
-        if(auto* func = dynamic_cast<IrFunctionDef*>(decl)){
-            continue;
-        }
-        decl->generateLlIr(*builderGlobal, *symbolTableGlobal);
-    }
     // Add global builder and symbol table to the list
     llBuildersList->addBuilder(builderGlobal);
     llBuildersList->addSymbolTable(symbolTableGlobal);
@@ -38,18 +23,43 @@ LlBuildersList* IrTransUnit::getLlBuilder() {
 
         // Create a symbol table for the function, with the global symbol table as its parent
         SymbolTable* symbolTable = new SymbolTable(func->getFunctionName(), symbolTableGlobal);
-        for (IrParamDecl* p: func->getFunctionDecl()->getParamsList()->getParamsList()) {
-            if (p->getDeclarator() != nullptr) {
-                std::string name = p->getDeclarator()->getName();
-                builder->addParam(new LlLocationVar(&name));
-            }
-        }
-        // Generate LL IR for the function
-        func->generateLlIr(*builder, *symbolTable);
-        
+
+        lowerFunction(func, *builder, *symbolTable);
+
         llBuildersList->addBuilder(builder);
         llBuildersList->addSymbolTable(symbolTable);
     }
 
     return llBuildersList;
-}
\ No newline at end of file
+}
+
+void IrTransUnit::lowerGlobals(LlBuilder& builderGlobal, SymbolTable& symbolTableGlobal) {
+    for(IrTypeDef* typeDef: this->typeDefList){
+        typeDef->generateLlIr(builderGlobal, symbolTableGlobal);
+    }
+
+    for(IrExprStmt* exprStmt: this->exprStmtList){
+        exprStmt->generateLlIr(builderGlobal, symbolTableGlobal);
+    }
+
+    // JWPersonal Note: we may delete this IrDecl loop as for different types of declarations 
+    // we may need to handle it in different ways later
+    for (IrDecl* decl: this->declerationList) {
+        // Not all declarations are global
+        if(isa<IrFunctionDef>(decl)){
+            continue;
+        }
+        decl->generateLlIr(builderGlobal, symbolTableGlobal);
+    }
+}
+
+void IrTransUnit::lowerFunction(IrFunctionDef* func, LlBuilder& builder, SymbolTable& symbolTable, bool recordBlocks) {
+    builder.setBuildBlocks(recordBlocks);
+    for (IrParamDecl* p: func->getFunctionDecl()->getParamsList()->getParamsList()) {
+        if (p->getDeclarator() != nullptr) {
+            builder.addParam(new LlLocationVar(new std::string(p->getDeclarator()->getName())));
+        }
+    }
+    // Generate LL IR for the function
+    func->generateLlIr(builder, symbolTable);
+}
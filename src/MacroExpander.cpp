@@ -0,0 +1,565 @@
+#include <iostream>
+#include <cctype>
+#include <cstring>
+#include <algorithm>
+#include "MacroExpander.h"
+#include "ArtifactCache.h"
+
+static bool is_ident_start(char c) {
+    return std::isalpha(static_cast<unsigned char>(c)) || c == '_';
+}
+
+static bool is_ident_char(char c) {
+    return std::isalnum(static_cast<unsigned char>(c)) || c == '_';
+}
+
+static bool is_identifier(std::string_view text) {
+    return !text.empty() && is_ident_start(text[0]);
+}
+
+// whether two characters written next to each other could run into one token
+static bool would_merge(char left, char right) {
+    static const char* const operators = "+-*/%<>=!&|^.#:";
+    return (is_ident_char(left) && is_ident_char(right)) ||
+           (std::strchr(operators, left) && std::strchr(operators, right));
+}
+
+// past the closing quote of the string or character literal starting at pos
+static size_t skip_quoted(std::string_view text, size_t pos) {
+    char quote = text[pos++];
+    while (pos < text.size() && text[pos] != quote && text[pos] != '\n') {
+        pos += text[pos] == '\\' ? 2 : 1;
+    }
+    return std::min(pos + 1, text.size());
+}
+
+bool MacroLexer::next(MacroToken& token) {
+    token = MacroToken();
+    token.lineStart = pos == 0;
+    while (pos < text.size()) {
+        char c = text[pos];
+        char next = pos + 1 < text.size() ? text[pos + 1] : '\0';
+        if (c == '\n') {
+            token.lineStart = true;
+            pos++;
+        } else if (c == ' ' || c == '\t' || c == '\r' || c == '\f' || c == '\v') {
+            pos++;
+        } else if (c == '\\' && (next == '\n' || next == '\r')) {
+            pos += next == '\r' && pos + 2 < text.size() && text[pos + 2] == '\n' ? 3 : 2;
+        } else if (c == '/' && next == '/') {
+            pos = std::min(text.find('\n', pos), text.size());
+        } else if (c == '/' && next == '*') {
+            size_t end = text.find("*/", pos + 2);
+            pos = end == std::string_view::npos ? text.size() : end + 2;
+        } else {
+            break;
+        }
+        token.spaceBefore = true;
+    }
+    if (pos >= text.size()) {
+        return false;
+    }
+
+    size_t start = pos;
+    char c = text[pos];
+    if (is_ident_start(c)) {
+        while (pos < text.size() && is_ident_char(text[pos])) {
+            pos++;
+        }
+        // L"...", u8'...' and friends are one token
+        std::string_view prefix = text.substr(start, pos - start);
+        if (pos < text.size() && (text[pos] == '"' || text[pos] == '\'') &&
+            (prefix == "L" || prefix == "u" || prefix == "U" || prefix == "u8")) {
+            pos = skip_quoted(text, pos);
+        }
+    } else if (std::isdigit(static_cast<unsigned char>(c)) ||
+               (c == '.' && pos + 1 < text.size() && std::isdigit(static_cast<unsigned char>(text[pos + 1])))) {
+        // a pp-number, e.g. 0x1fULL or 1.5e+3
+        pos++;
+        while (pos < text.size()) {
+            char d = text[pos];
+            if ((d == '+' || d == '-') && std::strchr("eEpP", text[pos - 1])) {
+                pos++;
+            } else if (is_ident_char(d) || d == '.') {
+                pos++;
+            } else {
+                break;
+            }
+        }
+    } else if (c == '"' || c == '\'') {
+        pos = skip_quoted(text, pos);
+    } else {
+        static const char* const punctuators[] = {"...", "<<=", ">>=", "->", "++", "--", "<<", ">>", "<=", ">=", "==", "!=",
+                                                  "&&", "||", "*=", "/=", "%=", "+=", "-=", "&=", "^=", "|=", "##"};
+        pos++;
+        for (const char* punctuator : punctuators) {
+            size_t length = std::strlen(punctuator);
+            if (text.compare(start, length, punctuator) == 0) {
+                pos = start + length;
+                break;
+            }
+        }
+    }
+    token.text = text.substr(start, pos - start);
+    return true;
+}
+
+std::shared_ptr<const MacroDefinition> MacroDefinition::parse(std::string_view directive) {
+    MacroLexer lexer(directive);
+    MacroToken token;
+    if (!lexer.next(token) || !is_identifier(token.text)) {
+        return nullptr;
+    }
+    std::shared_ptr<MacroDefinition> macro = std::make_shared<MacroDefinition>();
+    macro->name = std::string(token.text);
+
+    // only a "(" right after the name makes the macro function-like
+    size_t bodyStart = lexer.position();
+    if (bodyStart < directive.size() && directive[bodyStart] == '(') {
+        macro->functionLike = true;
+        lexer.next(token);
+        bool closed = false;
+        bool afterParam = false;
+        while (lexer.next(token)) {
+            if (token.text == ")") {
+                closed = true;
+                break;
+            }
+            if (token.text == "...") {
+                // "args..." names the variadic parameter, a bare "..." is __VA_ARGS__
+                macro->variadic = true;
+                if (!afterParam) {
+                    macro->params.push_back("__VA_ARGS__");
+                }
+            } else if (is_identifier(token.text)) {
+                macro->params.push_back(std::string(token.text));
+            } else if (token.text != ",") {
+                return nullptr;
+            }
+            afterParam = is_identifier(token.text);
+        }
+        if (!closed) {
+            return nullptr;
+        }
+        bodyStart = lexer.position();
+    }
+
+    macro->body = std::string(directive.substr(bodyStart));
+    MacroLexer bodyLexer(macro->body);
+    while (bodyLexer.next(token)) {
+        token.lineStart = false;
+        if (macro->tokens.empty()) {
+            token.spaceBefore = false;
+        }
+        if (macro->functionLike && is_identifier(token.text)) {
+            auto param = std::find(macro->params.begin(), macro->params.end(), token.text);
+            if (param != macro->params.end()) {
+                token.param = static_cast<int>(param - macro->params.begin());
+            }
+        }
+        macro->tokens.push_back(token);
+    }
+    return macro;
+}
+
+bool MacroExpander::Token::hides(const MacroDefinition* macro) const {
+    return std::find(hideSet.begin(), hideSet.end(), macro) != hideSet.end();
+}
+
+// the newline ending the directive starting at pos, backslash-newlines continue it
+static size_t directive_end(std::string_view source, size_t pos) {
+    while (true) {
+        size_t newline = source.find('\n', pos);
+        if (newline == std::string_view::npos) {
+            return source.size();
+        }
+        size_t last = newline;
+        if (last > pos && source[last - 1] == '\r') {
+            last--;
+        }
+        if (last > pos && source[last - 1] == '\\') {
+            pos = newline + 1;
+            continue;
+        }
+        return newline;
+    }
+}
+
+// apply a #define or #undef (the text after the "#") to a table
+// @return true if the table changed
+static bool apply_definition(std::string_view text, MacroTable& table) {
+    MacroLexer lexer(text);
+    MacroToken keyword;
+    if (!lexer.next(keyword)) {
+        return false;
+    }
+    std::string_view rest = text.substr(lexer.position());
+    if (keyword.text == "define") {
+        std::shared_ptr<const MacroDefinition> macro = MacroDefinition::parse(rest);
+        if (macro) {
+            define_macro(table, macro);
+            return true;
+        }
+    } else if (keyword.text == "undef") {
+        MacroLexer nameLexer(rest);
+        MacroToken name;
+        if (nameLexer.next(name)) {
+            return table.erase(name.text) > 0;
+        }
+    }
+    return false;
+}
+
+void MacroExpander::collectDefinitions(std::string_view text, MacroTable& table) {
+    MacroLexer lexer(text);
+    MacroToken token;
+    while (lexer.next(token)) {
+        if (token.lineStart && token.text == "#") {
+            size_t start = token.text.data() - text.data();
+            size_t end = directive_end(text, start);
+            apply_definition(text.substr(start + 1, end - start - 1), table);
+            lexer.seek(end);
+        }
+    }
+}
+
+void MacroExpander::directive(std::string_view text, const IncludeResolver& resolver) {
+    if (apply_definition(text, table)) {
+        fingerprint = ArtifactCache::hash(text, fingerprint);
+        return;
+    }
+
+    MacroLexer lexer(text);
+    MacroToken keyword;
+    if (!resolver || !lexer.next(keyword) || keyword.text != "include") {
+        return;
+    }
+    std::string_view rest = text.substr(lexer.position());
+    rest.remove_prefix(std::min(rest.find_first_not_of(" \t"), rest.size()));
+    if (rest.size() < 2 || (rest.front() != '"' && rest.front() != '<')) {
+        return;
+    }
+    size_t close = rest.find(rest.front() == '<' ? '>' : '"', 1);
+    if (close == std::string_view::npos) {
+        return;
+    }
+    const MacroTable* macros = resolver(rest.substr(1, close - 1), rest.front() == '<');
+    if (macros == nullptr) {
+        return;
+    }
+    for (const auto& entry : *macros) {
+        define_macro(table, entry.second);
+    }
+    // a header's table lives as long as the process, its address stands for its content
+    fingerprint = ArtifactCache::hash(text, fingerprint);
+    fingerprint = ArtifactCache::hash(std::string_view(reinterpret_cast<const char*>(&macros), sizeof(macros)), fingerprint);
+}
+
+const MacroDefinition* MacroExpander::find(std::string_view name) const {
+    auto it = table.find(name);
+    return it == table.end() ? nullptr : it->second.get();
+}
+
+std::string_view MacroExpander::stringize(const std::vector<Token>& arg) {
+    std::string text = "\"";
+    for (size_t i = 0; i < arg.size(); i++) {
+        if (i > 0 && arg[i].spaceBefore) {
+            text += ' ';
+        }
+        // quotes and backslashes of string and character literals are escaped
+        bool literal = arg[i].text.find_first_of("\"'") != std::string_view::npos;
+        for (char c : arg[i].text) {
+            if (literal && (c == '"' || c == '\\')) {
+                text += '\\';
+            }
+            text += c;
+        }
+    }
+    text += '"';
+    scratch.push_back(std::move(text));
+    return scratch.back();
+}
+
+std::string_view MacroExpander::paste(std::string_view left, std::string_view right) {
+    scratch.push_back(std::string(left) + std::string(right));
+    return scratch.back();
+}
+
+bool MacroExpander::collectArgs(std::deque<Token>& pending, const std::function<bool(Token&)>& pull, const MacroDefinition* macro,
+                                std::vector<std::vector<Token>>& args, Token& closing) {
+    std::vector<Token> consumed;
+    args.assign(1, std::vector<Token>());
+    int depth = 0;
+    bool closed = false;
+    while (!closed) {
+        if (pending.empty()) {
+            Token next;
+            if (!pull || !pull(next)) {
+                break;
+            }
+            pending.push_back(std::move(next));
+        }
+        consumed.push_back(pending.front());
+        Token token = std::move(pending.front());
+        pending.pop_front();
+        if (token.text == "(" && depth++ == 0) {
+            continue;
+        }
+        if (token.text == ")" && --depth == 0) {
+            closing = std::move(token);
+            closed = true;
+        } else if (token.text == "," && depth == 1 && !(macro->variadic && args.size() == macro->params.size())) {
+            args.emplace_back();
+        } else {
+            args.back().push_back(std::move(token));
+        }
+    }
+
+    // f() passes no argument, and the variadic part may be left out entirely
+    if (macro->params.empty() && args.size() == 1 && args[0].empty()) {
+        args.clear();
+    }
+    if (macro->variadic && args.size() + 1 == macro->params.size()) {
+        args.emplace_back();
+    }
+    if (closed && args.size() != macro->params.size()) {
+        std::cerr << "Warning: macro " << macro->name << " takes " << macro->params.size() << " arguments, "
+                  << args.size() << " given; left unexpanded" << std::endl;
+        closed = false;
+    }
+    if (!closed) {
+        pending.insert(pending.begin(), consumed.begin(), consumed.end());
+    }
+    return closed;
+}
+
+std::vector<MacroExpander::Token> MacroExpander::substitute(const MacroDefinition* macro, const std::vector<std::vector<Token>>& args,
+                                                            const std::vector<const MacroDefinition*>& hideSet) {
+    std::vector<Token> result;
+    std::vector<std::vector<Token>> expandedArgs(args.size());
+    std::vector<bool> argExpanded(args.size(), false);
+    const std::vector<MacroToken>& body = macro->tokens;
+
+    for (size_t i = 0; i < body.size(); i++) {
+        const MacroToken& token = body[i];
+        bool pastedAfter = i + 1 < body.size() && body[i + 1].text == "##";
+
+        if (macro->functionLike && token.text == "#" && i + 1 < body.size() && body[i + 1].param >= 0) {
+            result.push_back(Token{stringize(args[body[++i].param]), token.spaceBefore, {}});
+        } else if (token.text == "##" && i + 1 < body.size()) {
+            // an empty operand leaves the other one as it is
+            const MacroToken& right = body[++i];
+            std::vector<Token> rightTokens;
+            if (right.param >= 0) {
+                rightTokens = args[right.param];
+            } else {
+                rightTokens.push_back(Token{right.text, right.spaceBefore, {}});
+            }
+            if (rightTokens.empty()) {
+                continue;
+            }
+            if (result.empty() || result.back().text.empty()) {
+                bool spaceBefore = result.empty() ? false : result.back().spaceBefore;
+                if (!result.empty()) {
+                    result.pop_back();
+                }
+                rightTokens.front().spaceBefore = spaceBefore;
+            } else {
+                result.back().text = paste(result.back().text, rightTokens.front().text);
+                rightTokens.erase(rightTokens.begin());
+            }
+            result.insert(result.end(), rightTokens.begin(), rightTokens.end());
+        } else if (token.param >= 0) {
+            // an operand of ## is pasted as written, any other argument is expanded first
+            const std::vector<Token>* arg = &args[token.param];
+            if (!pastedAfter) {
+                if (!argExpanded[token.param]) {
+                    std::deque<Token> pending(arg->begin(), arg->end());
+                    expand(pending, expandedArgs[token.param], nullptr);
+                    argExpanded[token.param] = true;
+                }
+                arg = &expandedArgs[token.param];
+            }
+            if (arg->empty()) {
+                if (pastedAfter) {
+                    result.push_back(Token{std::string_view(), token.spaceBefore, {}});
+                }
+                continue;
+            }
+            result.insert(result.end(), arg->begin(), arg->end());
+            result[result.size() - arg->size()].spaceBefore = token.spaceBefore;
+        } else {
+            result.push_back(Token{token.text, token.spaceBefore, {}});
+        }
+    }
+
+    // drop the placeholders of empty ## operands and mark what came out of this macro
+    result.erase(std::remove_if(result.begin(), result.end(), [](const Token& token) { return token.text.empty(); }), result.end());
+    for (Token& token : result) {
+        for (const MacroDefinition* hidden : hideSet) {
+            if (!token.hides(hidden)) {
+                token.hideSet.push_back(hidden);
+            }
+        }
+    }
+    return result;
+}
+
+void MacroExpander::expand(std::deque<Token>& pending, std::vector<Token>& output, const std::function<bool(Token&)>& pull) {
+    while (!pending.empty()) {
+        Token token = std::move(pending.front());
+        pending.pop_front();
+        const MacroDefinition* macro = is_identifier(token.text) ? find(token.text) : nullptr;
+        if (macro == nullptr || token.hides(macro)) {
+            output.push_back(std::move(token));
+            continue;
+        }
+
+        std::vector<std::vector<Token>> args;
+        std::vector<const MacroDefinition*> hideSet;
+        if (macro->functionLike) {
+            // the "(" may only show up after the end of a previous expansion
+            Token next;
+            if (pending.empty() && pull && pull(next)) {
+                pending.push_back(std::move(next));
+            }
+            Token closing;
+            if (pending.empty() || pending.front().text != "(" || !collectArgs(pending, pull, macro, args, closing)) {
+                output.push_back(std::move(token));
+                continue;
+            }
+            for (const MacroDefinition* hidden : token.hideSet) {
+                if (closing.hides(hidden)) {
+                    hideSet.push_back(hidden);
+                }
+            }
+        } else {
+            hideSet = token.hideSet;
+        }
+        hideSet.push_back(macro);
+        expansions++;
+
+        std::vector<Token> replacement = substitute(macro, args, hideSet);
+        if (!replacement.empty()) {
+            replacement.front().spaceBefore = token.spaceBefore;
+        }
+        pending.insert(pending.begin(), std::make_move_iterator(replacement.begin()), std::make_move_iterator(replacement.end()));
+    }
+}
+
+bool MacroExpander::expandSource(std::string_view source, std::string& expanded, const IncludeResolver& resolver) {
+    table.clear();
+    fingerprint = ArtifactCache::hash("");
+    std::string out;
+    size_t copied = 0;      // the source up to here is in out already
+    bool changed = false;
+
+    MacroLexer lexer(source);
+    MacroToken token;
+    while (lexer.next(token)) {
+        size_t start = token.text.data() - source.data();
+        if (token.lineStart && token.text == "#") {
+            size_t end = directive_end(source, start);
+            directive(source.substr(start + 1, end - start - 1), resolver);
+            lexer.seek(end);
+            continue;
+        }
+        const MacroDefinition* macro = table.empty() || !is_identifier(token.text) ? nullptr : find(token.text);
+        if (macro == nullptr) {
+            continue;
+        }
+
+        // the use as written: the name, and for a function-like macro its parenthesized arguments
+        size_t useEnd = lexer.position();
+        uint64_t argsHash = 0;
+        if (macro->functionLike) {
+            MacroLexer argLexer(source);
+            argLexer.seek(useEnd);
+            MacroToken argToken;
+            int depth = 0;
+            while (argLexer.next(argToken) && !(argToken.lineStart && argToken.text == "#")) {
+                if (depth == 0 && argToken.text != "(") {
+                    break;
+                }
+                depth += argToken.text == "(" ? 1 : argToken.text == ")" ? -1 : 0;
+                // stringizing keeps the spaces between tokens, so they are part of the key
+                argsHash = ArtifactCache::hash(argToken.text, ArtifactCache::hash(argToken.spaceBefore ? " " : "\x01", argsHash));
+                if (depth == 0) {
+                    useEnd = argLexer.position();
+                    break;
+                }
+            }
+            if (useEnd == lexer.position()) {
+                // the name on its own is not a use of a function-like macro
+                continue;
+            }
+        }
+
+        out += source.substr(copied, start - copied);
+        size_t replacementStart = out.size();
+
+        MemoKey key{fingerprint, ArtifactCache::hash(token.text), argsHash};
+        std::string_view use = source.substr(start, useEnd - start);
+        auto memoized = memo.find(key);
+        size_t consumedEnd;
+        // the use is compared as written, so a colliding hash only costs a miss
+        if (memoized != memo.end() && memoized->second.use == use) {
+            memoHits++;
+            out += memoized->second.expansion;
+            consumedEnd = useEnd;
+        } else {
+            // tokens after the name are pulled from the source as the expansion asks for them
+            consumedEnd = lexer.position();
+            std::function<bool(Token&)> pull = [&](Token& next) {
+                MacroToken sourceToken;
+                size_t before = lexer.position();
+                if (!lexer.next(sourceToken) || (sourceToken.lineStart && sourceToken.text == "#")) {
+                    lexer.seek(before);
+                    return false;
+                }
+                next = Token{sourceToken.text, sourceToken.spaceBefore, {}};
+                consumedEnd = lexer.position();
+                return true;
+            };
+            std::deque<Token> pending;
+            pending.push_back(Token{token.text, false, {}});
+            std::vector<Token> output;
+            expand(pending, output, pull);
+
+            std::string text;
+            for (size_t i = 0; i < output.size(); i++) {
+                if (i > 0 && output[i].spaceBefore) {
+                    text += ' ';
+                }
+                text += output[i].text;
+            }
+            scratch.clear();
+            out += text;
+            // a use that reached past its own arguments depends on what follows it
+            if (consumedEnd == useEnd) {
+                if (memo.size() >= MaxMemoEntries) {
+                    memo.clear();
+                }
+                memo.insert_or_assign(key, MemoEntry{std::string(use), std::move(text)});
+            }
+        }
+
+        lexer.seek(consumedEnd);
+        if (replacementStart > 0 && replacementStart < out.size() && would_merge(out[replacementStart - 1], out[replacementStart])) {
+            out.insert(replacementStart, 1, ' ');
+        }
+        if (consumedEnd < source.size() && out.size() > replacementStart && would_merge(out.back(), source[consumedEnd])) {
+            out += ' ';
+        }
+        out.append(std::count(source.begin() + start, source.begin() + consumedEnd, '\n'), '\n');
+        copied = consumedEnd;
+        changed = true;
+    }
+
+    if (!changed) {
+        return false;
+    }
+    out += source.substr(copied);
+    expanded = std::move(out);
+    return true;
+}
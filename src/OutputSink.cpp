@@ -0,0 +1,199 @@
+#include <iostream>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/uio.h>
+#include "OutputSink.h"
+
+namespace fs = std::filesystem;
+
+SinkBuffer::SinkBuffer(size_t capacity) : buffer(capacity) {
+    setp(buffer.data(), buffer.data() + buffer.size());
+}
+
+SinkBuffer::~SinkBuffer() {
+    close();
+}
+
+bool SinkBuffer::writeOut(const char* extra, size_t extraSize) {
+    iovec iov[2];
+    iov[0].iov_base = pbase();
+    iov[0].iov_len = pptr() - pbase();
+    iov[1].iov_base = const_cast<char*>(extra);
+    iov[1].iov_len = extraSize;
+    setp(buffer.data(), buffer.data() + buffer.size());
+
+    if (fd == -1) {
+        return iov[0].iov_len + iov[1].iov_len == 0;
+    }
+    iovec* pending = iov;
+    int count = 2;
+    while (count > 0) {
+        if (pending->iov_len == 0) {
+            pending++;
+            count--;
+            continue;
+        }
+        ssize_t written = writev(fd, pending, count);
+        if (written == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            failed = true;
+            return false;
+        }
+        // skip what went out, a short write leaves the rest of the vector in place
+        while (count > 0 && static_cast<size_t>(written) >= pending->iov_len) {
+            written -= pending->iov_len;
+            pending++;
+            count--;
+        }
+        if (count > 0) {
+            pending->iov_base = static_cast<char*>(pending->iov_base) + written;
+            pending->iov_len -= written;
+        }
+    }
+    return true;
+}
+
+SinkBuffer::int_type SinkBuffer::overflow(int_type ch) {
+    if (!writeOut(nullptr, 0)) {
+        return traits_type::eof();
+    }
+    if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+        *pptr() = traits_type::to_char_type(ch);
+        pbump(1);
+    }
+    return traits_type::not_eof(ch);
+}
+
+std::streamsize SinkBuffer::xsputn(const char* s, std::streamsize n) {
+    if (n <= epptr() - pptr()) {
+        std::memcpy(pptr(), s, n);
+        pbump(static_cast<int>(n));
+        return n;
+    }
+    return writeOut(s, n) ? n : 0;
+}
+
+int SinkBuffer::sync() {
+    return writeOut(nullptr, 0) ? 0 : -1;
+}
+
+void SinkBuffer::attach(int fd, bool ownsFd) {
+    close();
+    this->fd = fd;
+    this->ownsFd = ownsFd;
+    failed = false;
+}
+
+bool SinkBuffer::close() {
+    bool ok = writeOut(nullptr, 0) && !failed;
+    if (ownsFd && fd != -1) {
+        ok = ::close(fd) == 0 && ok;
+    }
+    fd = -1;
+    ownsFd = false;
+    return ok;
+}
+
+static int open_for_writing(const std::string& path) {
+    int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd == -1) {
+        std::cerr << "Error: cannot open " << path << " for writing: " << std::strerror(errno) << std::endl;
+    }
+    return fd;
+}
+
+OutputSink::OutputSink() : artifactBuffer(64 * 1024), textStream(&textBuffer), artifactStream(&artifactBuffer) {}
+
+OutputSink* OutputSink::open(const std::string& target) {
+    if (target.empty()) {
+        std::cerr << "Error: empty output target, use - for stdout" << std::endl;
+        return nullptr;
+    }
+    if (target == "-") {
+        OutputSink* sink = new OutputSink();
+        sink->textBuffer.attach(STDOUT_FILENO, false);
+        return sink;
+    }
+
+    std::error_code ec;
+    if (target.back() == '/' || fs::is_directory(target, ec)) {
+        fs::create_directories(target, ec);
+        if (ec) {
+            std::cerr << "Error: cannot create output directory " << target << ": " << ec.message() << std::endl;
+            return nullptr;
+        }
+        int fd = open_for_writing((fs::path(target) / "out.txt").string());
+        if (fd == -1) {
+            return nullptr;
+        }
+        OutputSink* sink = new OutputSink();
+        sink->directory = target;
+        sink->textBuffer.attach(fd, true);
+        return sink;
+    }
+
+    int fd = open_for_writing(target);
+    if (fd == -1) {
+        return nullptr;
+    }
+    OutputSink* sink = new OutputSink();
+    sink->textBuffer.attach(fd, true);
+    return sink;
+}
+
+OutputSink::~OutputSink() {
+    close();
+}
+
+std::ostream& OutputSink::beginArtifact(const std::string& name) {
+    endArtifact();
+    artifactOpen = true;
+    if (directory.empty()) {
+        textStream << "// ==== " << name << "\n";
+        return textStream;
+    }
+
+    // a failed artifact before this one must not leave the stream in a bad state
+    artifactStream.clear();
+    int fd = open_for_writing((fs::path(directory) / name).string());
+    if (fd == -1) {
+        failed = true;
+    }
+    // a failed open leaves the buffer detached, writes to it are dropped
+    artifactBuffer.attach(fd, true);
+    return artifactStream;
+}
+
+void OutputSink::endArtifact() {
+    if (!artifactOpen) {
+        return;
+    }
+    artifactOpen = false;
+    if (directory.empty()) {
+        textStream << "\n";
+    } else if (!artifactBuffer.close()) {
+        failed = true;
+    }
+}
+
+int OutputSink::artifactFd() {
+    if (directory.empty()) {
+        textStream.flush();
+        return textBuffer.getFd();
+    }
+    artifactStream.flush();
+    return artifactBuffer.getFd();
+}
+
+bool OutputSink::close() {
+    endArtifact();
+    textStream.flush();
+    bool ok = textBuffer.close() && !failed;
+    failed = !ok;
+    return ok;
+}
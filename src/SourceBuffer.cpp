@@ -0,0 +1,72 @@
+#include <iostream>
+#include <cerrno>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "SourceBuffer.h"
+
+SourceBuffer::SourceBuffer(std::string source) : mapping(nullptr), owned(std::move(source)) {
+    text = owned.data();
+    length = owned.size();
+}
+
+SourceBuffer::~SourceBuffer() {
+    if (mapping) {
+        munmap(mapping, length);
+    }
+}
+
+SourceBuffer* SourceBuffer::mapFile(const std::string& filename) {
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd == -1) {
+        std::cerr << "Failed to open file: " << filename << std::endl;
+        return nullptr;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) == -1) {
+        std::cerr << "Failed to stat file: " << filename << std::endl;
+        close(fd);
+        return nullptr;
+    }
+
+    // a pipe or a terminal (svf_frontend <(cpp foo.c), /dev/stdin) has no size to map, read it to the end
+    if (!S_ISREG(st.st_mode)) {
+        std::string source;
+        char chunk[65536];
+        ssize_t count;
+        while ((count = read(fd, chunk, sizeof(chunk))) != 0) {
+            if (count == -1) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                std::cerr << "Failed to read file: " << filename << std::endl;
+                close(fd);
+                return nullptr;
+            }
+            source.append(chunk, count);
+        }
+        close(fd);
+        return new SourceBuffer(std::move(source));
+    }
+
+    SourceBuffer* buffer = new SourceBuffer();
+    // mmap rejects zero-length mappings, an empty file is just an empty buffer
+    if (st.st_size > 0) {
+        void* addr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (addr == MAP_FAILED) {
+            std::cerr << "Failed to map file: " << filename << std::endl;
+            close(fd);
+            delete buffer;
+            return nullptr;
+        }
+        // the parser and the AST builder both walk the text front to back
+        madvise(addr, st.st_size, MADV_SEQUENTIAL);
+        buffer->mapping = addr;
+        buffer->text = static_cast<const char*>(addr);
+        buffer->length = st.st_size;
+    }
+    close(fd);
+    return buffer;
+}
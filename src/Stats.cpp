@@ -0,0 +1,165 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <new>
+#include <cstdlib>
+#include <ctime>
+#include <sys/resource.h>
+#include "Stats.h"
+#include "Json.h"
+
+// Counted by the replacement operator new below. Plain thread_locals with
+// constant initializers need no TLS guard, so counting costs two increments.
+static thread_local uint64_t allocationCount = 0;
+static thread_local uint64_t allocatedBytes = 0;
+
+void* operator new(std::size_t size) {
+    allocationCount++;
+    allocatedBytes += size;
+    if (size == 0) {
+        size = 1;
+    }
+    while (true) {
+        if (void* p = std::malloc(size)) {
+            return p;
+        }
+        std::new_handler handler = std::get_new_handler();
+        if (handler == nullptr) {
+            throw std::bad_alloc();
+        }
+        handler();
+    }
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+uint64_t thread_allocation_count() {
+    return allocationCount;
+}
+
+uint64_t thread_allocated_bytes() {
+    return allocatedBytes;
+}
+
+long peak_rss_kb() {
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+    // Linux reports ru_maxrss in KiB
+    return usage.ru_maxrss;
+}
+
+static double clock_ms(clockid_t clock) {
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+PhaseTimer::PhaseTimer(PhaseStats* stats) : stats(stats) {
+    if (stats) {
+        wallStart = clock_ms(CLOCK_MONOTONIC);
+        cpuStart = clock_ms(CLOCK_THREAD_CPUTIME_ID);
+        allocationsStart = allocationCount;
+        bytesStart = allocatedBytes;
+    }
+}
+
+PhaseTimer::~PhaseTimer() {
+    if (stats) {
+        stats->wallMs += clock_ms(CLOCK_MONOTONIC) - wallStart;
+        stats->cpuMs += clock_ms(CLOCK_THREAD_CPUTIME_ID) - cpuStart;
+        stats->allocations += allocationCount - allocationsStart;
+        stats->allocatedBytes += allocatedBytes - bytesStart;
+        stats->peakRssKb = peak_rss_kb();
+    }
+}
+
+static PhaseStats* find_phase(std::vector<PhaseStats>& phases, const std::string& phaseName) {
+    for (PhaseStats& phase : phases) {
+        if (phase.name == phaseName) {
+            return &phase;
+        }
+    }
+    phases.emplace_back();
+    phases.back().name = phaseName;
+    return &phases.back();
+}
+
+static void phases_to_json(std::ostream& json, const std::vector<PhaseStats>& phases) {
+    json << "\"phases\": [";
+    for (size_t i = 0; i < phases.size(); i++) {
+        json << (i ? ", " : "") << phases[i].toJson();
+    }
+    json << "]";
+}
+
+std::string PhaseStats::toJson() const {
+    std::ostringstream json;
+    json << std::fixed << std::setprecision(3);
+    json << "{\"name\": \"" << json_escape(name) << "\", \"wallMs\": " << wallMs << ", \"cpuMs\": " << cpuMs
+         << ", \"allocations\": " << allocations << ", \"allocatedBytes\": " << allocatedBytes
+         << ", \"peakRssKb\": " << peakRssKb << "}";
+    return json.str();
+}
+
+PhaseStats* FunctionStats::phase(const std::string& phaseName) {
+    return find_phase(phases, phaseName);
+}
+
+std::string FunctionStats::toJson() const {
+    std::ostringstream json;
+    json << "{\"name\": \"" << json_escape(name) << "\", \"statements\": " << statements
+         << ", \"blocks\": " << blocks << ", \"phis\": " << phis << ", ";
+    if (!degraded.empty()) {
+        json << "\"degraded\": \"" << degraded << "\", ";
+    }
+    phases_to_json(json, phases);
+    json << "}";
+    return json.str();
+}
+
+PhaseStats* FileStats::phase(const std::string& phaseName) {
+    return find_phase(phases, phaseName);
+}
+
+std::string FileStats::toJson() const {
+    std::ostringstream json;
+    json << "{\"file\": \"" << json_escape(filename) << "\", \"cstNodes\": " << cstNodes
+         << ", \"statements\": " << statements << ", \"blocks\": " << blocks << ", \"phis\": " << phis << ", ";
+    if (!degraded.empty()) {
+        json << "\"degraded\": \"" << degraded << "\", ";
+    }
+    phases_to_json(json, phases);
+    json << ", \"functions\": [";
+    for (size_t i = 0; i < functions.size(); i++) {
+        json << (i ? ",\n    " : "\n    ") << functions[i].toJson();
+    }
+    json << "]}";
+    return json.str();
+}
+
+bool write_stats_report(const std::string& path, const std::vector<FileStats>& files) {
+    std::ofstream file;
+    if (path != "-") {
+        file.open(path);
+        if (!file.is_open()) {
+            std::cerr << "Error: cannot write statistics to " << path << std::endl;
+            return false;
+        }
+    }
+    std::ostream& json = path == "-" ? std::cout : file;
+    json << "{\"peakRssKb\": " << peak_rss_kb() << ", \"files\": [";
+    for (size_t i = 0; i < files.size(); i++) {
+        json << (i ? ",\n  " : "\n  ") << files[i].toJson();
+    }
+    json << "\n]}" << std::endl;
+    return true;
+}
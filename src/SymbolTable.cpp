@@ -2,19 +2,22 @@
 #include <string>
 #include "Ir.h"
 
-std::string SymbolTable::toString(){
-    std::stringstream str;
+void SymbolTable::print(std::ostream& str) const {
     const int labelWidth = 15;
     
     str << std::right << std::setw(labelWidth) << "SymbolTable"  << " : " << this->methodName << "\n";
     str << std::right << std::setw(labelWidth) <<  "TypeDefTable"  << " : " << "\n";
     for(auto pair : this->typeDefTable){
-        str << std::right << std::setw(labelWidth) <<  pair.first << " : " << pair.second->toString() << "\n";
+        str << std::right << std::setw(labelWidth) <<  symbol_name(pair.first) << " : " << *pair.second << "\n";
     }
     str << std::right << std::setw(labelWidth) <<  "VarTable"  << " : " << "\n";
     for(auto pair : this->varTable){
-        str << std::right << std::setw(labelWidth) <<  pair.first << " : " << pair.second->toString() << "\n";
+        str << std::right << std::setw(labelWidth) <<  symbol_name(pair.first) << " : " << *pair.second << "\n";
     }
+}
 
+std::string SymbolTable::toString() const {
+    std::stringstream str;
+    print(str);
     return str.str();
 }
\ No newline at end of file
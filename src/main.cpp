@@ -5,97 +5,124 @@
 #include <unistd.h>
 #include <fcntl.h>
 #include <cstring>
+#include <cstdlib>
 #include "utils.h"
 #include <memory>
-#include "ASTBuilder.h"
-#include "CFG.h"
-
-// Include the C parser header
-extern "C" const TSLanguage *tree_sitter_c();
+#include "Driver.h"
+#include "BatchRunner.h"
+#include "AnalysisServer.h"
+#include "Trace.h"
+#include "OutputSink.h"
 
 argparse::ArgumentParser program("svf_frontend");
 
-int main(int argc, char *argv[]) {
-  
-  // Parse command line arguments
-  parse_command_line(program, argc, argv);
-
-  // Read C++ code from file
-  std::string *source_code = read_file(program.get<std::string>("filename"));
-  if (source_code == nullptr) {
-    return 1;
+// run the mode selected on the command line, returns the exit status
+static int run(const DriverOptions& options) {
+  if (program.is_used("--batch")) {
+    std::vector<std::string> files = load_batch_inputs(program.get<std::string>("--batch"));
+    if (files.empty()) {
+      std::cerr << "Error: no translation units to analyze" << std::endl;
+      return 1;
+    }
+    // In batch mode --output names the directory receiving the per-TU results
+    std::string outputDir = program.get<std::string>("--output");
+    if (outputDir == "-") {
+      outputDir = ".";
+    }
+    BatchRunner runner(options, program.get<unsigned>("--jobs"), outputDir);
+    if (program.is_used("--stats")) {
+      std::vector<FileStats> stats;
+      int failures = runner.run(files, &stats);
+      bool written = write_stats_report(program.get<std::string>("--stats"), stats);
+      return failures == 0 && written ? 0 : 1;
+    }
+    return runner.run(files) == 0 ? 0 : 1;
   }
 
-  // Create a new parser
-  TSParser *parser = ts_parser_new();
-  // Get the language from the parser
-  const TSLanguage *language = tree_sitter_c();
-  ts_parser_set_language(parser, language);
+  if (program["--server"] == true || program.is_used("--socket")) {
+    AnalysisServer server;
+    if (program.is_used("--socket")) {
+      return server.serveSocket(program.get<std::string>("--socket"));
+    }
+    server.serve(std::cin, std::cout);
+    return 0;
+  }
 
-  const char * source_code_ptr = source_code->c_str();
-  TSTree *tree = ts_parser_parse_string(parser, nullptr, source_code_ptr, strlen(source_code_ptr));
+  std::string filename = program.get<std::string>("filename");
+  if (filename.empty()) {
+    std::cerr << "Error: a filename, --batch or --server is required" << std::endl;
+    std::cerr << program;
+    return 1;
+  }
 
-  if (program["--output-cst"] == true) {
-    write_cst_to_file("cst.dot", tree);
+  std::unique_ptr<OutputSink> sink(OutputSink::open(program.get<std::string>("--output")));
+  if (!sink) {
+    return 1;
   }
 
-  // Get the root node of the syntax tree
-  TSNode root_node = ts_tree_root_node(tree);
+  Driver driver(options);
+  std::vector<FileStats> stats(1);
+  bool wantStats = program.is_used("--stats");
+  int status = driver.analyzeFile(filename, *sink, wantStats ? &stats[0] : nullptr);
+  if (!sink->close()) {
+    status = 1;
+  }
+  if (wantStats && !write_stats_report(program.get<std::string>("--stats"), stats)) {
+    status = 1;
+  }
+  return status;
+}
 
+int main(int argc, char *argv[]) {
 
-  ASTBuilder ast_builder(source_code, language);
-  Ir* ast_root = ast_builder.build(root_node);
+  // Parse command line arguments
+  parse_command_line(program, argc, argv);
 
-  if (program["--verbose"] == true) {
-    std::cout << "\n======= AST:\n" << ast_root->prettyPrint("") << std::endl;
-    std::cout << "\n======= AST toString():\n" << ast_root->toString() << std::endl;
+  DriverOptions options;
+  options.verbose = program["--verbose"] == true;
+  options.outputCst = program["--output-cst"] == true;
+  options.intermedial = program.is_used("--intermedial");
+  options.cfg = program.is_used("--cfg");
+  options.ssa = program.is_used("--ssa");
+  options.stream = program["--stream"] == true;
+  // a batch still needs each file's memory back for the next one
+  options.noTeardown = program["--no-teardown"] == true && !program.is_used("--batch");
+  options.astThreads = program.get<unsigned>("--ast-threads");
+  options.recordBlocks = program["--leader-blocks"] == false;
+  options.parseTimeoutMs = program.get<unsigned>("--parse-timeout-ms");
+  options.functionBudget.timeMs = program.get<unsigned>("--function-timeout-ms");
+  options.functionBudget.allocatedBytes = uint64_t(program.get<unsigned>("--function-memory-mb")) << 20;
+  options.expandMacros = program["--expand-macros"] == true;
+  if (program.is_used("--functions")) {
+    std::istringstream names(program.get<std::string>("--functions"));
+    std::string name;
+    while (std::getline(names, name, ',')) {
+      if (!name.empty()) {
+        options.functions.push_back(name);
+      }
+    }
   }
-  IrTransUnit* unit = dynamic_cast<IrTransUnit*>(ast_root);
-  
-  if (program.is_used("--intermedial")){
-    std::cout << "\n=======IR:\n" << std::endl;
-    LlBuildersList* llBuildersList = unit->getLlBuilder();
-    std::cout << llBuildersList->toString() << std::endl;
+  if (program.is_used("--include-dir")) {
+    options.includePaths = program.get<std::vector<std::string>>("--include-dir");
   }
-
-  vector<CFG*> cfgs;
-  if (program.is_used("--cfg")){
-    CFGBuilder cfgBuilder;
-    LlBuildersList* llBuildersList = unit->getLlBuilder();
-    int count = 0;
-    for (LlBuilder* builder : llBuildersList->getBuilders()) {
-      CFG* cfg = cfgBuilder.buildCFG(*builder);
-      cfgs.push_back(cfg);
-      cfg->writeDotFile("cfg" + to_string(count) + ".dot");
-      count++;
-    }
+  if (program.is_used("--cache-dir")) {
+    options.cacheDir = program.get<std::string>("--cache-dir");
   }
 
-    if (program.is_used("--ssa")){
-        SSAGenerator ssaGenerator;
-        int count = 0;
-        for (CFG* cfg : cfgs) {
-            if (count == 0) {
-                count++;
-                continue;
-            }
-            ssaGenerator.convertToSSA(cfg);
-            cfg->writeDotFile("cfg_ssa" + to_string(count) + ".dot");
-            count++;
-        }
-    }
-
-  // Clean up
-  delete ast_root;
-
-
-  std::cout << "\n======== Src:" << std::endl;
-  std::cout << *source_code << std::endl;
-
+  if (program.is_used("--trace")) {
+    Trace::enable();
+    Trace::setThreadName("main");
+  }
 
-  // Clean up
-  ts_tree_delete(tree);
-  ts_parser_delete(parser);
+  int status = run(options);
 
-  return 0;
+  if (program.is_used("--trace") && !Trace::write(program.get<std::string>("--trace"))) {
+    status = 1;
+  }
+  if (program["--no-teardown"] == true) {
+    // every output is closed and flushed by now, nothing left to run in destructors
+    std::cout.flush();
+    std::_Exit(status);
+  }
+  return status;
 }
@@ -0,0 +1,135 @@
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <stdlib.h>
+#include "ArtifactCache.h"
+#include "Driver.h"
+#include "OutputSink.h"
+#include "Stats.h"
+
+class TestArtifactCache : public ::testing::Test {
+protected:
+    std::string dir;
+
+    void SetUp() override {
+        char pattern[] = "/tmp/artifact_cache_XXXXXX";
+        ASSERT_NE(mkdtemp(pattern), nullptr);
+        dir = pattern;
+    }
+
+    void TearDown() override {
+        std::filesystem::remove_all(dir);
+    }
+
+    void write(const std::string& name, const std::string& text) {
+        std::ofstream(dir + "/" + name, std::ios::binary) << text;
+    }
+
+    // cache files of one kind ("tu", "globals", "fn")
+    size_t entries(const std::string& kind) const {
+        size_t count = 0;
+        for (const auto& file : std::filesystem::directory_iterator(dir + "/cache")) {
+            count += file.path().extension() == "." + kind;
+        }
+        return count;
+    }
+
+    FileStats analyze(DriverOptions options) {
+        options.cacheDir = dir + "/cache";
+        options.cfg = true;
+        options.ssa = true;
+        std::unique_ptr<OutputSink> sink(OutputSink::open(dir + "/out.txt"));
+        Driver driver(options);
+        FileStats stats;
+        EXPECT_EQ(driver.analyzeFile(dir + "/unit.c", *sink, &stats), 0);
+        EXPECT_TRUE(sink->close());
+        return stats;
+    }
+
+    static bool parsed(const FileStats& stats) {
+        for (const PhaseStats& phase : stats.phases) {
+            if (phase.name == "parse") {
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+TEST_F(TestArtifactCache, TestStoreAndLoad) {
+    ArtifactCache cache(dir + "/nested/cache");
+    CacheEntry entry;
+    entry["ir"] = "x = 1\n\ny = 2";
+    entry["empty"] = "";
+    entry["binary"] = std::string("a\0b\n", 4);
+    uint64_t key = ArtifactCache::hash("int f() {}", ArtifactCache::hash("globals"));
+    cache.store(key, "fn", entry);
+
+    CacheEntry loaded;
+    ASSERT_TRUE(cache.load(key, "fn", loaded));
+    EXPECT_EQ(loaded, entry);
+    EXPECT_FALSE(cache.load(key, "tu", loaded));
+    EXPECT_FALSE(cache.load(key + 1, "fn", loaded));
+
+    uint64_t parsedKey;
+    ASSERT_TRUE(ArtifactCache::fromHex(ArtifactCache::toHex(key), parsedKey));
+    EXPECT_EQ(parsedKey, key);
+}
+
+TEST_F(TestArtifactCache, TestRoundTrip) {
+    write("defs.h", "typedef int T;\n");
+    write("unit.c", "#include \"defs.h\"\nT f(T a) { return a + 1; }\nT g(T b) { return b * 2; }\n");
+    DriverOptions options;
+    options.includePaths.push_back(dir);
+
+    FileStats first = analyze(options);
+    EXPECT_TRUE(parsed(first));
+    EXPECT_EQ(entries("tu"), 1u);
+    EXPECT_EQ(entries("globals"), 1u);
+    EXPECT_EQ(entries("fn"), 2u);
+    ASSERT_EQ(first.functions.size(), 2u);
+
+    // unchanged: found by the whole-text hash, with the same statistics
+    FileStats hit = analyze(options);
+    EXPECT_FALSE(parsed(hit));
+    ASSERT_EQ(hit.functions.size(), 2u);
+    for (size_t i = 0; i < hit.functions.size(); i++) {
+        EXPECT_EQ(hit.functions[i].name, first.functions[i].name);
+        EXPECT_EQ(hit.functions[i].statements, first.functions[i].statements);
+        EXPECT_EQ(hit.functions[i].blocks, first.functions[i].blocks);
+        EXPECT_EQ(hit.functions[i].phis, first.functions[i].phis);
+    }
+    EXPECT_GT(hit.statements, 0u);
+    EXPECT_EQ(hit.statements, first.statements);
+
+    // one changed function misses alone
+    write("unit.c", "#include \"defs.h\"\nT f(T a) { return a + 10; }\nT g(T b) { return b * 2; }\n");
+    EXPECT_TRUE(parsed(analyze(options)));
+    EXPECT_EQ(entries("tu"), 2u);
+    EXPECT_EQ(entries("globals"), 1u);
+    EXPECT_EQ(entries("fn"), 3u);
+
+    // a changed header changes the globals, and with them every function;
+    // the file's own text is the same, so its entry is replaced
+    write("defs.h", "typedef long T;\n");
+    EXPECT_TRUE(parsed(analyze(options)));
+    EXPECT_EQ(entries("tu"), 2u);
+    EXPECT_EQ(entries("globals"), 2u);
+    EXPECT_EQ(entries("fn"), 5u);
+
+    // another --functions selection is another file entry, its functions still hit
+    options.functions.push_back("g");
+    FileStats selected = analyze(options);
+    EXPECT_TRUE(parsed(selected));
+    EXPECT_EQ(entries("tu"), 3u);
+    EXPECT_EQ(entries("fn"), 5u);
+    ASSERT_EQ(selected.functions.size(), 1u);
+    EXPECT_EQ(selected.functions[0].name, "g");
+}
+
+int main(int argc, char* argv[]) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,93 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+#include "IncrementalSession.h"
+
+class TestIncrementalSession : public ::testing::Test {
+protected:
+    const std::string source =
+        "typedef int T;\n"
+        "int g = 1;\n"
+        "int f(int a) { return a + 1; }\n"
+        "int h(int b) { return b * 2; }\n"
+        "int k(int c) { return c - 3; }\n";
+
+    IncrementalSession session;
+
+    void SetUp() override {
+        ASSERT_TRUE(session.open(source));
+        ASSERT_EQ(session.getFunctions().size(), 3u);
+        ASSERT_EQ(session.getRebuilt().size(), 3u);
+    }
+
+    static std::string replaced(const std::string& text, const std::string& from, const std::string& to) {
+        std::string result = text;
+        result.replace(result.find(from), from.size(), to);
+        return result;
+    }
+
+    // the builder and CFG of a function, which stay put as long as it is not rebuilt
+    std::pair<LlBuilder*, CFG*> lowered(size_t index) const {
+        const IncrementalSession::Function& function = session.getFunctions()[index];
+        return {function.builder, function.cfg};
+    }
+
+    bool rebuiltAll() const {
+        return session.getRebuilt().size() == session.getFunctions().size();
+    }
+};
+
+TEST_F(TestIncrementalSession, TestBodyEditRebuildsOneFunction) {
+    auto h = lowered(1);
+    auto k = lowered(2);
+    ASSERT_TRUE(session.update(replaced(source, "a + 1", "a + 10")));
+    EXPECT_EQ(session.getRebuilt(), std::vector<size_t>{0});
+    EXPECT_EQ(lowered(1), h);
+    EXPECT_EQ(lowered(2), k);
+    EXPECT_EQ(session.getFunctions()[0].name, "f");
+
+    // the same through applyEdit, in the last function
+    size_t at = session.getText().find("c - 3");
+    ASSERT_TRUE(session.applyEdit(at + 4, at + 5, "4"));
+    EXPECT_EQ(session.getRebuilt(), std::vector<size_t>{2});
+    EXPECT_EQ(lowered(1), h);
+}
+
+TEST_F(TestIncrementalSession, TestGlobalEditRebuildsAll) {
+    ASSERT_TRUE(session.update(replaced(source, "int g = 1;", "int g = 5;")));
+    EXPECT_TRUE(rebuiltAll());
+}
+
+TEST_F(TestIncrementalSession, TestTypedefEditRebuildsAll) {
+    ASSERT_TRUE(session.update(replaced(source, "typedef int T;", "typedef long T;")));
+    EXPECT_TRUE(rebuiltAll());
+}
+
+TEST_F(TestIncrementalSession, TestAddedAndRemovedFunctionsRebuildAll) {
+    ASSERT_TRUE(session.update(source + "int m(void) { return 0; }\n"));
+    EXPECT_EQ(session.getFunctions().size(), 4u);
+    EXPECT_TRUE(rebuiltAll());
+
+    ASSERT_TRUE(session.update(replaced(source, "int h(int b) { return b * 2; }\n", "")));
+    EXPECT_EQ(session.getFunctions().size(), 2u);
+    EXPECT_TRUE(rebuiltAll());
+    EXPECT_EQ(session.getFunctions()[1].name, "k");
+}
+
+TEST_F(TestIncrementalSession, TestDeletionAtFunctionBoundary) {
+    // deleting the newline between f and h touches both, but not k
+    auto k = lowered(2);
+    size_t at = source.find("}\nint h") + 1;
+    ASSERT_TRUE(session.applyEdit(at, at + 1, ""));
+    EXPECT_FALSE(rebuiltAll());
+    for (size_t index : session.getRebuilt()) {
+        EXPECT_LT(index, 2u);
+    }
+    EXPECT_EQ(lowered(2), k);
+    EXPECT_EQ(session.getFunctions()[2].startByte, source.find("int k") - 1);
+}
+
+int main(int argc, char* argv[]) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
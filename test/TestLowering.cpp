@@ -0,0 +1,291 @@
+#include <gtest/gtest.h>
+#include <map>
+#include <set>
+#include <functional>
+#include "Ir.h"
+#include "LlBuilder.h"
+#include "SymbolTable.h"
+#include "CFG.h"
+
+class TestLowering : public ::testing::Test {
+protected:
+    TSNode node{};
+    IrArena arena;
+    IrArena::Scope arenaScope{arena};
+    LlPool pool;
+    LlPool::Scope poolScope{pool};
+    std::string assign = "=";
+
+    IrStatement* assignStmt(IrIdent* target, IrExpr* value) {
+        return new IrExprStmt(new IrAssignExpr(target, value, assign, node), node);
+    }
+
+    IrStatement* declare(IrIdent* name, int value) {
+        return new IrDecl(new IrTypeInt(node), nullptr, new IrInitDeclarator(name, new IrLiteralNumber(value, node), node), node);
+    }
+
+    IrFunctionDef* function(const std::string& name, IrCompoundStmt* body) {
+        IrFunctionDecl* decl = new IrFunctionDecl(new IrIdent(name, node), new IrParamList(node), node);
+        return new IrFunctionDef(new IrTypeInt(node), decl, body, node);
+    }
+
+    /*
+    int f() {
+        int v = 1; int b = 2; int x = 0;
+        switch (v) {
+        case 9: x = 1; break;
+        case -1: x = 2;
+        case 'a': x = 3; break;
+        case b: x = 4; break;
+        case 3: x = 5;
+        case 40: x = 6; break;
+        default: x = 7;
+        }
+        return x;
+    }
+    */
+    IrFunctionDef* createSwitchFunction() {
+        IrIdent* v = new IrIdent("v", node);
+        IrIdent* b = new IrIdent("b", node);
+        IrIdent* x = new IrIdent("x", node);
+        std::vector<std::pair<IrExpr*, bool>> values = {
+            {new IrLiteralNumber(9, node), true},
+            {new IrUnaryExpr("-", new IrLiteralNumber(1, node), node), false},
+            {new IrLiteralChar('a', node), true},
+            {b, true},
+            {new IrLiteralNumber(3, node), false},
+            {new IrLiteralNumber(40, node), true},
+        };
+        IrCompoundStmt* cases = new IrCompoundStmt(node);
+        int assigned = 1;
+        for (auto& [value, breaks] : values) {
+            std::deque<IrStatement*> stmts{assignStmt(x, new IrLiteralNumber(assigned++, node))};
+            if (breaks) {
+                stmts.push_back(new IrBreakStmt(node));
+            }
+            cases->addStmt(new IrCaseStmt(value, stmts, node));
+        }
+        cases->addStmt(new IrCaseStmt(nullptr, {assignStmt(x, new IrLiteralNumber(assigned, node))}, node));
+
+        IrCompoundStmt* body = new IrCompoundStmt(node);
+        body->addStmt(declare(v, 1));
+        body->addStmt(declare(b, 2));
+        body->addStmt(declare(x, 0));
+        body->addStmt(new IrSwitchStmt(new IrParenthesizedExpr(v, node), cases, node));
+        body->addStmt(new IrStmtReturnExpr(x, node));
+        return function("f", body);
+    }
+
+    /*
+    int g() {
+        int a = 1; int b = 2;
+        if (a < b) { a = a + 5; } else b = 0;
+        for (b = 0; a < b; a = a + 5) { a = a + 5; if (a < b) break; }
+        while (a < b) { a = a + 5; if (a < b) break; }
+        switch (a) { case 9: b = 18; break; case 3: b = 6; case 40: b = 80; default: b = 0; }
+        return a;
+    }
+    */
+    IrFunctionDef* createLoopFunction() {
+        std::string plus = "+", less = "<";
+        IrIdent* a = new IrIdent("a", node);
+        IrIdent* b = new IrIdent("b", node);
+        IrParenthesizedExpr* test = new IrParenthesizedExpr(new IrBinaryExpr(less, a, b, node), node);
+        IrAssignExpr* step = new IrAssignExpr(a, new IrBinaryExpr(plus, a, new IrLiteralNumber(5, node), node), assign, node);
+        IrAssignExpr* reset = new IrAssignExpr(b, new IrLiteralNumber(0, node), assign, node);
+
+        IrCompoundStmt* thenBody = new IrCompoundStmt(node);
+        thenBody->addStmt(new IrExprStmt(step, node));
+        IrCompoundStmt* loopBody = new IrCompoundStmt(node);
+        loopBody->addStmt(new IrExprStmt(step, node));
+        loopBody->addStmt(new IrIfStmt(test, new IrBreakStmt(node), nullptr, node));
+
+        IrCompoundStmt* cases = new IrCompoundStmt(node);
+        for (int value : {9, 3, 40}) {
+            std::deque<IrStatement*> stmts{assignStmt(b, new IrLiteralNumber(value * 2, node))};
+            if (value == 9) {
+                stmts.push_back(new IrBreakStmt(node));
+            }
+            cases->addStmt(new IrCaseStmt(new IrLiteralNumber(value, node), stmts, node));
+        }
+        cases->addStmt(new IrCaseStmt(nullptr, {new IrExprStmt(reset, node)}, node));
+
+        IrCompoundStmt* body = new IrCompoundStmt(node);
+        body->addStmt(declare(a, 1));
+        body->addStmt(declare(b, 2));
+        body->addStmt(new IrIfStmt(test, thenBody, new IrElseClause(new IrExprStmt(reset, node), node), node));
+        body->addStmt(new IrForStmt(reset, test, step, loopBody, node));
+        body->addStmt(new IrWhileStmt(test, loopBody, node));
+        body->addStmt(new IrSwitchStmt(new IrParenthesizedExpr(a, node), cases, node));
+        body->addStmt(new IrStmtReturnExpr(a, node));
+        return function("g", body);
+    }
+
+    // every block with its statements and its sorted successors and predecessors
+    static std::map<std::string, std::string> blocks(CFG* cfg) {
+        std::map<std::string, std::string> result;
+        for (BasicBlock* block : cfg->getBlocksList()) {
+            std::string text;
+            for (LlStatement* stmt : block->getLlStatements()) {
+                text += stmt->toString() + "; ";
+            }
+            std::set<std::string> succs, preds;
+            for (BasicBlock* succ : block->getSuccessors()) {
+                succs.insert(succ->getLabel());
+            }
+            for (BasicBlock* pred : block->getPredecessors()) {
+                preds.insert(pred->getLabel());
+            }
+            text += "succs:";
+            for (const std::string& label : succs) {
+                text += " " + label;
+            }
+            text += " preds:";
+            for (const std::string& label : preds) {
+                text += " " + label;
+            }
+            result[block->getLabel()] = text;
+        }
+        return result;
+    }
+
+    static std::set<std::string> reachable(CFG* cfg) {
+        std::set<std::string> seen;
+        std::function<void(BasicBlock*)> visit = [&](BasicBlock* block) {
+            if (seen.insert(block->getLabel()).second) {
+                for (BasicBlock* succ : block->getSuccessors()) {
+                    visit(succ);
+                }
+            }
+        };
+        visit(cfg->getEntry());
+        return seen;
+    }
+
+    // whether a block assigns x, the blocks that test the switch value do not
+    static bool assignsX(BasicBlock* block) {
+        for (LlStatement* stmt : block->getLlStatements()) {
+            std::string text = stmt->toString();
+            if (text.rfind("x_", 0) == 0 && text.find(" = phi [") == std::string::npos) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // the phis of a block, keyed by variable, with the incoming blocks sorted;
+    // the blocks that test the switch value differ between the two forms and
+    // are all named "dispatch"
+    static std::map<std::string, std::multiset<std::string>> phis(CFG* cfg, BasicBlock* block) {
+        std::map<std::string, std::multiset<std::string>> result;
+        for (LlStatement* stmt : block->getLlStatements()) {
+            std::string text = stmt->toString();
+            size_t phi = text.find(" = phi [");
+            if (phi == std::string::npos) {
+                continue;
+            }
+            std::string var = text.substr(0, text.rfind('_', phi));
+            for (size_t at = text.find(" from ", phi); at != std::string::npos; at = text.find(" from ", at + 1)) {
+                size_t end = text.find_first_of(",]", at);
+                std::string pred = text.substr(at + 6, end - at - 6);
+                result[var].insert(assignsX(cfg->getBlock(pred)) ? pred : "dispatch");
+            }
+        }
+        return result;
+    }
+};
+
+TEST_F(TestLowering, TestTwoWaySwitch) {
+    IrFunctionDef* def = createSwitchFunction();
+    CFGBuilder cfgBuilder;
+
+    LlBuilder switchBuilder("f");
+    SymbolTable switchTable("f");
+    def->generateLlIr(switchBuilder, switchTable);
+    CFG* switchCfg = cfgBuilder.buildCFG(switchBuilder);
+
+    LlBuilder twoWayBuilder("f");
+    SymbolTable twoWayTable("f");
+    twoWayBuilder.setTwoWaySwitches(true);
+    def->generateLlIr(twoWayBuilder, twoWayTable);
+    CFG* twoWayCfg = cfgBuilder.buildCFG(twoWayBuilder);
+
+    // -1 and 'a' fold to cases of the LlSwitch, b is compared before it
+    std::string lowered = switchBuilder.toString();
+    EXPECT_NE(lowered.find("switch "), std::string::npos) << lowered;
+    EXPECT_NE(lowered.find("-1: case.-1."), std::string::npos) << lowered;
+    EXPECT_NE(lowered.find("97: case.97."), std::string::npos) << lowered;
+    EXPECT_EQ(twoWayBuilder.toString().find("switch "), std::string::npos);
+
+    for (BasicBlock* block : twoWayCfg->getBlocksList()) {
+        EXPECT_LE(block->getSuccessors().size(), 2u) << block->getLabel();
+    }
+
+    // the decision tree only adds blocks, every block of the LlSwitch form is
+    // still there and reachable the same way
+    std::set<std::string> switchReachable = reachable(switchCfg);
+    std::set<std::string> twoWayReachable = reachable(twoWayCfg);
+    for (BasicBlock* block : switchCfg->getBlocksList()) {
+        BasicBlock* twin = twoWayCfg->getBlock(block->getLabel());
+        ASSERT_NE(twin, nullptr) << block->getLabel();
+        EXPECT_EQ(switchReachable.count(block->getLabel()), twoWayReachable.count(twin->getLabel())) << block->getLabel();
+    }
+    EXPECT_EQ(switchReachable.size(), switchCfg->getBlocksList().size());
+
+    std::ostringstream log;
+    SSAGenerator switchSsa(log);
+    SSAGenerator twoWaySsa(log);
+    EXPECT_TRUE(switchSsa.convertToSSA(switchCfg));
+    EXPECT_TRUE(twoWaySsa.convertToSSA(twoWayCfg));
+    for (BasicBlock* block : switchCfg->getBlocksList()) {
+        if (block->getLabel().find("case.") == std::string::npos && block->getLabel().find("switch.end") == std::string::npos) {
+            continue;
+        }
+        EXPECT_EQ(phis(switchCfg, block), phis(twoWayCfg, twoWayCfg->getBlock(block->getLabel()))) << block->getLabel();
+    }
+    BasicBlock* join = nullptr;
+    for (BasicBlock* block : switchCfg->getBlocksList()) {
+        if (block->getLabel().find("switch.end") != std::string::npos) {
+            join = block;
+        }
+    }
+    ASSERT_NE(join, nullptr);
+    EXPECT_EQ(phis(switchCfg, join)["x"].size(), 5u);   // four breaks and the default falling out
+
+    delete switchCfg;
+    delete twoWayCfg;
+}
+
+TEST_F(TestLowering, TestRecordedBlocks) {
+    // there is no continue statement in the IR, so break is the only jump out of a loop body
+    IrFunctionDef* def = createLoopFunction();
+    CFGBuilder cfgBuilder;
+    for (bool twoWay : {false, true}) {
+        LlBuilder leaderBuilder("g");
+        SymbolTable leaderTable("g");
+        leaderBuilder.setTwoWaySwitches(twoWay);
+        def->generateLlIr(leaderBuilder, leaderTable);
+        EXPECT_FALSE(leaderBuilder.hasBlocks());
+        CFG* leaderCfg = cfgBuilder.buildCFG(leaderBuilder);
+
+        LlBuilder recordBuilder("g");
+        SymbolTable recordTable("g");
+        recordBuilder.setTwoWaySwitches(twoWay);
+        recordBuilder.setBuildBlocks(true);
+        def->generateLlIr(recordBuilder, recordTable);
+        EXPECT_TRUE(recordBuilder.hasBlocks());
+        CFG* recordCfg = cfgBuilder.buildCFG(recordBuilder);
+
+        EXPECT_GE(recordCfg->getBlocksList().size(), 15u);
+        EXPECT_EQ(recordCfg->getEntry()->getLabel(), leaderCfg->getEntry()->getLabel());
+        EXPECT_EQ(blocks(recordCfg), blocks(leaderCfg)) << (twoWay ? "two-way switches" : "LlSwitch");
+
+        delete leaderCfg;
+        delete recordCfg;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,75 @@
+#include <gtest/gtest.h>
+#include <sstream>
+#include <algorithm>
+#include "MacroExpander.h"
+
+class TestMacroExpander : public ::testing::Test {
+protected:
+    // the expanded text without the #define lines, which are left in place
+    static std::string expand(const std::string& source) {
+        MacroExpander expander;
+        std::string expanded;
+        EXPECT_TRUE(expander.expandSource(source, expanded)) << source;
+        std::istringstream in(expanded);
+        std::string result;
+        for (std::string line; std::getline(in, line); ) {
+            if (line.rfind("#define", 0) != 0) {
+                result += line + "\n";
+            }
+        }
+        return result;
+    }
+};
+
+TEST_F(TestMacroExpander, TestStringizing) {
+    EXPECT_EQ(expand("#define STR(x) #x\nconst char* s = STR(a + b);\n"), "const char* s = \"a + b\";\n");
+}
+
+TEST_F(TestMacroExpander, TestMemoKeepsSpaces) {
+    // uses that differ only in the spaces between their arguments stringize differently
+    MacroExpander expander;
+    std::string expanded;
+    ASSERT_TRUE(expander.expandSource("#define STR(x) #x\nSTR(a+b); STR(a + b); STR(a+b);\n", expanded));
+    EXPECT_EQ(expanded, "#define STR(x) #x\n\"a+b\"; \"a + b\"; \"a+b\";\n");
+    EXPECT_EQ(expander.getMemoHits(), 1u);
+}
+
+TEST_F(TestMacroExpander, TestPasting) {
+    EXPECT_EQ(expand("#define CAT(a, b) a ## b\nint CAT(foo, 1) = CAT(1, 2);\n"), "int foo1 = 12;\n");
+}
+
+TEST_F(TestMacroExpander, TestVariadic) {
+    EXPECT_EQ(expand("#define LOG(fmt, ...) printf(fmt, __VA_ARGS__)\nLOG(\"%d %d\", 1, 2);\n"),
+              "printf(\"%d %d\", 1, 2);\n");
+}
+
+TEST_F(TestMacroExpander, TestSelfReference) {
+    // a macro is not expanded again inside its own expansion, directly or through another one
+    EXPECT_EQ(expand("#define foo foo + 1\nint x = foo;\n"), "int x = foo + 1;\n");
+    EXPECT_EQ(expand("#define A B\n#define B A\nint y = A;\n"), "int y = A;\n");
+}
+
+TEST_F(TestMacroExpander, TestRowsKept) {
+    // a use spanning two lines is followed by a newline, so the next line keeps its row
+    std::string source = "#define F(x, y) (x + y)\nint a = F(1,\n 2);\nint b = 3;\n";
+    MacroExpander expander;
+    std::string expanded;
+    ASSERT_TRUE(expander.expandSource(source, expanded));
+    EXPECT_EQ(expanded, "#define F(x, y) (x + y)\nint a = (1 + 2)\n;\nint b = 3;\n");
+    auto row = [](const std::string& text, size_t offset) {
+        return std::count(text.begin(), text.begin() + offset, '\n');
+    };
+    EXPECT_EQ(row(expanded, expanded.find("int b")), row(source, source.find("int b")));
+}
+
+TEST_F(TestMacroExpander, TestNothingToExpand) {
+    MacroExpander expander;
+    std::string expanded = "untouched";
+    EXPECT_FALSE(expander.expandSource("int plain = 1;\n", expanded));
+    EXPECT_EQ(expanded, "untouched");
+}
+
+int main(int argc, char* argv[]) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
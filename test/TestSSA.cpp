@@ -605,6 +605,90 @@ TEST_F(TestSSA, TestDominators5) {
     delete cfg;
 }
 
+TEST_F(TestSSA, TestDeadline) {
+    CFG* cfg = createTestCFG2();
+    std::ostringstream log;
+    SSAGenerator ssaGen(log);
+
+    // a deadline in the past gives up before the CFG is touched
+    ssaGen.setDeadline(std::chrono::steady_clock::now() - std::chrono::seconds(1));
+    EXPECT_FALSE(ssaGen.convertToSSA(cfg));
+    EXPECT_TRUE(log.str().empty());
+
+    ssaGen.setDeadline(std::chrono::steady_clock::time_point::max());
+    EXPECT_TRUE(ssaGen.convertToSSA(cfg));
+    EXPECT_EQ(ssaGen.getIdoms().at(cfg->getBlock("4")), cfg->getBlock("3"));
+
+    delete cfg;
+}
+
+TEST_F(TestSSA, TestRenameAcrossSiblings) {
+    CFG* cfg = createTestCFG1();
+    std::vector<BasicBlock*> blocks = cfg->getBlocksList();
+    BasicBlock* A = blocks[0];
+    BasicBlock* B = blocks[1];
+    BasicBlock* D = blocks[3];
+    A->addLlStatement(new LlAssignStmtRegular(new LlLocationVar(new std::string("x")), new LlLiteralInt(1)));
+    B->addLlStatement(new LlAssignStmtRegular(new LlLocationVar(new std::string("x")), new LlLiteralInt(2)));
+
+    std::ostringstream log;
+    SSAGenerator ssaGen(log);
+    EXPECT_TRUE(ssaGen.convertToSSA(cfg));
+
+    // B's version must not leak into its sibling C, which still sees A's
+    ASSERT_FALSE(D->getLlStatements().empty());
+    EXPECT_EQ(D->getLlStatements()[0]->toString(), "x_2 = phi [x_1 from B, x_0 from C]");
+
+    delete cfg;
+}
+
+TEST_F(TestSSA, TestSwitchSuccessors) {
+    // x = 0; switch v [1, 2, 3] else end; each case sets x and jumps to end; end: return x
+    for (bool recordBlocks : {false, true}) {
+        LlBuilder builder("f");
+        builder.setBuildBlocks(recordBlocks);
+        LlLabel end = builder.generateLabel().as(LlLabelKind::SwitchEnd);
+        std::vector<std::pair<int, LlLabel>> cases;
+        for (int value : {3, 1, 2}) {
+            cases.emplace_back(value, builder.generateLabel().as(LlLabelKind::Case, value));
+        }
+        LlLocationVar* x = new LlLocationVar(new std::string("x"));
+        builder.appendStatement(new LlAssignStmtRegular(x, new LlLiteralInt(0)));
+        LlSwitch* switchStmt = new LlSwitch(new LlLocationVar(new std::string("v")), cases, end);
+        builder.appendStatement(switchStmt);
+        EXPECT_EQ(switchStmt->toString(), "switch v [1: case.1.L2, 2: case.2.L3, 3: case.3.L1] else switch.end.L0");
+        for (const auto& entry : cases) {
+            builder.appendStatement(entry.second, new LlAssignStmtRegular(new LlLocationVar(new std::string("x")), new LlLiteralInt(entry.first)));
+            builder.appendStatement(new LlJumpUnconditional(end));
+        }
+        builder.appendStatement(end, new LlReturn(x));
+        EXPECT_EQ(builder.hasBlocks(), recordBlocks);
+
+        CFGBuilder cfgBuilder;
+        CFG* cfg = cfgBuilder.buildCFG(builder);
+        BasicBlock* entry = cfg->getEntry();
+        BasicBlock* join = cfg->getBlock("BB_switch.end.L0");
+        ASSERT_NE(join, nullptr);
+        EXPECT_EQ(cfg->getBlocksList().size(), 6u);     // entry, three cases, end and EXIT
+        EXPECT_EQ(entry->getSuccessors().size(), 4u);
+        EXPECT_EQ(join->getPredecessors().size(), 4u);
+
+        std::ostringstream log;
+        SSAGenerator ssaGen(log);
+        EXPECT_TRUE(ssaGen.convertToSSA(cfg));
+        EXPECT_EQ(ssaGen.getIdoms().at(join), entry);
+        ASSERT_FALSE(join->getLlStatements().empty());
+        std::string phi = join->getLlStatements()[0]->toString();
+        size_t incoming = 0;
+        for (size_t at = phi.find(" from "); at != std::string::npos; at = phi.find(" from ", at + 1)) {
+            incoming++;
+        }
+        EXPECT_EQ(incoming, 4u) << phi;
+
+        delete cfg;
+    }
+}
+
 int main(int argc, char* argv[]) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
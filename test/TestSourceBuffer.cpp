@@ -0,0 +1,46 @@
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <string>
+#include <unistd.h>
+#include "SourceBuffer.h"
+
+TEST(TestSourceBuffer, TestRegularFile) {
+    char path[] = "/tmp/source_buffer_XXXXXX";
+    int fd = mkstemp(path);
+    ASSERT_NE(fd, -1);
+    std::string text = "int main() { return 0; }\n";
+    ASSERT_EQ(write(fd, text.data(), text.size()), ssize_t(text.size()));
+    close(fd);
+
+    SourceBuffer* buffer = SourceBuffer::mapFile(path);
+    ASSERT_NE(buffer, nullptr);
+    EXPECT_EQ(buffer->view(), text);
+    delete buffer;
+    unlink(path);
+}
+
+TEST(TestSourceBuffer, TestPipe) {
+    // what svf_frontend <(cpp foo.c) opens: a pipe, whose size is 0 to fstat
+    int fds[2];
+    ASSERT_EQ(pipe(fds), 0);
+    std::string text = "int main(){}\n";
+    ASSERT_EQ(write(fds[1], text.data(), text.size()), ssize_t(text.size()));
+    close(fds[1]);
+
+    SourceBuffer* buffer = SourceBuffer::mapFile("/dev/fd/" + std::to_string(fds[0]));
+    close(fds[0]);
+    ASSERT_NE(buffer, nullptr);
+    EXPECT_EQ(buffer->view(), text);
+    delete buffer;
+}
+
+TEST(TestSourceBuffer, TestMissingFile) {
+    testing::internal::CaptureStderr();
+    EXPECT_EQ(SourceBuffer::mapFile("/nonexistent/source.c"), nullptr);
+    testing::internal::GetCapturedStderr();
+}
+
+int main(int argc, char* argv[]) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}